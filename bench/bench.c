@@ -0,0 +1,511 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ecs.h"
+#include "job.h"
+#include "ui.h"
+#include "uibackend.h"
+
+#define DESIGN_WIDTH 800
+#define DESIGN_HEIGHT 600
+#define BENCH_FRAMES 300
+#define BENCH_PICKS_PER_FRAME 100
+#define BENCH_ICON_COUNT 64
+#define BENCH_SCENE_PATH "warmagic-bench.uis"
+#define BENCH_EDITED_SCENE_PATH "warmagic-bench-edited.uis"
+#define BENCH_SCENE_LINE_MAX 160
+#define BENCH_JOB_BATCH 256
+#define BENCH_CHURN_DIVISOR 100
+
+typedef struct BenchScene
+{
+    size_t count;
+    UIHandle* handles;
+    UIElement* transformed;
+    UIScene* scene;
+    UIScene* loadedScene;
+    UILayout* layout;
+    UIScrollList* list;
+    char* labels;
+    ScreenTransform transform;
+    EcsWorld* world;
+    EcsComponent position;
+    EcsComponent velocity;
+    EcsComponent health;
+    EcsComponent summoned;
+    EcsQuery* movers;
+    EcsEntity* units;
+    EcsCommands commands;
+} BenchScene;
+
+typedef void (*BenchFrameFn)(BenchScene* bench, int frame);
+
+static UITextureRegion benchIcons[BENCH_ICON_COUNT];
+
+// -----------------------------------------------------------------------------
+
+static double GetMicros()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec * 1e-3;
+}
+
+static int CompareDoubles(const void* a, const void* b)
+{
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+// Alternates between two window sizes so every frame does a real resize.
+static ScreenTransform GetBenchTransform(int frame)
+{
+    int w = (frame & 1) ? 1920 : 1280;
+    int h = (frame & 1) ? 1080 : 720;
+    return GetScreenTransform(w, h, DESIGN_WIDTH, DESIGN_HEIGHT);
+}
+
+// -----------------------------------------------------------------------------
+
+static void BindBenchListRow(void* user, size_t item, UIElement* row)
+{
+    BenchScene* bench = (BenchScene*)user;
+    row->kind = UI_BUTTON;
+    row->text = (UIText) { bench->labels + item * 32, 8 };
+    row->textAlign = (UIAlign) { H_LEFT, V_CENTER, 4, 0, 0, 0 };
+}
+
+static bool FindBenchIcon(void* user, const char* name, UITextureRegion* out)
+{
+    (void)user;
+    int icon = atoi(name + 4);
+    if (strncmp(name, "icon", 4) != 0 || icon < 0 || icon >= BENCH_ICON_COUNT)
+        return false;
+
+    *out = benchIcons[icon];
+    return true;
+}
+
+// Lays count elements out on a grid in design space, cycling through
+// labels, buttons and textured buttons. The same elements are compiled
+// into BENCH_SCENE_PATH, and with the first label edited into
+// BENCH_EDITED_SCENE_PATH.
+static void CreateBenchScene(BenchScene* bench, size_t count)
+{
+    memset(bench, 0, sizeof(BenchScene));
+    bench->count = count;
+    bench->handles = (UIHandle*)malloc(count * sizeof(UIHandle));
+    bench->transformed = (UIElement*)calloc(count, sizeof(UIElement));
+    bench->labels = (char*)malloc(count * 32);
+    bench->scene = CreateUIScene();
+    bench->layout = CreateUILayout();
+
+    size_t cols = 1;
+    while (cols * cols < count)
+        ++cols;
+    float cellw = (float)DESIGN_WIDTH / cols;
+    float cellh = (float)DESIGN_HEIGHT / cols;
+    UIAlign align = { H_CENTER, V_CENTER, 2, 2, 2, 2 };
+    UIStyleId style = InternUIStyle(WARMAGIC_STYLE);
+
+    // The same grid as a column of flex rows, so layout has real work.
+    UILayoutId root = AddUILayoutNode(bench->layout, UILAYOUT_NONE, UI_LAYOUT_COLUMN);
+    UILayoutId row = UILAYOUT_NONE;
+
+    char* source = (char*)malloc((count + 1) * BENCH_SCENE_LINE_MAX);
+    size_t length = (size_t)snprintf(
+        source, BENCH_SCENE_LINE_MAX, "style s bg=#000000ff border=4 border-color=#701f7eff font=#c87affff\n");
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        float x = (i % cols) * cellw;
+        float y = (i / cols) * cellh;
+        UIRect rect = { x, y, x + cellw, y + cellh };
+        char* label = bench->labels + i * 32;
+        snprintf(label, 32, "Item %zu\nLvl %zu", i, i % 50);
+
+        const char* kind = "static";
+        if (i % 3 == 0)
+        {
+            bench->handles[i] = CreateLabel(rect, label, 8, align, style);
+        }
+        else if (i % 3 == 1)
+        {
+            bench->handles[i] = CreateButton(rect, label, 8, align, style);
+            kind = "button";
+        }
+        else
+        {
+            bench->handles[i] = CreateButtonWithTextureAndText(
+                rect, label, 8, align, rect, benchIcons[i % BENCH_ICON_COUNT], style);
+            kind = "button";
+        }
+
+        length += (size_t)snprintf(
+            source + length, BENCH_SCENE_LINE_MAX,
+            "%s e%zu %g %g %g %g style=s text=\"Item %zu\\nLvl %zu\" size=8 align=center,center margins=2,2,2,2",
+            kind, i, rect.left, rect.top, rect.right, rect.bottom, i, i % 50);
+        if (i % 3 == 2)
+            length += (size_t)snprintf(source + length, BENCH_SCENE_LINE_MAX, " texture=icon%zu", i % BENCH_ICON_COUNT);
+        source[length++] = '\n';
+        source[length] = '\0';
+
+        UISceneId id = InsertIntoUIScene(bench->scene, GetUIElement(bench->handles[i]));
+        if (i % cols == 0)
+        {
+            row = AddUILayoutNode(bench->layout, root, UI_LAYOUT_ROW);
+            SetUILayoutFlex(bench->layout, row, 0, 1, 0);
+        }
+        UILayoutId cell = AddUILayoutNode(bench->layout, row, UI_LAYOUT_ANCHOR);
+        SetUILayoutFlex(bench->layout, cell, 0, 1, 0);
+        BindUILayoutElement(bench->layout, cell, id);
+    }
+
+    // A list with one item per element, shown 20 rows at a time over the
+    // grid, so scrolling has to keep its rows above it.
+    bench->list = CreateUIScrollList(
+        bench->scene, (UIRect) { 100, 100, 400, 500 }, 20, count, style,
+        BindBenchListRow, bench);
+
+    char error[256];
+    if (!CompileUIScene(source, BENCH_SCENE_PATH, error, sizeof(error)))
+        fprintf(stderr, "%s\n", error);
+    memcpy(strstr(source, "Item 0"), "Edit 0", 6);
+    if (!CompileUIScene(source, BENCH_EDITED_SCENE_PATH, error, sizeof(error)))
+        fprintf(stderr, "%s\n", error);
+    free(source);
+    bench->loadedScene = LoadUIScene(BENCH_SCENE_PATH, FindBenchIcon, NULL);
+
+    // A battle's worth of units spread over a few archetypes, as summons
+    // and units without health would be.
+    bench->world = CreateEcsWorld();
+    bench->position = RegisterEcsComponent(bench->world, sizeof(UIPoint));
+    bench->velocity = RegisterEcsComponent(bench->world, sizeof(UIPoint));
+    bench->health = RegisterEcsComponent(bench->world, sizeof(float));
+    bench->summoned = RegisterEcsComponent(bench->world, 0);
+    bench->movers = GetEcsQuery(
+        bench->world, ECS_MASK(bench->position) | ECS_MASK(bench->velocity), 0);
+    bench->units = (EcsEntity*)malloc(count * sizeof(EcsEntity));
+    for (size_t i = 0; i < count; ++i)
+    {
+        EcsEntity unit = CreateEcsEntity(bench->world);
+        AddEcsComponent(bench->world, unit, bench->position, &(UIPoint) { (float)i, 0 });
+        AddEcsComponent(bench->world, unit, bench->velocity, &(UIPoint) { 1, 2 });
+        if (i % 4 != 0)
+            AddEcsComponent(bench->world, unit, bench->health, &(float) { 100 });
+        if (i % 3 == 0)
+            AddEcsComponent(bench->world, unit, bench->summoned, NULL);
+        bench->units[i] = unit;
+    }
+
+    SetUISceneTransform(bench->scene, GetBenchTransform(0));
+    UpdateUILayout(bench->layout, bench->scene, (UIRect) { 0, 0, DESIGN_WIDTH, DESIGN_HEIGHT });
+    for (size_t i = 0; i < count; ++i)
+        ScreenTransformUIElement(GetUIElement(bench->handles[i]), GetBenchTransform(0), &bench->transformed[i]);
+}
+
+static void DeleteBenchScene(BenchScene* bench)
+{
+    for (size_t i = 0; i < bench->count; ++i)
+    {
+        FreeUITextLayout(&bench->transformed[i].textLayout);
+        DeleteUIElement(bench->handles[i]);
+    }
+
+    DeleteUIScrollList(bench->list);
+    DeleteUILayout(bench->layout);
+    DeleteUIScene(bench->scene);
+    if (bench->loadedScene != NULL)
+        DeleteUIScene(bench->loadedScene);
+    free(bench->handles);
+    free(bench->transformed);
+    free(bench->labels);
+    free(bench->units);
+    FreeEcsCommands(&bench->commands);
+    DeleteEcsWorld(bench->world);
+    remove(BENCH_SCENE_PATH);
+    remove(BENCH_EDITED_SCENE_PATH);
+}
+
+// -----------------------------------------------------------------------------
+
+static void BenchScreenTransformUIElement(BenchScene* bench, int frame)
+{
+    ScreenTransform t = GetBenchTransform(frame);
+    for (size_t i = 0; i < bench->count; ++i)
+        ScreenTransformUIElement(GetUIElement(bench->handles[i]), t, &bench->transformed[i]);
+}
+
+static void TransformBenchRange(void* data, size_t start, size_t end)
+{
+    BenchScene* bench = (BenchScene*)data;
+    for (size_t i = start; i < end; ++i)
+        ScreenTransformUIElement(GetUIElement(bench->handles[i]), bench->transform, &bench->transformed[i]);
+}
+
+static void BenchScreenTransformUIElementJobs(BenchScene* bench, int frame)
+{
+    bench->transform = GetBenchTransform(frame);
+    RunJobsForRange(TransformBenchRange, bench, bench->count, BENCH_JOB_BATCH);
+}
+
+static void BenchMoveEcsUnits(BenchScene* bench, int frame)
+{
+    (void)frame;
+    EcsIter it = IterateEcsQuery(bench->world, bench->movers);
+    while (NextEcsChunk(&it))
+    {
+        UIPoint* position = (UIPoint*)GetEcsColumn(&it, bench->position);
+        const UIPoint* velocity = (const UIPoint*)GetEcsColumn(&it, bench->velocity);
+        for (uint32_t i = 0; i < it.count; ++i)
+        {
+            position[i].x += velocity[i].x * (1.0f / 60);
+            position[i].y += velocity[i].y * (1.0f / 60);
+        }
+    }
+}
+
+// Replaces one unit in BENCH_CHURN_DIVISOR with a new one each frame, as
+// summons come and go.
+static void BenchRunEcsCommands(BenchScene* bench, int frame)
+{
+    for (size_t i = (size_t)frame % BENCH_CHURN_DIVISOR; i < bench->count; i += BENCH_CHURN_DIVISOR)
+    {
+        QueueDestroyEcsEntity(&bench->commands, bench->units[i]);
+        EcsEntity unit = ReserveEcsEntity(bench->world);
+        QueueAddEcsComponent(&bench->commands, bench->world, unit, bench->position, &(UIPoint) { (float)i, 0 });
+        QueueAddEcsComponent(&bench->commands, bench->world, unit, bench->velocity, &(UIPoint) { 1, 2 });
+        QueueAddEcsComponent(&bench->commands, bench->world, unit, bench->summoned, NULL);
+        bench->units[i] = unit;
+    }
+    RunEcsCommands(&bench->commands, bench->world);
+}
+
+static void BenchGetUITextSize(BenchScene* bench, int frame)
+{
+    volatile float sink = 0;
+    for (size_t i = 0; i < bench->count; ++i)
+        sink += GetUITextSize(bench->transformed[i].text).w;
+    (void)frame;
+}
+
+static void BenchDrawUIText(BenchScene* bench, int frame)
+{
+    for (size_t i = 0; i < bench->count; ++i)
+    {
+        const UIElement* elem = &bench->transformed[i];
+        DrawUIText(elem->rect, elem->text, elem->textAlign, GetUIStyle(elem->style)->fontColor);
+    }
+    (void)frame;
+}
+
+// Wrapped and cut to fit, in rects that change width every frame, as
+// while the window is being resized.
+static void BenchDrawUITextWrap(BenchScene* bench, int frame)
+{
+    ScreenTransform t = GetBenchTransform(frame);
+    for (size_t i = 0; i < bench->count; ++i)
+    {
+        const UIElement* elem = GetUIElement(bench->handles[i]);
+        UIAlign align = elem->textAlign;
+        align.flow = UI_TEXT_WRAP | UI_TEXT_ELLIPSIS;
+        DrawUIText(
+            ScreenTransformUIRect(elem->rect, t), ScreenTransformUIText(elem->text, t),
+            align, GetUIStyle(elem->style)->fontColor);
+    }
+}
+
+static void BenchDrawUIElement(BenchScene* bench, int frame)
+{
+    for (size_t i = 0; i < bench->count; ++i)
+        DrawUIElement(&bench->transformed[i]);
+    (void)frame;
+}
+
+static void BenchSetUISceneTransform(BenchScene* bench, int frame)
+{
+    SetUISceneTransform(bench->scene, GetBenchTransform(frame));
+}
+
+static void BenchUpdateUILayoutResize(BenchScene* bench, int frame)
+{
+    float w = (frame & 1) ? DESIGN_WIDTH * 1.5f : DESIGN_WIDTH;
+    UpdateUILayout(bench->layout, bench->scene, (UIRect) { 0, 0, w, DESIGN_HEIGHT });
+}
+
+// Regrows one cell, which only re-arranges the row it sits in.
+static void BenchUpdateUILayoutOne(BenchScene* bench, int frame)
+{
+    UILayoutId cell = (UILayoutId)(bench->layout->count - 1);
+    SetUILayoutFlex(bench->layout, cell, 0, (frame & 1) ? 2.0f : 1.0f, 0);
+    UpdateUILayout(bench->layout, bench->scene, GetUILayoutRect(bench->layout, bench->layout->root));
+}
+
+// Scrolls by a fraction of a row per frame, bouncing between the ends.
+static void BenchScrollUIScrollList(BenchScene* bench, int frame)
+{
+    static float direction = 1.0f;
+    float before = bench->list->scroll;
+    ScrollUIScrollList(bench->list, direction * 7.0f);
+    if (bench->list->scroll == before)
+        direction = -direction;
+
+    ComposeUIScene(bench->scene, DARKGRAY);
+    (void)frame;
+}
+
+static void BenchDrawUIScene(BenchScene* bench, int frame)
+{
+    DrawUIScene(bench->scene);
+    (void)frame;
+}
+
+// Every resize moves every element on screen, but not in the draw list.
+static void BenchDrawUISceneResize(BenchScene* bench, int frame)
+{
+    SetUISceneTransform(bench->scene, GetBenchTransform(frame));
+    DrawUIScene(bench->scene);
+}
+
+static void BenchComposeHover(BenchScene* bench, int frame)
+{
+    UISize screen = GetUIBackendScreenSize();
+    UIPoint mouse = { (frame * 37) % (int)screen.w, (frame * 23) % (int)screen.h };
+    UpdateUISceneHover(bench->scene, mouse);
+    ComposeUIScene(bench->scene, DARKGRAY);
+}
+
+// Building a scene element by element, as main.c used to at startup.
+static void BenchInsertIntoUIScene(BenchScene* bench, int frame)
+{
+    UIScene* scene = CreateUIScene();
+    for (size_t i = 0; i < bench->count; ++i)
+        InsertIntoUIScene(scene, GetUIElement(bench->handles[i]));
+    DeleteUIScene(scene);
+    (void)frame;
+}
+
+static void BenchLoadUIScene(BenchScene* bench, int frame)
+{
+    UIScene* scene = LoadUIScene(BENCH_SCENE_PATH, FindBenchIcon, NULL);
+    if (scene != NULL)
+        DeleteUIScene(scene);
+    (void)frame;
+}
+
+// Saving a scene file with one label changed, back and forth.
+static void BenchReloadUIScene(BenchScene* bench, int frame)
+{
+    const char* path = (frame & 1) ? BENCH_EDITED_SCENE_PATH : BENCH_SCENE_PATH;
+    if (bench->loadedScene != NULL)
+        ReloadUIScene(bench->loadedScene, path, FindBenchIcon, NULL);
+}
+
+static void BenchPickUIScene(BenchScene* bench, int frame)
+{
+    volatile UISceneId sink = 0;
+    UISize screen = GetUIBackendScreenSize();
+    for (int i = 0; i < BENCH_PICKS_PER_FRAME; ++i)
+    {
+        uint32_t k = (uint32_t)frame * BENCH_PICKS_PER_FRAME + (uint32_t)i;
+        UIPoint p = { (float)(k * 7919u % (uint32_t)screen.w), (float)(k * 104729u % (uint32_t)screen.h) };
+        sink += PickUIScene(bench->scene, p, true);
+    }
+}
+
+// Packs blank icons of a few sizes into an atlas, as a game would at load.
+static UIAtlas* CreateBenchAtlas()
+{
+    static unsigned char pixels[64 * 64 * 4];
+    Image images[BENCH_ICON_COUNT];
+    for (int i = 0; i < BENCH_ICON_COUNT; ++i)
+    {
+        int size = 16 << (i % 3);
+        images[i] = (Image) { pixels, size, size, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+    }
+
+    UIAtlas* atlas = CreateUIAtlas(512, 2);
+    AddUIAtlasImages(atlas, images, BENCH_ICON_COUNT, benchIcons);
+    UploadUIAtlas(atlas);
+    return atlas;
+}
+
+// -----------------------------------------------------------------------------
+
+static void RunBench(const char* name, BenchScene* bench, BenchFrameFn fn)
+{
+    static double samples[BENCH_FRAMES];
+
+    // One untimed frame so lazily built caches are warm, as in a real loop.
+    BeginUIFrame();
+    fn(bench, 1);
+    for (int frame = 0; frame < BENCH_FRAMES; ++frame)
+    {
+        BeginUIFrame();
+        double start = GetMicros();
+        fn(bench, frame);
+        samples[frame] = GetMicros() - start;
+    }
+
+    qsort(samples, BENCH_FRAMES, sizeof(double), CompareDoubles);
+    printf(
+        "%-26s %8zu %12.2f %12.2f\n",
+        name,
+        bench->count,
+        samples[BENCH_FRAMES / 2],
+        samples[BENCH_FRAMES * 99 / 100]);
+}
+
+int main()
+{
+    static const size_t sizes[] = { 100, 1000, 10000 };
+
+    InitUIBackend();
+    StartJobSystem(0);
+    UIAtlas* atlas = CreateBenchAtlas();
+    printf("%-26s %8s %12s %12s\n", "benchmark", "elements", "p50 (us)", "p99 (us)");
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+        BenchScene bench;
+        CreateBenchScene(&bench, sizes[i]);
+
+        RunBench("ScreenTransformUIElement", &bench, BenchScreenTransformUIElement);
+        RunBench("ScreenTransform (jobs)", &bench, BenchScreenTransformUIElementJobs);
+        RunBench("GetUITextSize", &bench, BenchGetUITextSize);
+        RunBench("DrawUIText", &bench, BenchDrawUIText);
+        RunBench("DrawUIText (wrap, resize)", &bench, BenchDrawUITextWrap);
+        RunBench("DrawUIElement", &bench, BenchDrawUIElement);
+        RunBench("SetUISceneTransform", &bench, BenchSetUISceneTransform);
+        RunBench("UpdateUILayout (resize)", &bench, BenchUpdateUILayoutResize);
+        RunBench("UpdateUILayout (one node)", &bench, BenchUpdateUILayoutOne);
+        RunBench("ScrollUIScrollList", &bench, BenchScrollUIScrollList);
+        RunBench("DrawUIScene", &bench, BenchDrawUIScene);
+        RunBench("DrawUIScene (resize)", &bench, BenchDrawUISceneResize);
+        RunBench("ComposeUIScene (hover)", &bench, BenchComposeHover);
+        RunBench("PickUIScene x100", &bench, BenchPickUIScene);
+        RunBench("InsertIntoUIScene (all)", &bench, BenchInsertIntoUIScene);
+        RunBench("LoadUIScene", &bench, BenchLoadUIScene);
+        RunBench("ReloadUIScene (one edit)", &bench, BenchReloadUIScene);
+        RunBench("EcsQuery (movement)", &bench, BenchMoveEcsUnits);
+        RunBench("RunEcsCommands (churn)", &bench, BenchRunEcsCommands);
+
+        DeleteBenchScene(&bench);
+    }
+
+    StopJobSystem();
+    UnloadUIAtlas(atlas);
+    UnloadUIElementPool();
+    UnloadUIStyles();
+    UnloadUITextLines();
+    FreeUIFrameArena();
+    CloseUIBackend();
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include "uibackend.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ui.h"
+
+// Headless stand-in for uibackend.c. Text is measured with a fixed glyph
+// advance but still walked byte by byte, and draws land in a sink, so the
+// UI code around them does the same work it would with a window.
+
+#define NULL_GLYPH_ADVANCE 0.6f
+#define NULL_SCREEN_WIDTH 1280
+#define NULL_SCREEN_HEIGHT 720
+
+typedef struct NullBackend
+{
+    bool ready;
+    UIRect* instances;
+    size_t instanceCount;
+    size_t instanceCapacity;
+    int compositeWidth;
+    int compositeHeight;
+    unsigned int nextTextureId;
+    volatile float sink;
+} NullBackend;
+
+static NullBackend backend = { 0 };
+
+// -----------------------------------------------------------------------------
+
+void InitUIBackend()
+{
+    backend.ready = true;
+}
+
+void CloseUIBackend()
+{
+    free(backend.instances);
+    memset(&backend, 0, sizeof(NullBackend));
+}
+
+bool IsUIBackendReady()
+{
+    return backend.ready;
+}
+
+UISize GetUIBackendScreenSize()
+{
+    return (UISize) { NULL_SCREEN_WIDTH, NULL_SCREEN_HEIGHT };
+}
+
+// -----------------------------------------------------------------------------
+
+UISize MeasureUIBackendText(const char* text, size_t length, float fontSize, float spacing)
+{
+    size_t glyphs = 0;
+    for (size_t i = 0; i < length; ++i)
+    {
+        if ((text[i] & 0xC0) != 0x80)
+            ++glyphs;
+    }
+
+    if (glyphs == 0)
+        return (UISize) { 0, fontSize };
+
+    float width = glyphs * fontSize * NULL_GLYPH_ADVANCE + (glyphs - 1) * spacing;
+    return (UISize) { width, fontSize };
+}
+
+void DrawUIBackendText(const char* text, size_t length, UIPoint pos, float fontSize, float spacing, Color color)
+{
+    float x = pos.x;
+    for (size_t i = 0; i < length; ++i)
+        x += fontSize * NULL_GLYPH_ADVANCE + spacing;
+    backend.sink += x + color.a;
+}
+
+void DrawUIBackendRect(UIRect rect, Color color)
+{
+    backend.sink += rect.left + color.a;
+}
+
+void DrawUIBackendBorder(UIRect rect, float width, Color color)
+{
+    backend.sink += rect.left + width + color.a;
+}
+
+void DrawUIBackendTexture(Texture2D texture, UIRect source, UIRect dst)
+{
+    backend.sink += dst.left + source.left + texture.id;
+}
+
+Texture2D LoadUIBackendTexture(Image image)
+{
+    return (Texture2D)
+    {
+        ++backend.nextTextureId, image.width, image.height, 1, image.format
+    };
+}
+
+void UpdateUIBackendTexture(Texture2D texture, Image image)
+{
+    backend.sink += texture.id + image.width;
+}
+
+void UnloadUIBackendTexture(Texture2D texture)
+{
+    backend.sink += texture.id;
+}
+
+// -----------------------------------------------------------------------------
+
+void PushUIRectInstance(UIRect rect, Color fill, float borderWidth, Color border)
+{
+    if (backend.instanceCount == backend.instanceCapacity)
+    {
+        backend.instanceCapacity = max(backend.instanceCapacity * 2, (size_t)256);
+        backend.instances = (UIRect*)realloc(
+            backend.instances, backend.instanceCapacity * sizeof(UIRect));
+    }
+    backend.instances[backend.instanceCount++] = rect;
+    backend.sink += borderWidth + fill.a + border.a;
+}
+
+void FlushUIRectInstances()
+{
+    backend.instanceCount = 0;
+}
+
+bool ResizeUIComposite(int width, int height)
+{
+    if (backend.compositeWidth == width && backend.compositeHeight == height)
+        return false;
+
+    backend.compositeWidth = width;
+    backend.compositeHeight = height;
+    return true;
+}
+
+void BeginUIComposite()
+{
+}
+
+void EndUIComposite()
+{
+}
+
+void BeginUIClip(UIRect clip)
+{
+    backend.sink += clip.left;
+}
+
+void EndUIClip()
+{
+}
+
+void ClearUIBackend(Color color)
+{
+    backend.sink += color.a;
+}
+
+void DrawUIComposite()
+{
+}
@@ -0,0 +1,633 @@
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "battle.h"
+#include "ecs.h"
+#include "game.h"
+#include "job.h"
+#include "ui.h"
+#include "uibackend.h"
+
+// Behavior checks for the parts of the game that run headless. Prints each
+// failed check and exits non-zero if there were any.
+
+#define CHECK(cond) Check((cond), #cond, __FILE__, __LINE__)
+#define CHECK_ERROR_SIZE 256
+#define CHECK_SCENE_PATH "warmagic-check.uis"
+
+static int failures = 0;
+
+static void Check(bool ok, const char* what, const char* file, int line)
+{
+    if (!ok)
+    {
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+        ++failures;
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+static void CheckInterpolateGameState()
+{
+    GameState prev;
+    InitGameState(&prev);
+    GameState next;
+    UpdateGameState(&prev, &next);
+
+    GameState out;
+    InterpolateGameState(&prev, &next, 0.25f, &out);
+    CHECK(out.tick == next.tick);
+    CHECK(out.time > prev.time && out.time < next.time);
+
+    InterpolateGameState(&prev, &next, 0.0f, &out);
+    CHECK(out.tick == next.tick);
+    CHECK(out.time == prev.time);
+
+    InterpolateGameState(&prev, &next, 1.0f, &out);
+    CHECK(out.tick == next.tick);
+    CHECK(out.time == next.time);
+}
+
+static void CountJob(void* data)
+{
+    atomic_fetch_add((atomic_uint*)data, 1);
+}
+
+static void CheckJobSystem()
+{
+    StartJobSystem(2);
+    uint32_t threadCount = GetJobThreadCount();
+    StartJobSystem(5);
+    CHECK(GetJobThreadCount() == threadCount);
+
+    atomic_uint ran = 0;
+    Job jobs[3] = {
+        { CountJob, &ran, 0, NULL },
+        { CountJob, &ran, JOB_MAIN_THREAD, NULL },
+        { CountJob, &ran, 0, NULL },
+    };
+    JobCounter counter = { 0 };
+    RunJobs(jobs, 3, &counter);
+    WaitForJobCounter(&counter);
+    CHECK(atomic_load(&ran) == 3);
+    CHECK(!RunMainThreadJobs());
+
+    RunJobs(&jobs[1], 1, &counter);
+    CHECK(RunMainThreadJobs());
+    CHECK(atomic_load(&ran) == 4);
+    CHECK(atomic_load(&counter.pending) == 0);
+    StopJobSystem();
+}
+
+#define CHECK_ECS_ENTITIES 2000
+
+typedef struct CheckPosition
+{
+    float x;
+    float y;
+} CheckPosition;
+
+// Whether entity i of CheckEcsWorld has the position and health it was
+// given, and health only if it should.
+static bool HasCheckEcsValues(EcsWorld* world, EcsEntity entity, uint32_t i, bool health)
+{
+    const CheckPosition* position = (const CheckPosition*)GetEcsComponent(world, entity, 0);
+    const int32_t* hp = (const int32_t*)GetEcsComponent(world, entity, 1);
+    return
+           position != NULL && position->x == (float)i && position->y == -(float)i
+        && (health ? hp != NULL && *hp == (int32_t)i : hp == NULL);
+}
+
+static uint32_t CountEcsQuery(EcsWorld* world, EcsMask all, EcsMask none)
+{
+    uint32_t count = 0;
+    EcsIter it = IterateEcsQuery(world, GetEcsQuery(world, all, none));
+    while (NextEcsChunk(&it))
+        count += it.count;
+    return count;
+}
+
+// Enough entities to fill several chunks, destroyed and changed out of
+// order so rows get moved from the ends of chunks into the holes.
+static void CheckEcsWorld()
+{
+    EcsWorld* world = CreateEcsWorld();
+    EcsComponent position = RegisterEcsComponent(world, sizeof(CheckPosition));
+    EcsComponent health = RegisterEcsComponent(world, sizeof(int32_t));
+    CHECK(position == 0 && health == 1);
+
+    static EcsEntity entities[CHECK_ECS_ENTITIES];
+    for (uint32_t i = 0; i < CHECK_ECS_ENTITIES; ++i)
+    {
+        entities[i] = CreateEcsEntity(world);
+        CheckPosition p = { (float)i, -(float)i };
+        int32_t hp = (int32_t)i;
+        AddEcsComponent(world, entities[i], position, &p);
+        AddEcsComponent(world, entities[i], health, &hp);
+    }
+    uint32_t archetypeCount = world->archetypeCount;
+    CHECK(world->archetypes[world->records[entities[0].index].archetype].chunkCount > 2);
+
+    for (uint32_t i = 0; i < CHECK_ECS_ENTITIES; i += 3)
+        DestroyEcsEntity(world, entities[i]);
+    for (uint32_t i = 1; i < CHECK_ECS_ENTITIES; i += 5)
+        RemoveEcsComponent(world, entities[i], health);
+
+    // New rows overwrite whatever was left past the ends of the chunks.
+    uint32_t added = 0;
+    for (; added < CHECK_ECS_ENTITIES / 3; ++added)
+    {
+        EcsEntity entity = CreateEcsEntity(world);
+        CheckPosition p = { -1, -1 };
+        int32_t hp = -1;
+        AddEcsComponent(world, entity, position, &p);
+        AddEcsComponent(world, entity, health, &hp);
+    }
+
+    bool valuesKept = true;
+    uint32_t alive = 0;
+    uint32_t healthy = 0;
+    for (uint32_t i = 0; i < CHECK_ECS_ENTITIES; ++i)
+    {
+        if (i % 3 == 0)
+        {
+            CHECK(!IsEcsEntityAlive(world, entities[i]));
+            continue;
+        }
+        ++alive;
+        healthy += i % 5 != 1;
+        valuesKept &= HasCheckEcsValues(world, entities[i], i, i % 5 != 1);
+    }
+    CHECK(valuesKept);
+    CHECK(CountEcsQuery(world, ECS_MASK(position) | ECS_MASK(health), 0) == healthy + added);
+    CHECK(CountEcsQuery(world, ECS_MASK(position), ECS_MASK(health)) == alive - healthy);
+
+    // Round trips through the cached edges come back to the same
+    // archetypes and create no new ones.
+    uint32_t archetype = world->records[entities[2].index].archetype;
+    for (int round = 0; round < 3; ++round)
+    {
+        RemoveEcsComponent(world, entities[2], health);
+        int32_t hp = 2;
+        AddEcsComponent(world, entities[2], health, &hp);
+    }
+    CHECK(world->records[entities[2].index].archetype == archetype);
+    CHECK(HasCheckEcsValues(world, entities[2], 2, true));
+    CHECK(world->archetypeCount == archetypeCount);
+
+    // A destroyed entity's handle stays dead after its slot is reused.
+    EcsEntity stale = entities[4];
+    DestroyEcsEntity(world, stale);
+    EcsEntity reused = CreateEcsEntity(world);
+    CHECK(reused.index == stale.index && reused.generation != stale.generation);
+    CHECK(!IsEcsEntityAlive(world, stale));
+    CHECK(GetEcsComponent(world, stale, position) == NULL);
+    CHECK(AddEcsComponent(world, stale, position, NULL) == NULL);
+    DestroyEcsEntity(world, stale);
+    CHECK(IsEcsEntityAlive(world, reused));
+    CHECK(!HasEcsComponent(world, reused, position));
+
+    DeleteEcsWorld(world);
+}
+
+// Commands for several entities, reserved ones among them, interleaved
+// and run in one go.
+static void CheckEcsCommands()
+{
+    EcsWorld* world = CreateEcsWorld();
+    EcsComponent position = RegisterEcsComponent(world, sizeof(CheckPosition));
+    EcsComponent health = RegisterEcsComponent(world, sizeof(int32_t));
+    CheckPosition p = { 1, -1 };
+    int32_t hp = 1;
+
+    EcsEntity kept = CreateEcsEntity(world);
+    AddEcsComponent(world, kept, position, &p);
+    AddEcsComponent(world, kept, health, &hp);
+    EcsEntity doomed = CreateEcsEntity(world);
+    AddEcsComponent(world, doomed, position, &p);
+
+    EcsEntity reserved = ReserveEcsEntity(world);
+    EcsEntity fleeting = ReserveEcsEntity(world);
+    CHECK(IsEcsEntityAlive(world, reserved));
+    CHECK(!HasEcsComponent(world, reserved, position));
+    CHECK(CountEcsQuery(world, 0, 0) == 2);
+
+    EcsCommands commands = { 0 };
+    CheckPosition q = { 3, -3 };
+    int32_t hq = 3;
+    QueueAddEcsComponent(&commands, world, reserved, position, &q);
+    QueueAddEcsComponent(&commands, world, reserved, health, &hq);
+    QueueRemoveEcsComponent(&commands, kept, health);
+    QueueDestroyEcsEntity(&commands, doomed);
+    QueueAddEcsComponent(&commands, world, doomed, health, &hq);
+    QueueAddEcsComponent(&commands, world, fleeting, position, NULL);
+    QueueDestroyEcsEntity(&commands, fleeting);
+    QueueAddEcsComponent(&commands, world, kept, health, NULL);
+    QueueRemoveEcsComponent(&commands, reserved, health);
+    // Values are copied when queued, not when run.
+    q.x = 0;
+    RunEcsCommands(&commands, world);
+
+    CHECK(HasCheckEcsValues(world, reserved, 3, false));
+    const CheckPosition* keptPosition = (const CheckPosition*)GetEcsComponent(world, kept, position);
+    const int32_t* keptHealth = (const int32_t*)GetEcsComponent(world, kept, health);
+    CHECK(keptPosition != NULL && keptPosition->x == 1 && keptPosition->y == -1);
+    CHECK(keptHealth != NULL && *keptHealth == 0);
+    CHECK(!IsEcsEntityAlive(world, doomed));
+    CHECK(!IsEcsEntityAlive(world, fleeting));
+    CHECK(CountEcsQuery(world, ECS_MASK(position), 0) == 2);
+    CHECK(commands.count == 0 && commands.valueSize == 0);
+
+    FreeEcsCommands(&commands);
+    DeleteEcsWorld(world);
+}
+
+// Parses source, which should fail with an error containing expected.
+static void CheckBattleSetupError(const char* source, const char* expected)
+{
+    static BattleSetup setup;
+    char error[CHECK_ERROR_SIZE] = { 0 };
+    bool ok = ParseBattleSetup(source, &setup, error, sizeof(error));
+    CHECK(!ok);
+    if (strstr(error, expected) == NULL)
+    {
+        fprintf(stderr, "expected \"%s\", got \"%s\"\n", expected, error);
+        CHECK(strstr(error, expected) != NULL);
+    }
+}
+
+static void CheckParseBattleSetup()
+{
+    static BattleSetup setup;
+    char error[CHECK_ERROR_SIZE] = { 0 };
+    CHECK(ParseBattleSetup(
+        "# comment\n\nspell bolt strike power=4 cost=2\nitem cap defense=1\n"
+        "party mage health=10 spells=bolt gear=cap\nenemy rat health=3\n",
+        &setup, error, sizeof(error)));
+    CHECK(setup.unitCounts[BATTLE_PARTY] == 1 && setup.unitCounts[BATTLE_ENEMY] == 1);
+    CHECK(setup.units[BATTLE_PARTY][0].defense == 1 && setup.units[BATTLE_PARTY][0].spellCount == 1);
+
+    CheckBattleSetupError("cast bolt\n", "line 1: unknown command cast");
+    CheckBattleSetupError("\nspell bolt\n", "line 2: spell needs a name and a kind");
+    CheckBattleSetupError("spell bolt fire power=1\n", "unknown spell kind fire");
+    CheckBattleSetupError("spell bolt strike cost=1\n", "spell bolt needs a power");
+    CheckBattleSetupError("spell bolt strike power=x\n", "bad spell attribute power=x");
+    CheckBattleSetupError("spell a strike power=1\nspell a heal power=1\n", "line 2: spell a is already defined");
+    CheckBattleSetupError("item cap luck=1\n", "bad item attribute luck=1");
+    CheckBattleSetupError("party mage health=2000000\n", "bad unit attribute health=2000000");
+    CheckBattleSetupError("party mage health=5 spells=bolt\n", "unknown spell bolt");
+    CheckBattleSetupError("party mage health=5 gear=cap\n", "unknown item cap");
+    CheckBattleSetupError("party mage mana=5\n", "unit mage needs health");
+    CheckBattleSetupError("party abcdefghijabcdefghijabcdefghijab health=1\n", "names must be 1 to 31 characters");
+    CheckBattleSetupError("party mage health=5\n", "needs at least one party member and one enemy");
+}
+
+#define CHECK_BATTLES 3000
+#define CHECK_BATTLE_BATCHES 7
+
+// Plays the same seeded battles front to back into one set of stats, and
+// back to front in uneven batches merged in reverse, which should give
+// the same stats to the bit.
+static void CheckBattleReproducible()
+{
+    static BattleSetup setup;
+    char error[CHECK_ERROR_SIZE] = { 0 };
+    CHECK(ParseBattleSetup(
+        "spell fireball area power=12 cost=10\nspell bolt strike power=20 cost=6\n"
+        "spell mend heal power=18 cost=8\n"
+        "party knight health=120 attack=14 defense=8 speed=8\n"
+        "party mage health=60 mana=40 attack=4 defense=2 speed=11 magic=6 spells=fireball,bolt\n"
+        "party cleric health=80 mana=30 attack=8 defense=4 speed=9 spells=mend,bolt\n"
+        "enemy goblin health=45 attack=13 defense=3 speed=12\n"
+        "enemy shaman health=50 mana=30 attack=6 defense=2 speed=10 magic=3 spells=bolt,mend\n"
+        "enemy ogre health=140 attack=22 defense=6 speed=5\n",
+        &setup, error, sizeof(error)));
+
+    static BattleStats inOrder;
+    memset(&inOrder, 0, sizeof(BattleStats));
+    for (uint64_t i = 0; i < CHECK_BATTLES; ++i)
+        RunBattle(&setup, GetBattleSeed(17, i), &inOrder);
+    CHECK(inOrder.battles == CHECK_BATTLES);
+    CHECK(inOrder.wins > 0 && inOrder.losses > 0);
+
+    // Batch b takes b + 1 hundred battles off the end, the last the rest.
+    static BattleStats batches[CHECK_BATTLE_BATCHES];
+    memset(batches, 0, sizeof(batches));
+    uint64_t end = CHECK_BATTLES;
+    for (int b = 0; b < CHECK_BATTLE_BATCHES; ++b)
+    {
+        uint64_t start = b + 1 < CHECK_BATTLE_BATCHES ? end - (uint64_t)(b + 1) * 100 : 0;
+        for (uint64_t i = end; i > start; --i)
+            RunBattle(&setup, GetBattleSeed(17, i - 1), &batches[b]);
+        end = start;
+    }
+
+    static BattleStats merged;
+    memset(&merged, 0, sizeof(BattleStats));
+    for (int b = CHECK_BATTLE_BATCHES; b > 0; --b)
+        MergeBattleStats(&merged, &batches[b - 1]);
+    CHECK(memcmp(&merged, &inOrder, sizeof(BattleStats)) == 0);
+}
+
+// Compiles source, which should fail with an error containing expected.
+static void CheckUISceneError(const char* source, const char* expected)
+{
+    char error[CHECK_ERROR_SIZE] = { 0 };
+    bool ok = CompileUIScene(source, CHECK_SCENE_PATH, error, sizeof(error));
+    CHECK(!ok);
+    if (strstr(error, expected) == NULL)
+    {
+        fprintf(stderr, "expected \"%s\", got \"%s\"\n", expected, error);
+        CHECK(strstr(error, expected) != NULL);
+    }
+}
+
+static void CheckCompileUIScene()
+{
+    CheckUISceneError("box a 0 0 1 1 style=s\n", "line 1: unknown command box");
+    CheckUISceneError("style\n", "style needs a name");
+    CheckUISceneError("style s bg=#12345\n", "bad style attribute bg=#12345");
+    CheckUISceneError("style s\nstyle s\n", "line 2: style s is already defined");
+    CheckUISceneError("clip c 0 0 1\n", "clip needs left, top, right and bottom");
+    CheckUISceneError("clip c 0 0 1 1 2\n", "unexpected 2");
+    CheckUISceneError("style s\nstatic a 0 0 x 1 style=s\n", "element needs left, top, right and bottom");
+    CheckUISceneError("static a 0 0 1 1\n", "element a needs a style");
+    CheckUISceneError("static a 0 0 1 1 style=t\n", "bad attribute style=t");
+    CheckUISceneError("style s\nstatic a 0 0 1 1 style=s align=up,top\n", "bad attribute align=up,top");
+    CheckUISceneError("style s\nstatic a 0 0 1 1 style=s text=\"open\n", "bad attribute text=\"open");
+    CheckUISceneError(
+        "style s\nstatic a 0 0 1 1 style=s\n\nstatic a 0 0 1 1 style=s\n", "line 4: key a is already used");
+}
+
+// -----------------------------------------------------------------------------
+
+#define CHECK_UI_ROUNDS 6
+#define CHECK_UI_ELEMENTS 120
+#define CHECK_UI_EDITS 200
+#define CHECK_UI_CLIPS 3
+#define CHECK_UI_STACK (UIDRAW_MAX_LAYER + 8)
+
+static char checkLabels[][32] = { "Ok", "Label", "A longer label\nover two lines" };
+static uint32_t checkRandom = 17;
+
+static uint32_t GetCheckRandom(uint32_t count)
+{
+    checkRandom ^= checkRandom << 13;
+    checkRandom ^= checkRandom >> 17;
+    checkRandom ^= checkRandom << 5;
+    return checkRandom % count;
+}
+
+static float GetCheckRandomFloat(float low, float high)
+{
+    return low + (high - low) * (float)GetCheckRandom(1024) / 1024.0f;
+}
+
+static UIRect GetCheckRandomRect(float width, float height)
+{
+    float x = GetCheckRandomFloat(0.0f, 700.0f);
+    float y = GetCheckRandomFloat(0.0f, 500.0f);
+    return (UIRect) { x, y, x + GetCheckRandomFloat(5.0f, width), y + GetCheckRandomFloat(5.0f, height) };
+}
+
+static UIElement GetCheckElement(UIStyleId style, UIRect rect)
+{
+    UIElement elem;
+    memset(&elem, 0, sizeof(UIElement));
+    elem.rect = rect;
+    elem.style = style;
+    elem.scale = 1.0f;
+    elem.kind = UI_BUTTON;
+    return elem;
+}
+
+static UIElement GetCheckRandomElement(UIStyleId style)
+{
+    UIElement elem = GetCheckElement(style, GetCheckRandomRect(120.0f, 80.0f));
+    if (GetCheckRandom(2) == 0)
+    {
+        elem.hasText = true;
+        elem.text = (UIText) { checkLabels[GetCheckRandom(3)], GetCheckRandomFloat(6.0f, 20.0f) };
+        elem.textAlign = (UIAlign) { H_CENTER, V_CENTER, 2, 2, 2, 2 };
+    }
+    if (GetCheckRandom(3) == 0)
+    {
+        elem.hasTexture = true;
+        elem.texture.texture.id = 1 + GetCheckRandom(4);
+        elem.texture.source = (UIRect) { 0, 0, 16, 16 };
+        elem.textureRect = (UIRect) { elem.rect.left, elem.rect.top, elem.rect.left + 16, elem.rect.top + 16 };
+    }
+    return elem;
+}
+
+// A sorted list that edits kept up to date should hold the items a list
+// built from scratch does, sorted by key, with the items of overlapping
+// slots in slot order. Layers may be higher, as edits only raise them.
+static void CheckUISceneDrawList(UIScene* scene)
+{
+    UIDrawList* list = &scene->drawList;
+    if (!list->valid)
+        return;
+
+    CHECK(list->slotCount == scene->size);
+    bool ordered = true;
+    for (size_t i = 1; i < list->count; ++i)
+    {
+        const UIDrawItem* a = &list->items[i - 1];
+        const UIDrawItem* b = &list->items[i];
+        ordered = ordered && (a->key < b->key || (a->key == b->key && a->slot < b->slot));
+    }
+    for (size_t i = 0; i < list->count && ordered; ++i)
+    {
+        for (size_t j = i + 1; j < list->count && ordered; ++j)
+        {
+            const UIDrawItem* a = &list->items[i];
+            const UIDrawItem* b = &list->items[j];
+            if (OverlapsUIRect(a->bounds, b->bounds))
+                ordered = a->slot < b->slot || (a->slot == b->slot && a->shader < b->shader);
+        }
+    }
+    CHECK(ordered);
+
+    UIDrawList kept = *list;
+    memset(list, 0, sizeof(UIDrawList));
+    BeginUIFrame();
+    DrawUIScene(scene);
+    UIDrawList fresh = *list;
+    *list = kept;
+
+    size_t* at = (size_t*)malloc(max(kept.slotCount, (size_t)1) * UI_DRAW_SHADER_COUNT * sizeof(size_t));
+    for (size_t i = 0; i < kept.slotCount * UI_DRAW_SHADER_COUNT; ++i)
+        at[i] = SIZE_MAX;
+    for (size_t i = 0; i < kept.count; ++i)
+        at[kept.items[i].slot * UI_DRAW_SHADER_COUNT + kept.items[i].shader] = i;
+
+    bool same = fresh.count == kept.count;
+    for (size_t i = 0; i < fresh.count && same; ++i)
+    {
+        const UIDrawItem* item = &fresh.items[i];
+        size_t k = item->slot < kept.slotCount ? at[item->slot * UI_DRAW_SHADER_COUNT + item->shader] : SIZE_MAX;
+        same = k != SIZE_MAX && memcmp(&kept.items[k].bounds, &item->bounds, sizeof(UIRect)) == 0;
+    }
+    CHECK(same);
+    free(at);
+    FreeUIDrawList(&fresh);
+}
+
+// Random inserts, moves, clip changes and deletes, each checked against
+// a list built from scratch.
+static void CheckUISceneEdits(UIStyleId style)
+{
+    for (int round = 0; round < CHECK_UI_ROUNDS; ++round)
+    {
+        UIScene* scene = CreateUIScene();
+        SetUISceneTransform(scene, GetScreenTransform(1280, 720, 800, 600));
+        uint32_t clips[CHECK_UI_CLIPS];
+        for (int c = 0; c < CHECK_UI_CLIPS; ++c)
+            clips[c] = AddUISceneClip(scene, GetCheckRandomRect(400.0f, 300.0f));
+
+        UISceneId ids[2 * CHECK_UI_ELEMENTS];
+        size_t count = 0;
+        for (; count < CHECK_UI_ELEMENTS; ++count)
+        {
+            UIElement elem = GetCheckRandomElement(style);
+            ids[count] = InsertIntoUIScene(scene, &elem);
+        }
+        BeginUIFrame();
+        DrawUIScene(scene);
+
+        for (int edit = 0; edit < CHECK_UI_EDITS; ++edit)
+        {
+            size_t k = count > 0 ? GetCheckRandom((uint32_t)count) : 0;
+            UIElement elem = GetCheckRandomElement(style);
+            switch (GetCheckRandom(8))
+            {
+            case 0:
+                if (count > 0)
+                    SetUISceneElementRect(scene, ids[k], GetCheckRandomRect(200.0f, 100.0f));
+                break;
+            case 1:
+                if (count > 0)
+                    SetUISceneElement(scene, ids[k], &elem);
+                break;
+            case 2:
+                if (count > 0)
+                    SetUISceneElementClip(
+                        scene, ids[k], GetCheckRandom(2) ? clips[GetCheckRandom(CHECK_UI_CLIPS)] : UISCENE_NO_CLIP);
+                break;
+            case 3:
+                SetUISceneClip(scene, clips[GetCheckRandom(CHECK_UI_CLIPS)], GetCheckRandomRect(400.0f, 300.0f));
+                break;
+            case 4:
+                if (count > 0)
+                {
+                    DeleteFromUIScene(scene, ids[k]);
+                    ids[k] = ids[--count];
+                }
+                break;
+            case 5:
+                if (count < 2 * CHECK_UI_ELEMENTS)
+                    ids[count++] = InsertIntoUIScene(scene, &elem);
+                break;
+            case 6:
+                SetUISceneTransform(scene, GetScreenTransform(
+                    640 + (int)GetCheckRandom(1280), 480 + (int)GetCheckRandom(600), 800, 600));
+                break;
+            default:
+                BeginUIFrame();
+                DrawUIScene(scene);
+                break;
+            }
+            CheckUISceneDrawList(scene);
+        }
+        DeleteUIScene(scene);
+    }
+}
+
+// A list gives up on edits once slots outgrow the grid it was built with,
+// or layers outgrow the key, and is built again on the next draw.
+static void CheckUIDrawListFallbacks(UIStyleId style)
+{
+    UIScene* scene = CreateUIScene();
+    for (int i = 0; i < 2; ++i)
+    {
+        UIElement elem = GetCheckElement(style, (UIRect) { i * 20.0f, 0, i * 20.0f + 10, 10 });
+        InsertIntoUIScene(scene, &elem);
+    }
+    BeginUIFrame();
+    DrawUIScene(scene);
+    size_t rebuild = scene->drawList.rebuildSlotCount;
+    while (scene->size <= rebuild)
+    {
+        CHECK(scene->drawList.valid);
+        float x = scene->size * 20.0f;
+        UIElement elem = GetCheckElement(style, (UIRect) { x, 0, x + 10, 10 });
+        InsertIntoUIScene(scene, &elem);
+    }
+    CHECK(!scene->drawList.valid);
+    BeginUIFrame();
+    DrawUIScene(scene);
+    CHECK(scene->drawList.valid);
+    CheckUISceneDrawList(scene);
+    DeleteUIScene(scene);
+
+    // Each element moved onto the pile lands one layer above the last.
+    scene = CreateUIScene();
+    UISceneId ids[CHECK_UI_STACK];
+    for (int i = 0; i < CHECK_UI_STACK; ++i)
+    {
+        float x = (i % 16) * 20.0f;
+        float y = (i / 16) * 20.0f;
+        UIElement elem = GetCheckElement(style, (UIRect) { x, y, x + 10, y + 10 });
+        ids[i] = InsertIntoUIScene(scene, &elem);
+    }
+    BeginUIFrame();
+    DrawUIScene(scene);
+    for (int i = 0; i < CHECK_UI_STACK; ++i)
+    {
+        SetUISceneElementRect(scene, ids[i], (UIRect) { 400, 400, 500, 500 });
+        CHECK(scene->drawList.valid == (i <= (int)UIDRAW_MAX_LAYER));
+    }
+    BeginUIFrame();
+    DrawUIScene(scene);
+    CHECK(scene->drawList.valid);
+    CheckUISceneDrawList(scene);
+    DeleteUIScene(scene);
+}
+
+static void CheckUIDrawList()
+{
+    InitUIBackend();
+    UIStyleId style = InternUIStyle(WARMAGIC_STYLE);
+    CheckUISceneEdits(style);
+    CheckUIDrawListFallbacks(style);
+    FreeUIFrameArena();
+    CloseUIBackend();
+}
+
+// -----------------------------------------------------------------------------
+
+int main()
+{
+    CheckInterpolateGameState();
+    CheckJobSystem();
+    CheckEcsWorld();
+    CheckEcsCommands();
+    CheckParseBattleSetup();
+    CheckBattleReproducible();
+    CheckCompileUIScene();
+    CheckUIDrawList();
+
+    if (failures > 0)
+    {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include "arena.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "util.h"
+
+#define ARENA_ALIGN 16
+#define ARENA_MIN_BLOCK (64 * 1024)
+
+// -----------------------------------------------------------------------------
+
+static size_t AlignArenaSize(size_t size)
+{
+    return (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+static size_t GetArenaHeaderSize()
+{
+    return AlignArenaSize(sizeof(ArenaBlock));
+}
+
+static ArenaBlock* CreateArenaBlock(size_t capacity, ArenaBlock* next)
+{
+    ArenaBlock* block = (ArenaBlock*)malloc(GetArenaHeaderSize() + capacity);
+    block->next = next;
+    block->capacity = capacity;
+    block->used = 0;
+    return block;
+}
+
+// -----------------------------------------------------------------------------
+
+void* ArenaAlloc(Arena* arena, size_t size)
+{
+    size = AlignArenaSize(max(size, (size_t)1));
+
+    ArenaBlock* block = arena->head;
+    if (block == NULL || block->capacity - block->used < size)
+    {
+        size_t capacity = block != NULL ? block->capacity * 2 : ARENA_MIN_BLOCK;
+        block = CreateArenaBlock(max(capacity, size), block);
+        arena->head = block;
+    }
+
+    void* ret = (unsigned char*)block + GetArenaHeaderSize() + block->used;
+    block->used += size;
+    arena->total += size;
+    arena->peak = max(arena->peak, arena->total);
+    return ret;
+}
+
+void ResetArena(Arena* arena)
+{
+    ArenaBlock* block = arena->head;
+    if (block != NULL && block->next != NULL)
+    {
+        FreeArena(arena);
+        arena->head = CreateArenaBlock(AlignArenaSize(arena->peak), NULL);
+    }
+    else if (block != NULL)
+    {
+        block->used = 0;
+    }
+
+    arena->total = 0;
+}
+
+void FreeArena(Arena* arena)
+{
+    ArenaBlock* block = arena->head;
+    while (block != NULL)
+    {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+
+    arena->head = NULL;
+    arena->total = 0;
+}
@@ -0,0 +1,28 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+typedef struct ArenaBlock
+{
+    struct ArenaBlock* next;
+    size_t capacity;
+    size_t used;
+} ArenaBlock;
+
+// Bump allocator for short-lived data. Allocations are only released all
+// at once by ResetArena. If a reset finds the arena spilled into several
+// blocks, it replaces them with one block large enough for all of them,
+// so a steady workload settles into a single block and no heap calls.
+typedef struct Arena
+{
+    ArenaBlock* head;
+    size_t total;
+    size_t peak;
+} Arena;
+
+void* ArenaAlloc(Arena* arena, size_t size);
+void ResetArena(Arena* arena);
+void FreeArena(Arena* arena);
+
+#endif
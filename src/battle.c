@@ -0,0 +1,265 @@
+#include "battle.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "util.h"
+
+#define BATTLE_GOLDEN_GAMMA 0x9E3779B97F4A7C15ull
+#define BATTLE_NONE UINT32_MAX
+
+// Where each unit stands in one battle.
+typedef struct BattleFighter
+{
+    int32_t health;
+    int32_t mana;
+} BattleFighter;
+
+typedef struct BattleTurn
+{
+    BattleSide side;
+    uint32_t unit;
+} BattleTurn;
+
+typedef struct BattleState
+{
+    const BattleSetup* setup;
+    BattleStats* stats;
+    uint64_t random;
+    BattleFighter fighters[BATTLE_SIDE_COUNT][BATTLE_MAX_SIDE_UNITS];
+} BattleState;
+
+// -----------------------------------------------------------------------------
+
+// SplitMix64: a 64 bit state stepped by a constant and mixed on the way
+// out, so any seed, even 0, gives a good sequence.
+static uint64_t NextBattleRandom(uint64_t* state)
+{
+    uint64_t z = (*state += BATTLE_GOLDEN_GAMMA);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// From 0 to n - 1.
+static uint32_t RollBattle(BattleState* state, uint32_t n)
+{
+    return (uint32_t)(((NextBattleRandom(&state->random) >> 32) * n) >> 32);
+}
+
+static uint32_t CountLivingFighters(const BattleState* state, BattleSide side)
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < state->setup->unitCounts[side]; ++i)
+        count += state->fighters[side][i].health > 0;
+    return count;
+}
+
+// The living unit with the least health, first listed on ties; with
+// wounded, only those down to half their health or less.
+static uint32_t FindWeakestFighter(const BattleState* state, BattleSide side, bool wounded)
+{
+    uint32_t weakest = BATTLE_NONE;
+    for (uint32_t i = 0; i < state->setup->unitCounts[side]; ++i)
+    {
+        int32_t health = state->fighters[side][i].health;
+        if (health <= 0 || (wounded && health * 2 > state->setup->units[side][i].health))
+            continue;
+        if (weakest == BATTLE_NONE || health < state->fighters[side][weakest].health)
+            weakest = i;
+    }
+    return weakest;
+}
+
+static int32_t RollBattlePower(BattleState* state, int32_t power)
+{
+    return power + (int32_t)RollBattle(state, (uint32_t)max(power, 0) / 4 + 1);
+}
+
+// Attacks can miss and crit; spells always land as rolled. Damage
+// counts in full even past the target's last health, and always does
+// at least 1.
+static int32_t HitBattleFighter(BattleState* state, BattleTurn attacker, uint32_t target, int32_t power, bool attack)
+{
+    if (attack && RollBattle(state, 100) >= BATTLE_HIT_PERCENT)
+        return 0;
+
+    BattleSide targetSide = attacker.side == BATTLE_PARTY ? BATTLE_ENEMY : BATTLE_PARTY;
+    int32_t roll = RollBattlePower(state, power);
+    if (attack && RollBattle(state, 100) < BATTLE_CRIT_PERCENT)
+        roll *= 2;
+    int32_t damage = max(roll - state->setup->units[targetSide][target].defense / 2, 1);
+
+    BattleFighter* fighter = &state->fighters[targetSide][target];
+    fighter->health = max(fighter->health - damage, 0);
+
+    BattleStats* stats = state->stats;
+    stats->hits[min((uint32_t)damage / BATTLE_DAMAGE_BUCKET_SIZE, (uint32_t)BATTLE_DAMAGE_BUCKETS - 1)]++;
+    stats->damage[attacker.side] += (uint64_t)damage;
+    stats->unitDamage[attacker.side][attacker.unit] += (uint64_t)damage;
+    return damage;
+}
+
+// Heals the weakest wounded ally if it can, or else uses whichever of its
+// attack and damage spells does the most raw damage across the targets
+// it would hit, on the weakest enemy.
+static void TakeBattleTurn(BattleState* state, BattleTurn turn)
+{
+    const BattleSetup* setup = state->setup;
+    const BattleUnit* unit = &setup->units[turn.side][turn.unit];
+    BattleFighter* self = &state->fighters[turn.side][turn.unit];
+    BattleSide enemySide = turn.side == BATTLE_PARTY ? BATTLE_ENEMY : BATTLE_PARTY;
+
+    uint32_t wounded = FindWeakestFighter(state, turn.side, true);
+    for (uint32_t i = 0; i < unit->spellCount && wounded != BATTLE_NONE; ++i)
+    {
+        const BattleSpell* spell = &setup->spells[unit->spells[i]];
+        if (spell->kind != BATTLE_SPELL_HEAL || spell->cost > self->mana)
+            continue;
+
+        BattleFighter* ally = &state->fighters[turn.side][wounded];
+        int32_t amount = RollBattlePower(state, spell->power + unit->magic);
+        ally->health = min(ally->health + amount, setup->units[turn.side][wounded].health);
+        self->mana -= spell->cost;
+        state->stats->spellCasts[unit->spells[i]]++;
+        state->stats->spellAmounts[unit->spells[i]] += (uint64_t)amount;
+        return;
+    }
+
+    uint32_t living = CountLivingFighters(state, enemySide);
+    uint32_t best = BATTLE_NONE;
+    int64_t bestValue = unit->attack;
+    for (uint32_t i = 0; i < unit->spellCount; ++i)
+    {
+        const BattleSpell* spell = &setup->spells[unit->spells[i]];
+        if (spell->kind == BATTLE_SPELL_HEAL || spell->cost > self->mana)
+            continue;
+
+        int64_t value = (int64_t)(spell->power + unit->magic) * (spell->kind == BATTLE_SPELL_AREA ? living : 1);
+        if (value > bestValue)
+        {
+            best = i;
+            bestValue = value;
+        }
+    }
+
+    uint32_t target = FindWeakestFighter(state, enemySide, false);
+    if (best == BATTLE_NONE)
+    {
+        HitBattleFighter(state, turn, target, unit->attack, true);
+        return;
+    }
+
+    uint32_t index = unit->spells[best];
+    const BattleSpell* spell = &setup->spells[index];
+    int32_t power = spell->power + unit->magic;
+    uint64_t amount = 0;
+    self->mana -= spell->cost;
+    if (spell->kind == BATTLE_SPELL_AREA)
+    {
+        for (uint32_t i = 0; i < setup->unitCounts[enemySide]; ++i)
+        {
+            if (state->fighters[enemySide][i].health > 0)
+                amount += (uint64_t)HitBattleFighter(state, turn, i, power, false);
+        }
+    }
+    else
+    {
+        amount = (uint64_t)HitBattleFighter(state, turn, target, power, false);
+    }
+    state->stats->spellCasts[index]++;
+    state->stats->spellAmounts[index] += amount;
+}
+
+// Faster units act first; on ties the party does, then units in the order
+// they are listed.
+static uint32_t OrderBattleTurns(const BattleSetup* setup, BattleTurn* turns)
+{
+    uint32_t count = 0;
+    for (int side = 0; side < BATTLE_SIDE_COUNT; ++side)
+    {
+        for (uint32_t i = 0; i < setup->unitCounts[side]; ++i)
+        {
+            BattleTurn turn = { (BattleSide)side, i };
+            int32_t speed = setup->units[side][i].speed;
+            uint32_t j = count++;
+            for (; j > 0 && setup->units[turns[j - 1].side][turns[j - 1].unit].speed < speed; --j)
+                turns[j] = turns[j - 1];
+            turns[j] = turn;
+        }
+    }
+    return count;
+}
+
+// -----------------------------------------------------------------------------
+
+// The seed of one battle out of many run from seed, so each can be played
+// on its own, in any order.
+uint64_t GetBattleSeed(uint64_t seed, uint64_t battle)
+{
+    uint64_t state = seed ^ (battle * BATTLE_GOLDEN_GAMMA);
+    return NextBattleRandom(&state);
+}
+
+// Plays out one battle in rounds, each unit acting once a round, until a
+// side is wiped out or BATTLE_MAX_ROUNDS have passed, and adds how it went
+// to stats.
+void RunBattle(const BattleSetup* setup, uint64_t seed, BattleStats* stats)
+{
+    BattleState state = { setup, stats, seed, { { { 0 } } } };
+    for (int side = 0; side < BATTLE_SIDE_COUNT; ++side)
+    {
+        for (uint32_t i = 0; i < setup->unitCounts[side]; ++i)
+            state.fighters[side][i] = (BattleFighter) { setup->units[side][i].health, setup->units[side][i].mana };
+    }
+
+    BattleTurn turns[BATTLE_SIDE_COUNT * BATTLE_MAX_SIDE_UNITS];
+    uint32_t turnCount = OrderBattleTurns(setup, turns);
+    uint32_t round = 0;
+    bool over = CountLivingFighters(&state, BATTLE_PARTY) == 0 || CountLivingFighters(&state, BATTLE_ENEMY) == 0;
+    while (!over && round < BATTLE_MAX_ROUNDS)
+    {
+        ++round;
+        for (uint32_t i = 0; i < turnCount && !over; ++i)
+        {
+            if (state.fighters[turns[i].side][turns[i].unit].health <= 0)
+                continue;
+
+            TakeBattleTurn(&state, turns[i]);
+            over = CountLivingFighters(&state, turns[i].side == BATTLE_PARTY ? BATTLE_ENEMY : BATTLE_PARTY) == 0;
+        }
+
+        for (uint32_t i = 0; i < turnCount; ++i)
+        {
+            BattleFighter* fighter = &state.fighters[turns[i].side][turns[i].unit];
+            if (fighter->health > 0)
+                fighter->mana = min(fighter->mana + BATTLE_MANA_REGEN, setup->units[turns[i].side][turns[i].unit].mana);
+        }
+    }
+
+    stats->battles++;
+    stats->rounds[round]++;
+    if (CountLivingFighters(&state, BATTLE_ENEMY) == 0)
+        stats->wins++;
+    else if (CountLivingFighters(&state, BATTLE_PARTY) == 0)
+        stats->losses++;
+    else
+        stats->draws++;
+
+    for (int side = 0; side < BATTLE_SIDE_COUNT; ++side)
+    {
+        for (uint32_t i = 0; i < setup->unitCounts[side]; ++i)
+            stats->unitSurvivals[side][i] += state.fighters[side][i].health > 0;
+    }
+}
+
+// Every field is a count, so stats merge by adding them up.
+void MergeBattleStats(BattleStats* into, const BattleStats* from)
+{
+    uint64_t* dst = (uint64_t*)into;
+    const uint64_t* src = (const uint64_t*)from;
+    for (size_t i = 0; i < sizeof(BattleStats) / sizeof(uint64_t); ++i)
+        dst[i] += src[i];
+}
@@ -0,0 +1,94 @@
+#ifndef BATTLE_H
+#define BATTLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Battle rules, kept free of raylib so they can run headless. All
+// arithmetic is on integers and every random roll comes from the battle's
+// own seed, so a battle plays out the same on any machine, in any order
+// and on any thread.
+
+#define BATTLE_NAME_MAX 32
+#define BATTLE_MAX_SIDE_UNITS 8
+#define BATTLE_MAX_UNIT_SPELLS 4
+#define BATTLE_MAX_SPELLS 64
+#define BATTLE_MAX_ITEMS 64
+#define BATTLE_MAX_ROUNDS 200
+#define BATTLE_HIT_PERCENT 90
+#define BATTLE_CRIT_PERCENT 5
+#define BATTLE_MANA_REGEN 2
+#define BATTLE_DAMAGE_BUCKET_SIZE 5
+#define BATTLE_DAMAGE_BUCKETS 64
+
+typedef enum BattleSide
+{
+    BATTLE_PARTY, BATTLE_ENEMY,
+    BATTLE_SIDE_COUNT
+} BattleSide;
+
+typedef enum BattleSpellKind
+{
+    BATTLE_SPELL_STRIKE, BATTLE_SPELL_AREA, BATTLE_SPELL_HEAL
+} BattleSpellKind;
+
+typedef struct BattleSpell
+{
+    char name[BATTLE_NAME_MAX];
+    BattleSpellKind kind;
+    int32_t power;
+    int32_t cost;
+} BattleSpell;
+
+// Stats a unit starts every battle with, gear included. spells index
+// BattleSetup.spells.
+typedef struct BattleUnit
+{
+    char name[BATTLE_NAME_MAX];
+    int32_t health;
+    int32_t mana;
+    int32_t attack;
+    int32_t defense;
+    int32_t speed;
+    int32_t magic;
+    uint32_t spells[BATTLE_MAX_UNIT_SPELLS];
+    uint32_t spellCount;
+} BattleUnit;
+
+// A party against an encounter.
+typedef struct BattleSetup
+{
+    BattleSpell spells[BATTLE_MAX_SPELLS];
+    uint32_t spellCount;
+    BattleUnit units[BATTLE_SIDE_COUNT][BATTLE_MAX_SIDE_UNITS];
+    uint32_t unitCounts[BATTLE_SIDE_COUNT];
+} BattleSetup;
+
+// Totals over any number of battles. Only counts and integer sums, so
+// merging the stats of batches gives the same result in any order.
+// rounds counts battles by how many rounds they lasted, and hits counts
+// every hit by how much damage it did, in buckets of
+// BATTLE_DAMAGE_BUCKET_SIZE, the last open ended.
+typedef struct BattleStats
+{
+    uint64_t battles;
+    uint64_t wins;
+    uint64_t losses;
+    uint64_t draws;
+    uint64_t rounds[BATTLE_MAX_ROUNDS + 1];
+    uint64_t hits[BATTLE_DAMAGE_BUCKETS];
+    uint64_t damage[BATTLE_SIDE_COUNT];
+    uint64_t unitDamage[BATTLE_SIDE_COUNT][BATTLE_MAX_SIDE_UNITS];
+    uint64_t unitSurvivals[BATTLE_SIDE_COUNT][BATTLE_MAX_SIDE_UNITS];
+    uint64_t spellCasts[BATTLE_MAX_SPELLS];
+    uint64_t spellAmounts[BATTLE_MAX_SPELLS];
+} BattleStats;
+
+bool ParseBattleSetup(const char* source, BattleSetup* setup, char* error, size_t errorSize);
+
+uint64_t GetBattleSeed(uint64_t seed, uint64_t battle);
+void RunBattle(const BattleSetup* setup, uint64_t seed, BattleStats* stats);
+void MergeBattleStats(BattleStats* into, const BattleStats* from);
+
+#endif
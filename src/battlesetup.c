@@ -0,0 +1,330 @@
+#include "battle.h"
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "textparse.h"
+
+// Reads a party and an encounter from text. Every line is blank, a #
+// comment, or one of:
+//
+//   spell <name> <strike|area|heal> power=<n> [cost=<n>]
+//   item <name> [<stat>=<n> ...]
+//   <party|enemy> <name> [<stat>=<n> ...] [spells=<name>,...] [gear=<name>,...]
+//
+// Stats are health, mana, attack, defense, speed and magic, all whole
+// numbers of at most a million either way. A unit's gear adds its items'
+// stats to its own. Spells and items must be defined before the units
+// that use them; names are unique within their kind.
+
+#define BATTLESETUP_NUMBER_MAX 32
+#define BATTLESETUP_STAT_MAX 1000000
+
+// Items only matter while units are read, as their stats are folded into
+// the units that wear them.
+typedef struct BattleItem
+{
+    char name[BATTLE_NAME_MAX];
+    BattleUnit stats;
+} BattleItem;
+
+typedef struct BattleSetupParser
+{
+    int line;
+    char* error;
+    size_t errorSize;
+    BattleSetup* setup;
+    BattleItem items[BATTLE_MAX_ITEMS];
+    uint32_t itemCount;
+} BattleSetupParser;
+
+// -----------------------------------------------------------------------------
+
+static bool FailBattleSetup(BattleSetupParser* p, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    FormatTextError(p->error, p->errorSize, p->line, format, args);
+    va_end(args);
+    return false;
+}
+
+static bool ParseBattleNumber(TextView token, int32_t* out)
+{
+    char buffer[BATTLESETUP_NUMBER_MAX];
+    if (token.length == 0 || token.length >= BATTLESETUP_NUMBER_MAX)
+        return false;
+
+    memcpy(buffer, token.data, token.length);
+    buffer[token.length] = '\0';
+    char* end = NULL;
+    long value = strtol(buffer, &end, 10);
+    if (*end != '\0' || value < -BATTLESETUP_STAT_MAX || value > BATTLESETUP_STAT_MAX)
+        return false;
+    *out = (int32_t)value;
+    return true;
+}
+
+static bool CopyBattleName(BattleSetupParser* p, TextView name, char* out)
+{
+    if (name.length == 0 || name.length >= BATTLE_NAME_MAX)
+        return FailBattleSetup(p, "names must be 1 to %d characters", BATTLE_NAME_MAX - 1);
+
+    memcpy(out, name.data, name.length);
+    out[name.length] = '\0';
+    return true;
+}
+
+static uint32_t FindBattleSpell(const BattleSetup* setup, TextView name)
+{
+    for (uint32_t i = 0; i < setup->spellCount; ++i)
+    {
+        if (EqualsTextView(name, setup->spells[i].name))
+            return i;
+    }
+    return UINT32_MAX;
+}
+
+static uint32_t FindBattleItem(const BattleSetupParser* p, TextView name)
+{
+    for (uint32_t i = 0; i < p->itemCount; ++i)
+    {
+        if (EqualsTextView(name, p->items[i].name))
+            return i;
+    }
+    return UINT32_MAX;
+}
+
+// Returns false if key is not a stat.
+static bool ParseBattleStat(TextView key, TextView value, BattleUnit* unit, bool* ok)
+{
+    int32_t* stat = NULL;
+    if (EqualsTextView(key, "health"))
+        stat = &unit->health;
+    else if (EqualsTextView(key, "mana"))
+        stat = &unit->mana;
+    else if (EqualsTextView(key, "attack"))
+        stat = &unit->attack;
+    else if (EqualsTextView(key, "defense"))
+        stat = &unit->defense;
+    else if (EqualsTextView(key, "speed"))
+        stat = &unit->speed;
+    else if (EqualsTextView(key, "magic"))
+        stat = &unit->magic;
+    else
+        return false;
+
+    *ok = ParseBattleNumber(value, stat);
+    return true;
+}
+
+static void AddBattleStats(BattleUnit* unit, const BattleUnit* gear)
+{
+    unit->health += gear->health;
+    unit->mana += gear->mana;
+    unit->attack += gear->attack;
+    unit->defense += gear->defense;
+    unit->speed += gear->speed;
+    unit->magic += gear->magic;
+}
+
+// -----------------------------------------------------------------------------
+
+static bool ParseBattleSpell(BattleSetupParser* p, TextView line)
+{
+    BattleSetup* setup = p->setup;
+    TextView name;
+    TextView kind;
+    if (!NextTextToken(&line, &name) || !NextTextToken(&line, &kind))
+        return FailBattleSetup(p, "spell needs a name and a kind");
+    if (FindBattleSpell(setup, name) != UINT32_MAX)
+        return FailBattleSetup(p, "spell %.*s is already defined", (int)name.length, name.data);
+    if (setup->spellCount == BATTLE_MAX_SPELLS)
+        return FailBattleSetup(p, "more than %d spells", BATTLE_MAX_SPELLS);
+
+    BattleSpell spell = { 0 };
+    if (!CopyBattleName(p, name, spell.name))
+        return false;
+    if (EqualsTextView(kind, "strike"))
+        spell.kind = BATTLE_SPELL_STRIKE;
+    else if (EqualsTextView(kind, "area"))
+        spell.kind = BATTLE_SPELL_AREA;
+    else if (EqualsTextView(kind, "heal"))
+        spell.kind = BATTLE_SPELL_HEAL;
+    else
+        return FailBattleSetup(p, "unknown spell kind %.*s", (int)kind.length, kind.data);
+
+    bool hasPower = false;
+    TextView token;
+    while (NextTextToken(&line, &token))
+    {
+        TextView key;
+        TextView value;
+        SplitTextAttribute(token, &key, &value);
+        bool ok = false;
+        if (EqualsTextView(key, "power"))
+            ok = hasPower = ParseBattleNumber(value, &spell.power);
+        else if (EqualsTextView(key, "cost"))
+            ok = ParseBattleNumber(value, &spell.cost);
+
+        if (!ok)
+            return FailBattleSetup(p, "bad spell attribute %.*s", (int)token.length, token.data);
+    }
+    if (!hasPower)
+        return FailBattleSetup(p, "spell %s needs a power", spell.name);
+
+    setup->spells[setup->spellCount++] = spell;
+    return true;
+}
+
+static bool ParseBattleItem(BattleSetupParser* p, TextView line)
+{
+    TextView name;
+    if (!NextTextToken(&line, &name))
+        return FailBattleSetup(p, "item needs a name");
+    if (FindBattleItem(p, name) != UINT32_MAX)
+        return FailBattleSetup(p, "item %.*s is already defined", (int)name.length, name.data);
+    if (p->itemCount == BATTLE_MAX_ITEMS)
+        return FailBattleSetup(p, "more than %d items", BATTLE_MAX_ITEMS);
+
+    BattleItem item = { 0 };
+    if (!CopyBattleName(p, name, item.name))
+        return false;
+
+    TextView token;
+    while (NextTextToken(&line, &token))
+    {
+        TextView key;
+        TextView value;
+        SplitTextAttribute(token, &key, &value);
+        bool ok = false;
+        if (!ParseBattleStat(key, value, &item.stats, &ok) || !ok)
+            return FailBattleSetup(p, "bad item attribute %.*s", (int)token.length, token.data);
+    }
+
+    p->items[p->itemCount++] = item;
+    return true;
+}
+
+static bool ParseBattleUnitAttribute(BattleSetupParser* p, BattleUnit* unit, BattleUnit* gear, TextView token)
+{
+    TextView key;
+    TextView value;
+    SplitTextAttribute(token, &key, &value);
+
+    bool ok = false;
+    if (ParseBattleStat(key, value, unit, &ok))
+    {
+        if (!ok)
+            return FailBattleSetup(p, "bad unit attribute %.*s", (int)token.length, token.data);
+        return true;
+    }
+
+    TextView name;
+    if (EqualsTextView(key, "spells"))
+    {
+        while (NextTextListItem(&value, &name))
+        {
+            uint32_t spell = FindBattleSpell(p->setup, name);
+            if (spell == UINT32_MAX)
+                return FailBattleSetup(p, "unknown spell %.*s", (int)name.length, name.data);
+            if (unit->spellCount == BATTLE_MAX_UNIT_SPELLS)
+                return FailBattleSetup(p, "more than %d spells on one unit", BATTLE_MAX_UNIT_SPELLS);
+            unit->spells[unit->spellCount++] = spell;
+        }
+        return true;
+    }
+    if (EqualsTextView(key, "gear"))
+    {
+        while (NextTextListItem(&value, &name))
+        {
+            uint32_t item = FindBattleItem(p, name);
+            if (item == UINT32_MAX)
+                return FailBattleSetup(p, "unknown item %.*s", (int)name.length, name.data);
+            AddBattleStats(gear, &p->items[item].stats);
+        }
+        return true;
+    }
+    return FailBattleSetup(p, "bad unit attribute %.*s", (int)token.length, token.data);
+}
+
+static bool ParseBattleUnit(BattleSetupParser* p, BattleSide side, TextView line)
+{
+    BattleSetup* setup = p->setup;
+    TextView name;
+    if (!NextTextToken(&line, &name))
+        return FailBattleSetup(p, "unit needs a name");
+    if (setup->unitCounts[side] == BATTLE_MAX_SIDE_UNITS)
+        return FailBattleSetup(p, "more than %d units on one side", BATTLE_MAX_SIDE_UNITS);
+
+    BattleUnit unit = { 0 };
+    BattleUnit gear = { 0 };
+    if (!CopyBattleName(p, name, unit.name))
+        return false;
+
+    TextView token;
+    while (NextTextToken(&line, &token))
+    {
+        if (!ParseBattleUnitAttribute(p, &unit, &gear, token))
+            return false;
+    }
+    AddBattleStats(&unit, &gear);
+    if (unit.health <= 0)
+        return FailBattleSetup(p, "unit %s needs health", unit.name);
+
+    setup->units[side][setup->unitCounts[side]++] = unit;
+    return true;
+}
+
+static bool ParseBattleLine(BattleSetupParser* p, TextView line)
+{
+    TextView command;
+    if (!NextTextToken(&line, &command) || command.data[0] == '#')
+        return true;
+
+    if (EqualsTextView(command, "spell"))
+        return ParseBattleSpell(p, line);
+    if (EqualsTextView(command, "item"))
+        return ParseBattleItem(p, line);
+    if (EqualsTextView(command, "party"))
+        return ParseBattleUnit(p, BATTLE_PARTY, line);
+    if (EqualsTextView(command, "enemy"))
+        return ParseBattleUnit(p, BATTLE_ENEMY, line);
+    return FailBattleSetup(p, "unknown command %.*s", (int)command.length, command.data);
+}
+
+// -----------------------------------------------------------------------------
+
+// Reads the null-terminated source into setup. On failure, error receives
+// a message naming the offending line.
+bool ParseBattleSetup(const char* source, BattleSetup* setup, char* error, size_t errorSize)
+{
+    memset(setup, 0, sizeof(BattleSetup));
+    BattleSetupParser* p = (BattleSetupParser*)calloc(1, sizeof(BattleSetupParser));
+    p->error = error;
+    p->errorSize = errorSize;
+    p->setup = setup;
+
+    bool ok = true;
+    TextView line;
+    while (ok && NextTextLine(&source, &line))
+    {
+        ++p->line;
+        ok = ParseBattleLine(p, line);
+    }
+
+    if (ok && (setup->unitCounts[BATTLE_PARTY] == 0 || setup->unitCounts[BATTLE_ENEMY] == 0))
+    {
+        if (errorSize > 0)
+            snprintf(error, errorSize, "needs at least one party member and one enemy");
+        ok = false;
+    }
+
+    free(p);
+    return ok;
+}
@@ -0,0 +1,521 @@
+#include "ecs.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ECS_ENTITY_BLOCK_SIZE 256
+#define ECS_ZERO_VALUE SIZE_MAX
+
+// -----------------------------------------------------------------------------
+
+static size_t AlignEcsSize(size_t size)
+{
+    return (size + ECS_COLUMN_ALIGN - 1) & ~(size_t)(ECS_COLUMN_ALIGN - 1);
+}
+
+static EcsComponent NextEcsComponent(EcsMask* mask)
+{
+    EcsComponent component = (EcsComponent)__builtin_ctzll(*mask);
+    *mask &= *mask - 1;
+    return component;
+}
+
+static void* GetEcsCell(const EcsWorld* world, const EcsArchetype* archetype, const EcsChunk* chunk, uint32_t row, EcsComponent component)
+{
+    return chunk->data + archetype->offsets[component] + (size_t)row * world->componentSizes[component];
+}
+
+static void GrowEcsEntities(EcsWorld* world)
+{
+    uint32_t newCapacity = world->entityCapacity + ECS_ENTITY_BLOCK_SIZE;
+    world->records = (EcsRecord*)realloc(world->records, newCapacity * sizeof(EcsRecord));
+    world->generations = (uint32_t*)realloc(world->generations, newCapacity * sizeof(uint32_t));
+    world->freeList = (uint32_t*)realloc(world->freeList, newCapacity * sizeof(uint32_t));
+
+    // Push in reverse so slots are handed out in ascending order.
+    for (uint32_t i = newCapacity; i > world->entityCapacity; --i)
+    {
+        world->generations[i - 1] = 0;
+        world->freeList[world->freeCount++] = i - 1;
+    }
+    world->entityCapacity = newCapacity;
+}
+
+// Fits as many rows as a chunk of ECS_CHUNK_SIZE holds, or one row in a
+// larger chunk if not even one does.
+static uint32_t CreateEcsArchetype(EcsWorld* world, EcsMask mask)
+{
+    if (world->archetypeCount == world->archetypeCapacity)
+    {
+        world->archetypeCapacity = world->archetypeCapacity > 0 ? world->archetypeCapacity * 2 : 16;
+        world->archetypes = (EcsArchetype*)realloc(
+            world->archetypes, world->archetypeCapacity * sizeof(EcsArchetype));
+    }
+
+    EcsArchetype* archetype = &world->archetypes[world->archetypeCount];
+    memset(archetype, 0, sizeof(EcsArchetype));
+    memset(archetype->addEdges, 0xFF, sizeof(archetype->addEdges));
+    memset(archetype->removeEdges, 0xFF, sizeof(archetype->removeEdges));
+    archetype->mask = mask;
+
+    size_t rowSize = sizeof(EcsEntity);
+    size_t padding = ECS_COLUMN_ALIGN;
+    for (EcsMask rest = mask; rest != 0;)
+    {
+        rowSize += world->componentSizes[NextEcsComponent(&rest)];
+        padding += ECS_COLUMN_ALIGN;
+    }
+    archetype->capacity = ECS_CHUNK_SIZE > padding ? (uint32_t)((ECS_CHUNK_SIZE - padding) / rowSize) : 0;
+    if (archetype->capacity == 0)
+        archetype->capacity = 1;
+
+    size_t offset = AlignEcsSize(archetype->capacity * sizeof(EcsEntity));
+    for (EcsMask rest = mask; rest != 0;)
+    {
+        EcsComponent component = NextEcsComponent(&rest);
+        archetype->offsets[component] = (uint32_t)offset;
+        offset = AlignEcsSize(offset + (size_t)archetype->capacity * world->componentSizes[component]);
+    }
+    archetype->chunkSize = offset;
+    return world->archetypeCount++;
+}
+
+static uint32_t FindEcsArchetype(EcsWorld* world, EcsMask mask)
+{
+    for (uint32_t i = 0; i < world->archetypeCount; ++i)
+    {
+        if (world->archetypes[i].mask == mask)
+            return i;
+    }
+    return CreateEcsArchetype(world, mask);
+}
+
+static uint32_t GetEcsArchetypeEdge(EcsWorld* world, uint32_t from, EcsComponent component, bool add)
+{
+    EcsArchetype* archetype = &world->archetypes[from];
+    uint32_t to = add ? archetype->addEdges[component] : archetype->removeEdges[component];
+    if (to != ECS_NONE)
+        return to;
+
+    EcsMask mask = add ? archetype->mask | ECS_MASK(component) : archetype->mask & ~ECS_MASK(component);
+    to = FindEcsArchetype(world, mask);
+
+    // Creating the archetype may have moved the array.
+    archetype = &world->archetypes[from];
+    if (add)
+        archetype->addEdges[component] = to;
+    else
+        archetype->removeEdges[component] = to;
+    return to;
+}
+
+static EcsRecord AllocEcsRow(EcsWorld* world, uint32_t index, EcsEntity entity)
+{
+    EcsArchetype* archetype = &world->archetypes[index];
+    if (archetype->chunkCount == 0 || archetype->chunks[archetype->chunkCount - 1].count == archetype->capacity)
+    {
+        if (archetype->chunkCount == archetype->chunkCapacity)
+        {
+            uint32_t newCapacity = archetype->chunkCapacity > 0 ? archetype->chunkCapacity * 2 : 4;
+            archetype->chunks = (EcsChunk*)realloc(archetype->chunks, newCapacity * sizeof(EcsChunk));
+            memset(&archetype->chunks[archetype->chunkCapacity], 0, (newCapacity - archetype->chunkCapacity) * sizeof(EcsChunk));
+            archetype->chunkCapacity = newCapacity;
+        }
+
+        EcsChunk* chunk = &archetype->chunks[archetype->chunkCount++];
+        if (chunk->data == NULL)
+            chunk->data = (unsigned char*)malloc(archetype->chunkSize);
+        chunk->count = 0;
+    }
+
+    uint32_t chunkIndex = archetype->chunkCount - 1;
+    EcsChunk* chunk = &archetype->chunks[chunkIndex];
+    uint32_t row = chunk->count++;
+    ((EcsEntity*)chunk->data)[row] = entity;
+    return (EcsRecord) { index, chunkIndex, row };
+}
+
+// Moves the archetype's last row into the freed one, so chunks stay
+// packed.
+static void FreeEcsRow(EcsWorld* world, EcsRecord record)
+{
+    EcsArchetype* archetype = &world->archetypes[record.archetype];
+    uint32_t lastChunk = archetype->chunkCount - 1;
+    EcsChunk* last = &archetype->chunks[lastChunk];
+    uint32_t lastRow = last->count - 1;
+    if (record.chunk != lastChunk || record.row != lastRow)
+    {
+        EcsChunk* hole = &archetype->chunks[record.chunk];
+        EcsEntity moved = ((EcsEntity*)last->data)[lastRow];
+        ((EcsEntity*)hole->data)[record.row] = moved;
+        for (EcsMask rest = archetype->mask; rest != 0;)
+        {
+            EcsComponent component = NextEcsComponent(&rest);
+            memcpy(
+                GetEcsCell(world, archetype, hole, record.row, component),
+                GetEcsCell(world, archetype, last, lastRow, component),
+                world->componentSizes[component]);
+        }
+        world->records[moved.index] = record;
+    }
+
+    if (--last->count == 0)
+        --archetype->chunkCount;
+}
+
+// Components the entity keeps are copied over; ones it gains are zeroed.
+static void MoveEcsEntity(EcsWorld* world, uint32_t index, uint32_t to)
+{
+    EcsRecord from = world->records[index];
+    if (from.archetype == to)
+        return;
+
+    EcsRecord record = AllocEcsRow(world, to, (EcsEntity) { index, world->generations[index] });
+    const EcsArchetype* dst = &world->archetypes[to];
+    const EcsChunk* dstChunk = &dst->chunks[record.chunk];
+    EcsMask added = dst->mask;
+    if (from.archetype != ECS_NONE)
+    {
+        const EcsArchetype* src = &world->archetypes[from.archetype];
+        const EcsChunk* srcChunk = &src->chunks[from.chunk];
+        for (EcsMask rest = src->mask & dst->mask; rest != 0;)
+        {
+            EcsComponent component = NextEcsComponent(&rest);
+            memcpy(
+                GetEcsCell(world, dst, dstChunk, record.row, component),
+                GetEcsCell(world, src, srcChunk, from.row, component),
+                world->componentSizes[component]);
+        }
+        added &= ~src->mask;
+        FreeEcsRow(world, from);
+    }
+
+    for (EcsMask rest = added; rest != 0;)
+    {
+        EcsComponent component = NextEcsComponent(&rest);
+        memset(GetEcsCell(world, dst, dstChunk, record.row, component), 0, world->componentSizes[component]);
+    }
+    world->records[index] = record;
+}
+
+static void SetEcsComponent(EcsWorld* world, uint32_t index, EcsComponent component, const void* value)
+{
+    EcsRecord record = world->records[index];
+    const EcsArchetype* archetype = &world->archetypes[record.archetype];
+    void* cell = GetEcsCell(world, archetype, &archetype->chunks[record.chunk], record.row, component);
+    if (value != NULL)
+        memcpy(cell, value, world->componentSizes[component]);
+    else
+        memset(cell, 0, world->componentSizes[component]);
+}
+
+static bool IsSameEcsEntity(EcsEntity a, EcsEntity b)
+{
+    return a.index == b.index && a.generation == b.generation;
+}
+
+// One entity's run of commands, moved to where they leave it in one step
+// rather than one archetype at a time.
+static void RunEcsEntityCommands(EcsWorld* world, const EcsCommand* commands, size_t count, const unsigned char* values)
+{
+    EcsEntity entity = commands[0].entity;
+    if (!IsEcsEntityAlive(world, entity))
+        return;
+
+    uint32_t from = world->records[entity.index].archetype;
+    uint32_t to = from != ECS_NONE ? from : 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (commands[i].kind == ECS_COMMAND_DESTROY)
+        {
+            DestroyEcsEntity(world, entity);
+            return;
+        }
+        if (commands[i].component >= world->componentCount)
+            continue;
+        to = GetEcsArchetypeEdge(world, to, commands[i].component, commands[i].kind == ECS_COMMAND_ADD);
+    }
+    MoveEcsEntity(world, entity.index, to);
+
+    EcsMask mask = world->archetypes[to].mask;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const EcsCommand* command = &commands[i];
+        if (command->kind == ECS_COMMAND_ADD && command->component < world->componentCount
+            && (mask & ECS_MASK(command->component)))
+        {
+            SetEcsComponent(
+                world, entity.index, command->component,
+                command->value != ECS_ZERO_VALUE ? values + command->value : NULL);
+        }
+    }
+}
+
+static EcsCommand* PushEcsCommand(EcsCommands* commands)
+{
+    if (commands->count == commands->capacity)
+    {
+        commands->capacity = commands->capacity > 0 ? commands->capacity * 2 : 64;
+        commands->items = (EcsCommand*)realloc(commands->items, commands->capacity * sizeof(EcsCommand));
+    }
+    return &commands->items[commands->count++];
+}
+
+// -----------------------------------------------------------------------------
+
+// Archetype 0 holds entities with no components.
+EcsWorld* CreateEcsWorld()
+{
+    EcsWorld* world = (EcsWorld*)calloc(1, sizeof(EcsWorld));
+    CreateEcsArchetype(world, 0);
+    return world;
+}
+
+void DeleteEcsWorld(EcsWorld* world)
+{
+    for (uint32_t i = 0; i < world->archetypeCount; ++i)
+    {
+        EcsArchetype* archetype = &world->archetypes[i];
+        for (uint32_t j = 0; j < archetype->chunkCapacity; ++j)
+            free(archetype->chunks[j].data);
+        free(archetype->chunks);
+    }
+    for (uint32_t i = 0; i < world->queryCount; ++i)
+    {
+        free(world->queries[i]->archetypes);
+        free(world->queries[i]);
+    }
+
+    free(world->archetypes);
+    free(world->records);
+    free(world->generations);
+    free(world->freeList);
+    free(world->queries);
+    free(world);
+}
+
+// Returns ECS_NONE once ECS_MAX_COMPONENTS are registered. Components are
+// plain data, copied around with memcpy.
+EcsComponent RegisterEcsComponent(EcsWorld* world, size_t size)
+{
+    if (world->componentCount == ECS_MAX_COMPONENTS)
+        return ECS_NONE;
+
+    world->componentSizes[world->componentCount] = (uint32_t)size;
+    return world->componentCount++;
+}
+
+EcsEntity CreateEcsEntity(EcsWorld* world)
+{
+    EcsEntity entity = ReserveEcsEntity(world);
+    MoveEcsEntity(world, entity.index, 0);
+    return entity;
+}
+
+// An entity with no storage yet, for a command buffer to fill in. It does
+// not show up in queries until a command for it runs. Reserving does not
+// move any rows, so it is safe while iterating.
+EcsEntity ReserveEcsEntity(EcsWorld* world)
+{
+    if (world->freeCount == 0)
+        GrowEcsEntities(world);
+
+    uint32_t index = world->freeList[--world->freeCount];
+    uint32_t generation = ++world->generations[index];
+    world->records[index] = (EcsRecord) { ECS_NONE, 0, 0 };
+    return (EcsEntity) { index, generation };
+}
+
+bool IsEcsEntityAlive(const EcsWorld* world, EcsEntity entity)
+{
+    return
+           entity.index < world->entityCapacity
+        && world->generations[entity.index] == entity.generation
+        && (entity.generation & 1u) != 0;
+}
+
+void DestroyEcsEntity(EcsWorld* world, EcsEntity entity)
+{
+    if (!IsEcsEntityAlive(world, entity))
+        return;
+
+    if (world->records[entity.index].archetype != ECS_NONE)
+        FreeEcsRow(world, world->records[entity.index]);
+    ++world->generations[entity.index];
+    world->freeList[world->freeCount++] = entity.index;
+}
+
+// Sets the component to value, or to zero if value is NULL, adding it if
+// the entity does not have it. Returns where it is stored, which moves
+// with the next structural change to its archetype; NULL if the entity
+// is dead.
+void* AddEcsComponent(EcsWorld* world, EcsEntity entity, EcsComponent component, const void* value)
+{
+    if (!IsEcsEntityAlive(world, entity) || component >= world->componentCount)
+        return NULL;
+
+    uint32_t from = world->records[entity.index].archetype;
+    MoveEcsEntity(world, entity.index, GetEcsArchetypeEdge(world, from != ECS_NONE ? from : 0, component, true));
+    SetEcsComponent(world, entity.index, component, value);
+    return GetEcsComponent(world, entity, component);
+}
+
+void RemoveEcsComponent(EcsWorld* world, EcsEntity entity, EcsComponent component)
+{
+    if (!HasEcsComponent(world, entity, component))
+        return;
+
+    uint32_t from = world->records[entity.index].archetype;
+    MoveEcsEntity(world, entity.index, GetEcsArchetypeEdge(world, from, component, false));
+}
+
+bool HasEcsComponent(const EcsWorld* world, EcsEntity entity, EcsComponent component)
+{
+    if (!IsEcsEntityAlive(world, entity) || component >= world->componentCount)
+        return false;
+
+    uint32_t archetype = world->records[entity.index].archetype;
+    return archetype != ECS_NONE && (world->archetypes[archetype].mask & ECS_MASK(component)) != 0;
+}
+
+void* GetEcsComponent(EcsWorld* world, EcsEntity entity, EcsComponent component)
+{
+    if (!HasEcsComponent(world, entity, component))
+        return NULL;
+
+    EcsRecord record = world->records[entity.index];
+    const EcsArchetype* archetype = &world->archetypes[record.archetype];
+    return GetEcsCell(world, archetype, &archetype->chunks[record.chunk], record.row, component);
+}
+
+// Entities with every component in all and none in none. Queries are
+// cached by world, so asking again for the same one is cheap and shares
+// its archetype list.
+EcsQuery* GetEcsQuery(EcsWorld* world, EcsMask all, EcsMask none)
+{
+    for (uint32_t i = 0; i < world->queryCount; ++i)
+    {
+        if (world->queries[i]->all == all && world->queries[i]->none == none)
+            return world->queries[i];
+    }
+
+    EcsQuery* query = (EcsQuery*)calloc(1, sizeof(EcsQuery));
+    query->all = all;
+    query->none = none;
+    world->queries = (EcsQuery**)realloc(world->queries, (world->queryCount + 1) * sizeof(EcsQuery*));
+    world->queries[world->queryCount++] = query;
+    return query;
+}
+
+EcsIter IterateEcsQuery(EcsWorld* world, EcsQuery* query)
+{
+    for (; query->checked < world->archetypeCount; ++query->checked)
+    {
+        EcsMask mask = world->archetypes[query->checked].mask;
+        if ((mask & query->all) != query->all || (mask & query->none) != 0)
+            continue;
+
+        if (query->count == query->capacity)
+        {
+            query->capacity = query->capacity > 0 ? query->capacity * 2 : 8;
+            query->archetypes = (uint32_t*)realloc(query->archetypes, query->capacity * sizeof(uint32_t));
+        }
+        query->archetypes[query->count++] = query->checked;
+    }
+
+    return (EcsIter) { world, query, 0, 0, NULL, NULL, NULL, 0 };
+}
+
+// Moves to the next chunk with entities in it; false once there are none
+// left.
+bool NextEcsChunk(EcsIter* it)
+{
+    while (it->next < it->query->count)
+    {
+        const EcsArchetype* archetype = &it->world->archetypes[it->query->archetypes[it->next]];
+        if (it->chunk < archetype->chunkCount)
+        {
+            const EcsChunk* chunk = &archetype->chunks[it->chunk++];
+            it->archetype = archetype;
+            it->data = chunk->data;
+            it->entities = (const EcsEntity*)chunk->data;
+            it->count = chunk->count;
+            return true;
+        }
+        ++it->next;
+        it->chunk = 0;
+    }
+    return false;
+}
+
+// The current chunk's array of component, it->count long; NULL if its
+// archetype does not have it, for components a query does not require.
+void* GetEcsColumn(const EcsIter* it, EcsComponent component)
+{
+    if (component >= ECS_MAX_COMPONENTS || !(it->archetype->mask & ECS_MASK(component)))
+        return NULL;
+    return it->data + it->archetype->offsets[component];
+}
+
+// value is copied now; NULL queues a zeroed component.
+void QueueAddEcsComponent(
+    EcsCommands* commands, const EcsWorld* world, EcsEntity entity,
+    EcsComponent component, const void* value)
+{
+    if (component >= world->componentCount)
+        return;
+
+    size_t offset = ECS_ZERO_VALUE;
+    if (value != NULL)
+    {
+        size_t size = world->componentSizes[component];
+        if (commands->valueSize + size > commands->valueCapacity)
+        {
+            commands->valueCapacity = commands->valueCapacity > 0 ? commands->valueCapacity * 2 : 1024;
+            while (commands->valueSize + size > commands->valueCapacity)
+                commands->valueCapacity *= 2;
+            commands->values = (unsigned char*)realloc(commands->values, commands->valueCapacity);
+        }
+        offset = commands->valueSize;
+        memcpy(commands->values + offset, value, size);
+        commands->valueSize += size;
+    }
+
+    *PushEcsCommand(commands) = (EcsCommand) { ECS_COMMAND_ADD, component, entity, offset };
+}
+
+void QueueRemoveEcsComponent(EcsCommands* commands, EcsEntity entity, EcsComponent component)
+{
+    *PushEcsCommand(commands) = (EcsCommand) { ECS_COMMAND_REMOVE, component, entity, 0 };
+}
+
+void QueueDestroyEcsEntity(EcsCommands* commands, EcsEntity entity)
+{
+    *PushEcsCommand(commands) = (EcsCommand) { ECS_COMMAND_DESTROY, 0, entity, 0 };
+}
+
+// Runs the queued commands in order and empties the buffer for reuse.
+// Commands on entities that died in the meantime are dropped.
+void RunEcsCommands(EcsCommands* commands, EcsWorld* world)
+{
+    for (size_t i = 0; i < commands->count;)
+    {
+        size_t end = i + 1;
+        while (end < commands->count && IsSameEcsEntity(commands->items[end].entity, commands->items[i].entity))
+            ++end;
+        RunEcsEntityCommands(world, &commands->items[i], end - i, commands->values);
+        i = end;
+    }
+    commands->count = 0;
+    commands->valueSize = 0;
+}
+
+void FreeEcsCommands(EcsCommands* commands)
+{
+    free(commands->items);
+    free(commands->values);
+    memset(commands, 0, sizeof(EcsCommands));
+}
@@ -0,0 +1,168 @@
+#ifndef ECS_H
+#define ECS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Entity-component storage for game objects. Entities with the same set of
+// components share an archetype, which stores them in fixed-size chunks,
+// one tightly packed array per component, so a system touches only the
+// columns it reads.
+//
+//     EcsIter it = IterateEcsQuery(world, query);
+//     while (NextEcsChunk(&it))
+//     {
+//         Position* p = (Position*)GetEcsColumn(&it, position);
+//         for (uint32_t i = 0; i < it.count; ++i) ...
+//     }
+//
+// Adding or removing components or entities moves rows between chunks, so
+// systems that do it while iterating queue the changes on an EcsCommands
+// and run them afterwards.
+
+#define ECS_MAX_COMPONENTS 64
+#define ECS_CHUNK_SIZE 16384
+#define ECS_COLUMN_ALIGN 16
+#define ECS_NONE UINT32_MAX
+#define ECS_ENTITY_NULL (EcsEntity) { UINT32_MAX, 0 }
+#define ECS_MASK(component) ((EcsMask)1 << (component))
+
+typedef uint32_t EcsComponent;
+typedef uint64_t EcsMask;
+
+// Generational reference to an entity, stale once it is destroyed, as
+// with UIHandle. A slot is live while its generation is odd.
+typedef struct EcsEntity
+{
+    uint32_t index;
+    uint32_t generation;
+} EcsEntity;
+
+// Where a live entity's components are. archetype is ECS_NONE for an
+// entity reserved by a command buffer that has not run yet.
+typedef struct EcsRecord
+{
+    uint32_t archetype;
+    uint32_t chunk;
+    uint32_t row;
+} EcsRecord;
+
+// Starts with the entity column, then one column per component in id
+// order, each at ECS_COLUMN_ALIGN.
+typedef struct EcsChunk
+{
+    unsigned char* data;
+    uint32_t count;
+} EcsChunk;
+
+// All chunks but the last in use are full; removing an entity moves the
+// last one into its row. Chunks past chunkCount are kept for reuse.
+// addEdges and removeEdges cache the archetype one component away, so
+// most structural changes find their target without a lookup.
+typedef struct EcsArchetype
+{
+    EcsMask mask;
+    uint32_t capacity;
+    size_t chunkSize;
+    uint32_t offsets[ECS_MAX_COMPONENTS];
+    EcsChunk* chunks;
+    uint32_t chunkCount;
+    uint32_t chunkCapacity;
+    uint32_t addEdges[ECS_MAX_COMPONENTS];
+    uint32_t removeEdges[ECS_MAX_COMPONENTS];
+} EcsArchetype;
+
+// Archetypes are never removed, only added, so a query keeps the list of
+// those it matches and only checks the ones added since it last ran.
+typedef struct EcsQuery
+{
+    EcsMask all;
+    EcsMask none;
+    uint32_t* archetypes;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t checked;
+} EcsQuery;
+
+typedef struct EcsWorld
+{
+    uint32_t componentSizes[ECS_MAX_COMPONENTS];
+    uint32_t componentCount;
+    EcsArchetype* archetypes;
+    uint32_t archetypeCount;
+    uint32_t archetypeCapacity;
+    EcsRecord* records;
+    uint32_t* generations;
+    uint32_t* freeList;
+    uint32_t freeCount;
+    uint32_t entityCapacity;
+    EcsQuery** queries;
+    uint32_t queryCount;
+} EcsWorld;
+
+// One chunk at a time of the entities a query matches.
+typedef struct EcsIter
+{
+    EcsWorld* world;
+    const EcsQuery* query;
+    uint32_t next;
+    uint32_t chunk;
+    const EcsArchetype* archetype;
+    unsigned char* data;
+    const EcsEntity* entities;
+    uint32_t count;
+} EcsIter;
+
+typedef enum EcsCommandKind
+{
+    ECS_COMMAND_ADD, ECS_COMMAND_REMOVE, ECS_COMMAND_DESTROY
+} EcsCommandKind;
+
+typedef struct EcsCommand
+{
+    EcsCommandKind kind;
+    EcsComponent component;
+    EcsEntity entity;
+    size_t value;
+} EcsCommand;
+
+// Structural changes queued to run later, in order. Component values are
+// copied into values when they are queued.
+typedef struct EcsCommands
+{
+    EcsCommand* items;
+    size_t count;
+    size_t capacity;
+    unsigned char* values;
+    size_t valueSize;
+    size_t valueCapacity;
+} EcsCommands;
+
+EcsWorld* CreateEcsWorld();
+void DeleteEcsWorld(EcsWorld* world);
+EcsComponent RegisterEcsComponent(EcsWorld* world, size_t size);
+
+EcsEntity CreateEcsEntity(EcsWorld* world);
+EcsEntity ReserveEcsEntity(EcsWorld* world);
+bool IsEcsEntityAlive(const EcsWorld* world, EcsEntity entity);
+void DestroyEcsEntity(EcsWorld* world, EcsEntity entity);
+void* AddEcsComponent(EcsWorld* world, EcsEntity entity, EcsComponent component, const void* value);
+void RemoveEcsComponent(EcsWorld* world, EcsEntity entity, EcsComponent component);
+bool HasEcsComponent(const EcsWorld* world, EcsEntity entity, EcsComponent component);
+void* GetEcsComponent(EcsWorld* world, EcsEntity entity, EcsComponent component);
+
+EcsQuery* GetEcsQuery(EcsWorld* world, EcsMask all, EcsMask none);
+EcsIter IterateEcsQuery(EcsWorld* world, EcsQuery* query);
+bool NextEcsChunk(EcsIter* it);
+void* GetEcsColumn(const EcsIter* it, EcsComponent component);
+
+void QueueAddEcsComponent(
+    EcsCommands* commands, const EcsWorld* world, EcsEntity entity,
+    EcsComponent component, const void* value);
+void QueueRemoveEcsComponent(EcsCommands* commands, EcsEntity entity, EcsComponent component);
+void QueueDestroyEcsEntity(EcsCommands* commands, EcsEntity entity);
+void RunEcsCommands(EcsCommands* commands, EcsWorld* world);
+void FreeEcsCommands(EcsCommands* commands);
+
+#endif
@@ -0,0 +1,54 @@
+#include "game.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "util.h"
+
+// -----------------------------------------------------------------------------
+
+void StartGameClock(GameClock* clock, double now)
+{
+    memset(clock, 0, sizeof(GameClock));
+    clock->lastTime = now;
+}
+
+// Returns how many ticks to run this frame.
+uint32_t AdvanceGameClock(GameClock* clock, double now)
+{
+    double elapsed = min(max(now - clock->lastTime, 0.0), GAME_MAX_FRAME_SECONDS);
+    clock->lastTime = now;
+    clock->accumulator += elapsed;
+
+    uint32_t ticks = 0;
+    while (clock->accumulator >= GAME_TICK_SECONDS)
+    {
+        clock->accumulator -= GAME_TICK_SECONDS;
+        ++ticks;
+    }
+    clock->tick += ticks;
+    return ticks;
+}
+
+// -----------------------------------------------------------------------------
+
+void InitGameState(GameState* state)
+{
+    memset(state, 0, sizeof(GameState));
+}
+
+void UpdateGameState(const GameState* prev, GameState* next)
+{
+    *next = *prev;
+    next->tick = prev->tick + 1;
+    next->time = (double)next->tick * GAME_TICK_SECONDS;
+}
+
+// What is drawn alpha of the way from prev to next. Counts are not
+// blended; they are those of the last state reached, next.
+void InterpolateGameState(const GameState* prev, const GameState* next, float alpha, GameState* out)
+{
+    *out = *next;
+    out->time = prev->time + (next->time - prev->time) * alpha;
+}
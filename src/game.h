@@ -0,0 +1,95 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Game rules run in fixed ticks of GAME_TICK_SECONDS, however fast frames
+// are drawn. Nothing here calls raylib, so the rules can run headless.
+
+#define GAME_TICK_RATE 60
+#define GAME_TICK_SECONDS (1.0 / GAME_TICK_RATE)
+#define GAME_MAX_FRAME_SECONDS 0.25
+#define GAME_CACHE_LINE 64
+#define GAME_SNAPSHOT_FRESH 0x4u
+#define GAME_SNAPSHOT_SLOT_MASK 0x3u
+
+// Real time is added to accumulator as it passes and spent a tick at a
+// time; what is left over is time not yet simulated.
+// Gaps longer than GAME_MAX_FRAME_SECONDS, from a hitch or from waiting
+// for events, are dropped rather than caught up on.
+typedef struct GameClock
+{
+    double lastTime;
+    double accumulator;
+    uint64_t tick;
+} GameClock;
+
+// Everything the rules advance. A tick reads one state and writes the
+// next, so the last two states are always at hand to draw between.
+typedef struct GameState
+{
+    uint64_t tick;
+    double time;
+} GameState;
+
+// What the simulation shows the renderer: the last two states it reached,
+// and when it reached the newer one, on the GetGameTime clock.
+typedef struct GameSnapshot
+{
+    GameState prev;
+    GameState state;
+    double time;
+} GameSnapshot;
+
+// Lock-free triple buffer. The writer fills back, the reader reads front,
+// and middle is traded with either side in one atomic exchange; its
+// GAME_SNAPSHOT_FRESH bit says it holds a snapshot the reader has not
+// taken yet. Neither side ever waits for the other. Slots sit on their
+// own cache lines so the two threads do not contend for them.
+typedef struct GameSnapshotBuffer
+{
+    struct
+    {
+        _Alignas(GAME_CACHE_LINE) GameSnapshot snapshot;
+    } slots[3];
+    _Alignas(GAME_CACHE_LINE) atomic_uint middle;
+    _Alignas(GAME_CACHE_LINE) uint32_t back;
+    _Alignas(GAME_CACHE_LINE) uint32_t front;
+} GameSnapshotBuffer;
+
+// Runs the game rules on a thread of their own, at GAME_TICK_RATE, and
+// publishes a snapshot after every batch of ticks. A long tick delays the
+// next snapshot but never a frame.
+typedef struct GameSim
+{
+    pthread_t thread;
+    atomic_bool running;
+    GameClock clock;
+    GameState prev;
+    GameState state;
+    GameSnapshotBuffer snapshots;
+} GameSim;
+
+double GetGameTime();
+
+void StartGameClock(GameClock* clock, double now);
+uint32_t AdvanceGameClock(GameClock* clock, double now);
+
+void InitGameState(GameState* state);
+void UpdateGameState(const GameState* prev, GameState* next);
+void InterpolateGameState(const GameState* prev, const GameState* next, float alpha, GameState* out);
+
+void InitGameSnapshotBuffer(GameSnapshotBuffer* buffer, const GameSnapshot* initial);
+GameSnapshot* GetGameSnapshotBack(GameSnapshotBuffer* buffer);
+void PublishGameSnapshot(GameSnapshotBuffer* buffer);
+const GameSnapshot* ReadGameSnapshot(GameSnapshotBuffer* buffer);
+
+bool StartGameSim(GameSim* sim);
+const GameSnapshot* GetLatestGameSnapshot(GameSim* sim);
+float GetGameSnapshotAlpha(const GameSnapshot* snapshot, double now);
+void StopGameSim(GameSim* sim);
+
+#endif
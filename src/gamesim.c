@@ -0,0 +1,137 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "game.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "util.h"
+
+// -----------------------------------------------------------------------------
+
+// Monotonic seconds, for both threads to measure against.
+double GetGameTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void SleepGameSeconds(double seconds)
+{
+    struct timespec ts;
+    ts.tv_sec = (time_t)seconds;
+    ts.tv_nsec = (long)((seconds - (double)ts.tv_sec) * 1e9);
+    nanosleep(&ts, NULL);
+}
+
+// -----------------------------------------------------------------------------
+
+// Slot 0 starts out as the front, 1 as the middle and 2 as the back, all
+// holding initial, so the reader has a snapshot before the first publish.
+void InitGameSnapshotBuffer(GameSnapshotBuffer* buffer, const GameSnapshot* initial)
+{
+    memset(buffer, 0, sizeof(GameSnapshotBuffer));
+    for (int i = 0; i < 3; ++i)
+        buffer->slots[i].snapshot = *initial;
+    buffer->front = 0;
+    buffer->back = 2;
+    atomic_init(&buffer->middle, 1u);
+}
+
+GameSnapshot* GetGameSnapshotBack(GameSnapshotBuffer* buffer)
+{
+    return &buffer->slots[buffer->back].snapshot;
+}
+
+// Release, so the snapshot is written before the reader can see it; the
+// slot given back is whichever the reader left in the middle.
+void PublishGameSnapshot(GameSnapshotBuffer* buffer)
+{
+    uint32_t old = atomic_exchange_explicit(
+        &buffer->middle, buffer->back | GAME_SNAPSHOT_FRESH, memory_order_acq_rel);
+    buffer->back = old & GAME_SNAPSHOT_SLOT_MASK;
+}
+
+// The newest snapshot published, or the one read last time if nothing
+// has been published since. Valid until the next read.
+const GameSnapshot* ReadGameSnapshot(GameSnapshotBuffer* buffer)
+{
+    if (atomic_load_explicit(&buffer->middle, memory_order_relaxed) & GAME_SNAPSHOT_FRESH)
+    {
+        uint32_t old = atomic_exchange_explicit(&buffer->middle, buffer->front, memory_order_acq_rel);
+        buffer->front = old & GAME_SNAPSHOT_SLOT_MASK;
+    }
+    return &buffer->slots[buffer->front].snapshot;
+}
+
+// -----------------------------------------------------------------------------
+
+// The profiler is not thread safe, so nothing in here is profiled.
+static void* RunGameSim(void* arg)
+{
+    GameSim* sim = (GameSim*)arg;
+    while (atomic_load_explicit(&sim->running, memory_order_relaxed))
+    {
+        double now = GetGameTime();
+        uint32_t ticks = AdvanceGameClock(&sim->clock, now);
+        for (uint32_t i = 0; i < ticks; ++i)
+        {
+            sim->prev = sim->state;
+            UpdateGameState(&sim->prev, &sim->state);
+        }
+
+        if (ticks > 0)
+        {
+            GameSnapshot* snapshot = GetGameSnapshotBack(&sim->snapshots);
+            snapshot->prev = sim->prev;
+            snapshot->state = sim->state;
+            snapshot->time = now - sim->clock.accumulator;
+            PublishGameSnapshot(&sim->snapshots);
+        }
+
+        SleepGameSeconds(GAME_TICK_SECONDS - sim->clock.accumulator);
+    }
+    return NULL;
+}
+
+// sim is owned by the caller, as its buffer needs cache line alignment
+// that the heap does not promise everywhere. Returns false if the thread
+// cannot be started.
+bool StartGameSim(GameSim* sim)
+{
+    memset(sim, 0, sizeof(GameSim));
+    double now = GetGameTime();
+    InitGameState(&sim->state);
+    sim->prev = sim->state;
+    StartGameClock(&sim->clock, now);
+
+    GameSnapshot initial = { sim->prev, sim->state, now };
+    InitGameSnapshotBuffer(&sim->snapshots, &initial);
+    atomic_init(&sim->running, true);
+    return pthread_create(&sim->thread, NULL, RunGameSim, sim) == 0;
+}
+
+// Only the thread that draws may call this.
+const GameSnapshot* GetLatestGameSnapshot(GameSim* sim)
+{
+    return ReadGameSnapshot(&sim->snapshots);
+}
+
+// How far to draw between prev and state at now. Frames are drawn a tick
+// behind the simulation, so alpha reaches 1 just as the next snapshot is
+// due; if it is late, the frame holds at state.
+float GetGameSnapshotAlpha(const GameSnapshot* snapshot, double now)
+{
+    return (float)min(max((now - snapshot->time) / GAME_TICK_SECONDS, 0.0), 1.0);
+}
+
+void StopGameSim(GameSim* sim)
+{
+    atomic_store_explicit(&sim->running, false, memory_order_relaxed);
+    pthread_join(sim->thread, NULL);
+}
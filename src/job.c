@@ -0,0 +1,385 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "job.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "util.h"
+
+// Chase-Lev deque. Only its owner moves bottom, pushing and taking jobs
+// there; thieves race each other, and the owner for the last job, to move
+// top with a compare and swap.
+typedef struct JobDeque
+{
+    _Alignas(JOB_CACHE_LINE) atomic_llong top;
+    _Alignas(JOB_CACHE_LINE) atomic_llong bottom;
+    _Alignas(JOB_CACHE_LINE) _Atomic(Job*) items[JOB_DEQUE_CAPACITY];
+} JobDeque;
+
+// Workers with nothing to steal sleep on wake. Every push bumps epoch, so
+// a worker that read it before looking for work knows not to sleep if
+// anything was pushed since.
+typedef struct JobSystem
+{
+    JobDeque deques[JOB_MAX_THREADS];
+    pthread_t workers[JOB_MAX_THREADS];
+    uint32_t threadCount;
+    uint32_t workerCount;
+    bool started;
+    atomic_bool running;
+    atomic_uint epoch;
+    atomic_uint sleeping;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    Job** mainJobs;
+    size_t mainHead;
+    size_t mainCount;
+    size_t mainCapacity;
+} JobSystem;
+
+// One slice of a RunJobsForRange call.
+typedef struct JobRange
+{
+    JobRangeFunc func;
+    void* data;
+    size_t start;
+    size_t end;
+} JobRange;
+
+static JobSystem scheduler = { 0 };
+static _Thread_local int jobThread = -1;
+
+// -----------------------------------------------------------------------------
+
+static uint32_t GetJobCoreCount()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (uint32_t)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (uint32_t)count : 1;
+#endif
+}
+
+// Returns false if the deque is full.
+static bool PushJob(JobDeque* deque, Job* job)
+{
+    long long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    if (bottom - top >= JOB_DEQUE_CAPACITY)
+        return false;
+
+    atomic_store_explicit(&deque->items[bottom & (JOB_DEQUE_CAPACITY - 1)], job, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_release);
+    return true;
+}
+
+static Job* TakeJob(JobDeque* deque)
+{
+    long long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_seq_cst);
+    long long top = atomic_load_explicit(&deque->top, memory_order_seq_cst);
+    if (top > bottom)
+    {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    Job* job = atomic_load_explicit(&deque->items[bottom & (JOB_DEQUE_CAPACITY - 1)], memory_order_relaxed);
+    if (top == bottom)
+    {
+        if (!atomic_compare_exchange_strong_explicit(
+                &deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed))
+            job = NULL;
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return job;
+}
+
+// Only gives up once the deque is seen empty, not on losing a race.
+static Job* StealJob(JobDeque* deque)
+{
+    for (;;)
+    {
+        long long top = atomic_load_explicit(&deque->top, memory_order_seq_cst);
+        long long bottom = atomic_load_explicit(&deque->bottom, memory_order_seq_cst);
+        if (top >= bottom)
+            return NULL;
+
+        Job* job = atomic_load_explicit(&deque->items[top & (JOB_DEQUE_CAPACITY - 1)], memory_order_relaxed);
+        if (atomic_compare_exchange_strong_explicit(
+                &deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed))
+            return job;
+    }
+}
+
+// Only the main thread queues and runs these, so they need no lock.
+static void PushMainThreadJob(Job* job)
+{
+    if (scheduler.mainCount == scheduler.mainCapacity)
+    {
+        scheduler.mainCapacity = scheduler.mainCapacity > 0 ? scheduler.mainCapacity * 2 : 16;
+        scheduler.mainJobs = (Job**)realloc(scheduler.mainJobs, scheduler.mainCapacity * sizeof(Job*));
+    }
+    scheduler.mainJobs[scheduler.mainCount++] = job;
+}
+
+// In the order they were pushed, as GL calls usually have to be.
+static Job* PopMainThreadJob()
+{
+    Job* job = NULL;
+    if (scheduler.mainHead < scheduler.mainCount)
+    {
+        job = scheduler.mainJobs[scheduler.mainHead++];
+        if (scheduler.mainHead == scheduler.mainCount)
+            scheduler.mainHead = scheduler.mainCount = 0;
+    }
+    return job;
+}
+
+static void RunJob(Job* job)
+{
+    job->func(job->data);
+    atomic_fetch_sub_explicit(&job->counter->pending, 1, memory_order_release);
+}
+
+// Own jobs first, newest first while they are still in cache; then the
+// oldest of another thread's, starting from a different thread each time
+// so thieves spread out.
+static Job* FindJob(int thread, uint32_t* seed)
+{
+    Job* job = TakeJob(&scheduler.deques[thread]);
+    if (job == NULL && thread == 0)
+        job = PopMainThreadJob();
+
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+    for (uint32_t i = 0; job == NULL && i < scheduler.threadCount; ++i)
+    {
+        uint32_t victim = (*seed + i) % scheduler.threadCount;
+        if (victim != (uint32_t)thread)
+            job = StealJob(&scheduler.deques[victim]);
+    }
+    return job;
+}
+
+static void WakeJobWorkers(size_t count)
+{
+    atomic_fetch_add(&scheduler.epoch, 1);
+    if (atomic_load(&scheduler.sleeping) == 0)
+        return;
+
+    pthread_mutex_lock(&scheduler.lock);
+    if (count == 1)
+        pthread_cond_signal(&scheduler.wake);
+    else
+        pthread_cond_broadcast(&scheduler.wake);
+    pthread_mutex_unlock(&scheduler.lock);
+}
+
+static void* RunJobWorker(void* arg)
+{
+    jobThread = (int)(intptr_t)arg;
+    uint32_t seed = 2654435761u * (uint32_t)jobThread;
+    for (;;)
+    {
+        unsigned epoch = atomic_load(&scheduler.epoch);
+        Job* job = FindJob(jobThread, &seed);
+        if (job != NULL)
+        {
+            RunJob(job);
+            continue;
+        }
+
+        pthread_mutex_lock(&scheduler.lock);
+        atomic_fetch_add(&scheduler.sleeping, 1);
+        while (atomic_load(&scheduler.epoch) == epoch && atomic_load(&scheduler.running))
+            pthread_cond_wait(&scheduler.wake, &scheduler.lock);
+        atomic_fetch_sub(&scheduler.sleeping, 1);
+        bool running = atomic_load(&scheduler.running);
+        pthread_mutex_unlock(&scheduler.lock);
+        if (!running)
+            return NULL;
+    }
+}
+
+static void RunJobRange(void* data)
+{
+    JobRange* range = (JobRange*)data;
+    range->func(range->data, range->start, range->end);
+}
+
+// -----------------------------------------------------------------------------
+
+// Starts workerCount threads besides the calling one, which becomes the
+// main thread; with 0, one fewer than there are cores. Returns false if
+// no worker could be started, in which case jobs still run, just all on
+// the main thread. Calls after the first only report how the first went.
+bool StartJobSystem(uint32_t workerCount)
+{
+    if (scheduler.started)
+        return scheduler.workerCount > 0;
+
+    if (workerCount == 0)
+        workerCount = max(GetJobCoreCount(), 2u) - 1;
+    workerCount = min(workerCount, (uint32_t)JOB_MAX_THREADS - 1);
+
+    jobThread = 0;
+    scheduler.threadCount = workerCount + 1;
+    scheduler.started = true;
+    atomic_store(&scheduler.running, true);
+    pthread_mutex_init(&scheduler.lock, NULL);
+    pthread_cond_init(&scheduler.wake, NULL);
+
+    // Workers steal from every deque as soon as they start, so the count
+    // is fixed before the first starts. If a later one fails to start, its
+    // deque and those after it are left counted in, and stay empty; only
+    // if none started does the count drop back to the main thread alone,
+    // which nothing else reads from then.
+    for (uint32_t i = 1; i <= workerCount; ++i)
+    {
+        if (pthread_create(&scheduler.workers[i], NULL, RunJobWorker, (void*)(intptr_t)i) != 0)
+            break;
+        scheduler.workerCount = i;
+    }
+    if (scheduler.workerCount == 0)
+        scheduler.threadCount = 1;
+    return scheduler.workerCount > 0;
+}
+
+// Including the main thread.
+uint32_t GetJobThreadCount()
+{
+    return scheduler.started ? scheduler.threadCount : 1;
+}
+
+// From 0 for the main thread to GetJobThreadCount() - 1, so threads can
+// keep scratch memory of their own; -1 on threads the scheduler does not
+// know.
+int GetJobThreadIndex()
+{
+    return jobThread;
+}
+
+// Jobs run on a thread the scheduler does not know, such as the game
+// simulation's, are run right away there. JOB_MAIN_THREAD jobs may only
+// be run from the main thread: it can be blocked waiting for input
+// events, and nothing another thread queues would wake it.
+void RunJobs(Job* jobs, size_t count, JobCounter* counter)
+{
+    atomic_fetch_add_explicit(&counter->pending, (unsigned)count, memory_order_relaxed);
+    size_t pushed = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        Job* job = &jobs[i];
+        job->counter = counter;
+        if (scheduler.started && (job->flags & JOB_MAIN_THREAD))
+        {
+            assert(jobThread == 0);
+            PushMainThreadJob(job);
+        }
+        else if (scheduler.started && jobThread >= 0 && PushJob(&scheduler.deques[jobThread], job))
+            ++pushed;
+        else
+            RunJob(job);
+    }
+
+    if (pushed > 0)
+        WakeJobWorkers(pushed);
+}
+
+// Calls func over [0, count) in slices of at least minBatch, one job per
+// slice, and returns once all of them are done.
+void RunJobsForRange(JobRangeFunc func, void* data, size_t count, size_t minBatch)
+{
+    if (count == 0)
+        return;
+
+    size_t sliceCount = (count + max(minBatch, (size_t)1) - 1) / max(minBatch, (size_t)1);
+    sliceCount = min(sliceCount, min((size_t)GetJobThreadCount() * 4, (size_t)JOB_MAX_RANGES));
+    if (sliceCount <= 1)
+    {
+        func(data, 0, count);
+        return;
+    }
+
+    Job sliceJobs[JOB_MAX_RANGES];
+    JobRange ranges[JOB_MAX_RANGES];
+    for (size_t i = 0; i < sliceCount; ++i)
+    {
+        ranges[i] = (JobRange) { func, data, count * i / sliceCount, count * (i + 1) / sliceCount };
+        sliceJobs[i] = (Job) { RunJobRange, &ranges[i], 0, NULL };
+    }
+
+    JobCounter counter = { 0 };
+    RunJobs(sliceJobs, sliceCount, &counter);
+    WaitForJobCounter(&counter);
+}
+
+void WaitForJobCounter(JobCounter* counter)
+{
+    uint32_t seed = 2654435761u * (uint32_t)(jobThread + 2);
+    while (atomic_load_explicit(&counter->pending, memory_order_acquire) > 0)
+    {
+        Job* job = scheduler.started && jobThread >= 0 ? FindJob(jobThread, &seed) : NULL;
+        if (job != NULL)
+            RunJob(job);
+        else
+            sched_yield();
+    }
+}
+
+// Runs the JOB_MAIN_THREAD jobs queued so far. Call it once a frame from
+// the main thread; they also run while it waits on a counter. Returns
+// whether it ran any, as those may have left work for the next frame.
+bool RunMainThreadJobs()
+{
+    if (jobThread != 0)
+        return false;
+
+    bool ran = false;
+    Job* job;
+    while ((job = PopMainThreadJob()) != NULL)
+    {
+        RunJob(job);
+        ran = true;
+    }
+    return ran;
+}
+
+// Jobs still queued when this is called may never run.
+void StopJobSystem()
+{
+    if (!scheduler.started)
+        return;
+
+    pthread_mutex_lock(&scheduler.lock);
+    atomic_store(&scheduler.running, false);
+    pthread_cond_broadcast(&scheduler.wake);
+    pthread_mutex_unlock(&scheduler.lock);
+    for (uint32_t i = 1; i <= scheduler.workerCount; ++i)
+        pthread_join(scheduler.workers[i], NULL);
+
+    pthread_mutex_destroy(&scheduler.lock);
+    pthread_cond_destroy(&scheduler.wake);
+    free(scheduler.mainJobs);
+    memset(&scheduler, 0, sizeof(JobSystem));
+    jobThread = -1;
+}
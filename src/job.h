@@ -0,0 +1,57 @@
+#ifndef JOB_H
+#define JOB_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Work-stealing job scheduler. Each thread pushes and pops jobs at the
+// bottom of a deque of its own; idle threads steal from the top of
+// others'. The thread that starts the scheduler takes part too, as thread
+// 0, whenever it waits on a counter.
+//
+//     JobCounter counter = { 0 };
+//     RunJobs(jobs, count, &counter);
+//     WaitForJobCounter(&counter);    // runs jobs itself until all are done
+
+#define JOB_MAX_THREADS 64
+#define JOB_DEQUE_CAPACITY 1024
+#define JOB_MAX_RANGES 256
+#define JOB_CACHE_LINE 64
+
+// Only runs on the thread that started the scheduler, for raylib and GL
+// calls, and may only be queued from that thread too.
+#define JOB_MAIN_THREAD 0x1u
+
+typedef void (*JobFunc)(void* data);
+typedef void (*JobRangeFunc)(void* data, size_t start, size_t end);
+
+// How many jobs run against it have yet to finish. A job that has to wait
+// for others waits on their counter, and runs jobs meanwhile rather than
+// block a thread.
+typedef struct JobCounter
+{
+    atomic_uint pending;
+} JobCounter;
+
+// Jobs are run where they are, not copied, so they must outlive their
+// counter reaching zero.
+typedef struct Job
+{
+    JobFunc func;
+    void* data;
+    uint32_t flags;
+    JobCounter* counter;
+} Job;
+
+bool StartJobSystem(uint32_t workerCount);
+uint32_t GetJobThreadCount();
+int GetJobThreadIndex();
+void RunJobs(Job* jobs, size_t count, JobCounter* counter);
+void RunJobsForRange(JobRangeFunc func, void* data, size_t count, size_t minBatch);
+void WaitForJobCounter(JobCounter* counter);
+bool RunMainThreadJobs();
+void StopJobSystem();
+
+#endif
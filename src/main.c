@@ -5,64 +5,185 @@
 
 #include "raylib.h"
 
+#include "game.h"
+#include "job.h"
+#include "profile.h"
 #include "ui.h"
+#include "uibackend.h"
 
 #define DESIGN_WIDTH 800
 #define DESIGN_HEIGHT 600
+#define TITLE_SCENE_PATH "res/title.uis"
+#define SCENE_PATH_MAX 1024
+
+// The window in design units. The UI is scaled to fit DESIGN_WIDTH x
+// DESIGN_HEIGHT but laid out over the whole window.
+static UIRect GetWindowLayoutBounds(ScreenTransform t)
+{
+    return (UIRect) { 0, 0, GetScreenWidth() / t.scale, GetScreenHeight() / t.scale };
+}
+
+// Ids are looked up by key again after a reload, as elements the file
+// dropped and added back get new ones.
+static void BindTitleScene(UILayout* layout, UIScene* scene, UILayoutId root, UILayoutId title)
+{
+    BindUILayoutElement(layout, root, FindUISceneElement(scene, "background"));
+    BindUILayoutElement(layout, title, FindUISceneElement(scene, "title"));
+}
 
 int main()
 {
+    // Frames are paced by vsync unless built with UNCAPPED=1; game speed
+    // does not depend on either, as the rules run on their own clock.
+#ifdef WARMAGIC_UNCAPPED
     SetConfigFlags(FLAG_WINDOW_RESIZABLE);
+#else
+    SetConfigFlags(FLAG_WINDOW_RESIZABLE | FLAG_VSYNC_HINT);
+#endif
     InitWindow(DESIGN_WIDTH, DESIGN_HEIGHT, "Warmagic");
+    InitUIBackend();
 
-    SetTargetFPS(100);
-
-    ScreenTransform t = GetScreenTransform(
+    ScreenTransform t = GetScreenScaleTransform(
         GetScreenWidth(),
         GetScreenHeight(),
         DESIGN_WIDTH,
         DESIGN_HEIGHT);
 
-    UIElement* background = CreateSolidRect(
-        (UIRect) { 0, 0, DESIGN_WIDTH, DESIGN_HEIGHT },
-        WARMAGIC_STYLE_NOBORDER);
+    char scenePath[SCENE_PATH_MAX];
+    snprintf(scenePath, sizeof(scenePath), "%s%s", GetApplicationDirectory(), TITLE_SCENE_PATH);
+    UIScene* scene = LoadUIScene(scenePath, NULL, NULL);
+    if (scene == NULL)
+    {
+        TraceLog(LOG_ERROR, "UI: Failed to load %s", TITLE_SCENE_PATH);
+        CloseUIBackend();
+        CloseWindow();
+        return 1;
+    }
+    SetUISceneTransform(scene, t);
+
+    UILayout* layout = CreateUILayout();
+    UILayoutId root = AddUILayoutNode(layout, UILAYOUT_NONE, UI_LAYOUT_ANCHOR);
+    UILayoutId title = AddUILayoutNode(layout, root, UI_LAYOUT_ANCHOR);
+    SetUILayoutAnchors(
+        layout, title,
+        (UIRect) { 0.5f, 0, 0.5f, 0 },
+        (UIRect) { -130, 0, 130, 60 });
+    BindTitleScene(layout, scene, root, title);
+    UpdateUILayout(layout, scene, GetWindowLayoutBounds(t));
+
+    if (!StartJobSystem(0))
+        TraceLog(LOG_WARNING, "JOB: Failed to start workers, running jobs on the main thread");
 
-    UIElement* titleLabel = CreateLabel(
-        (UIRect) { 0, 0, 260, 60 },
-        "Warmagic",
-        35,
-        (UIAlign) { H_CENTER, V_CENTER, 0, 0, 0, 0 },
-        WARMAGIC_STYLE);
+    GameSim sim;
+    if (!StartGameSim(&sim))
+    {
+        TraceLog(LOG_ERROR, "GAME: Failed to start the simulation thread");
+        StopJobSystem();
+        DeleteUILayout(layout);
+        DeleteUIScene(scene);
+        CloseUIBackend();
+        CloseWindow();
+        return 1;
+    }
 
-    UIElement* tBackground = CreateEmptyUIElement();
-    ScreenTransformUIElement(background, t, tBackground);
-    UIElement* tTitleLabel = CreateEmptyUIElement();
-    ScreenTransformUIElement(titleLabel, t, tTitleLabel);
+#ifdef WARMAGIC_HOT_RELOAD
+    UISceneWatcher* watcher = WatchUISceneFile(scenePath);
+    if (watcher == NULL)
+        TraceLog(LOG_WARNING, "UI: Failed to watch %s", TITLE_SCENE_PATH);
+#endif
 
     while (!WindowShouldClose())
     {
+        PROFILE_FRAME();
+        BeginUIFrame();
+
+        bool ranJobs;
+        {
+            PROFILE_ZONE("Jobs");
+            ranJobs = RunMainThreadJobs();
+        }
+
+        {
+            PROFILE_ZONE("Input");
+            UpdateUISceneHover(scene, (UIPoint) { GetMousePosition().x, GetMousePosition().y });
+
+#ifdef WARMAGIC_PROFILE
+            if (IsKeyPressed(KEY_F3))
+                ToggleProfileOverlay();
+            if (IsKeyPressed(KEY_F4))
+                DumpProfileTrace(PROFILE_TRACE_PATH);
+#endif
+        }
+
         if (IsWindowResized())
         {
-            t = GetScreenTransform(
+            PROFILE_ZONE("Transform");
+            t = GetScreenScaleTransform(
                 GetScreenWidth(),
                 GetScreenHeight(),
                 DESIGN_WIDTH,
                 DESIGN_HEIGHT);
-            ScreenTransformUIElement(background, t, tBackground);
-            ScreenTransformUIElement(titleLabel, t, tTitleLabel);
+            SetUISceneTransform(scene, t);
+            UpdateUILayout(layout, scene, GetWindowLayoutBounds(t));
+        }
+
+#ifdef WARMAGIC_HOT_RELOAD
+        if (watcher != NULL && PollUISceneWatcher(watcher))
+        {
+            PROFILE_ZONE("Reload");
+            if (ReloadUIScene(scene, scenePath, NULL, NULL))
+            {
+                BindTitleScene(layout, scene, root, title);
+                UpdateUILayout(layout, scene, GetWindowLayoutBounds(t));
+            }
+            else
+            {
+                TraceLog(LOG_WARNING, "UI: Failed to reload %s", TITLE_SCENE_PATH);
+            }
         }
+#endif
+
+        // Only damaged regions are redrawn into the composite. While nothing
+        // changes, EndDrawing blocks until the next input event. File changes
+        // are not input events, so hot reload builds never wait; nor does a
+        // frame that ran main thread jobs, which may have queued more.
+        bool composed = ComposeUIScene(scene, DARKGRAY) || ranJobs;
+#ifdef WARMAGIC_HOT_RELOAD
+        composed = true;
+#endif
+        if (composed)
+            DisableEventWaiting();
+        else
+            EnableEventWaiting();
 
-        BeginDrawing();
-        ClearBackground(DARKGRAY);
-        DrawUIElement(tBackground);
-        DrawUIElement(tTitleLabel);
-        EndDrawing();
+        {
+            PROFILE_ZONE("Present");
+            BeginDrawing();
+            ClearBackground(DARKGRAY);
+            DrawUIComposite();
+#ifdef WARMAGIC_PROFILE
+            DrawProfileOverlay();
+#endif
+        }
+
+        {
+            PROFILE_ZONE("EndDrawing");
+            EndDrawing();
+        }
     }
 
-    DeleteUIElement(background);
-    DeleteUIElement(tBackground);
-    DeleteUIElement(titleLabel);
-    DeleteUIElement(tTitleLabel);
+    StopGameSim(&sim);
+    StopJobSystem();
+#ifdef WARMAGIC_HOT_RELOAD
+    UnwatchUISceneFile(watcher);
+#endif
+    DeleteUILayout(layout);
+    DeleteUIScene(scene);
+    UnloadUIElementPool();
+    UnloadUIStyles();
+    UnloadUITextLines();
+    FreeUIFrameArena();
+    CloseUIBackend();
 
     CloseWindow();
 }
\ No newline at end of file
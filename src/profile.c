@@ -0,0 +1,184 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "profile.h"
+
+#ifdef WARMAGIC_PROFILE
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "ui.h"
+#include "uibackend.h"
+
+#define OVERLAY_X 8.0f
+#define OVERLAY_Y 8.0f
+#define OVERLAY_BAR_WIDTH 2.0f
+#define OVERLAY_HEIGHT 80.0f
+#define OVERLAY_FONT_SIZE 10.0f
+#define OVERLAY_MAX_MS 33.3f
+#define OVERLAY_TARGET_MS 10.0f
+
+typedef struct Profiler
+{
+    ProfileEvent events[PROFILE_MAX_EVENTS];
+    uint64_t eventTotal;
+    ProfileFrame frames[PROFILE_MAX_FRAMES];
+    uint64_t frameTotal;
+    bool overlayVisible;
+} Profiler;
+
+static Profiler profiler = { 0 };
+
+// -----------------------------------------------------------------------------
+
+static uint64_t GetProfileTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static bool IsProfileEventLive(uint64_t event)
+{
+    return profiler.eventTotal - event <= PROFILE_MAX_EVENTS;
+}
+
+static ProfileEvent* GetProfileEvent(uint64_t event)
+{
+    return &profiler.events[event % PROFILE_MAX_EVENTS];
+}
+
+static ProfileFrame* GetProfileFrame(uint64_t frame)
+{
+    return &profiler.frames[frame % PROFILE_MAX_FRAMES];
+}
+
+// -----------------------------------------------------------------------------
+
+ProfileZone BeginProfileZone(const char* name)
+{
+    uint64_t event = profiler.eventTotal++;
+    ProfileEvent* e = GetProfileEvent(event);
+    e->name = name;
+    e->start = GetProfileTime();
+    e->end = e->start;
+    return (ProfileZone) { event };
+}
+
+void EndProfileZone(ProfileZone* zone)
+{
+    if (IsProfileEventLive(zone->event))
+        GetProfileEvent(zone->event)->end = GetProfileTime();
+}
+
+void MarkProfileFrame()
+{
+    uint64_t now = GetProfileTime();
+    if (profiler.frameTotal > 0)
+    {
+        ProfileFrame* frame = GetProfileFrame(profiler.frameTotal - 1);
+        frame->end = now;
+        frame->endEvent = profiler.eventTotal;
+    }
+
+    ProfileFrame* frame = GetProfileFrame(profiler.frameTotal++);
+    frame->start = now;
+    frame->end = now;
+    frame->firstEvent = profiler.eventTotal;
+    frame->endEvent = profiler.eventTotal;
+}
+
+// -----------------------------------------------------------------------------
+
+void ToggleProfileOverlay()
+{
+    profiler.overlayVisible = !profiler.overlayVisible;
+}
+
+// Bars for the last completed frames, newest on the right, with a line at
+// the frame-time target.
+void DrawProfileOverlay()
+{
+    if (!profiler.overlayVisible || profiler.frameTotal < 2)
+        return;
+
+    uint64_t completed = profiler.frameTotal - 1;
+    uint64_t count = min(completed, (uint64_t)PROFILE_MAX_FRAMES - 1);
+    float width = PROFILE_MAX_FRAMES * OVERLAY_BAR_WIDTH;
+    UIRect panel = { OVERLAY_X, OVERLAY_Y, OVERLAY_X + width, OVERLAY_Y + OVERLAY_HEIGHT };
+    DrawUIBackendRect(panel, (Color) { 0, 0, 0, 180 });
+
+    double totalMs = 0;
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        const ProfileFrame* frame = GetProfileFrame(completed - count + i);
+        float ms = (float)((frame->end - frame->start) * 1e-6);
+        float h = min(ms / OVERLAY_MAX_MS, 1.0f) * OVERLAY_HEIGHT;
+        float x = panel.right - (count - i) * OVERLAY_BAR_WIDTH;
+        DrawUIBackendRect(
+            (UIRect) { x, panel.bottom - h, x + OVERLAY_BAR_WIDTH - 1.0f, panel.bottom },
+            ms > OVERLAY_TARGET_MS ? ORANGE : LIME);
+        totalMs += ms;
+    }
+
+    float targetY = panel.bottom - (OVERLAY_TARGET_MS / OVERLAY_MAX_MS) * OVERLAY_HEIGHT;
+    DrawUIBackendRect((UIRect) { panel.left, targetY, panel.right, targetY + 1.0f }, RAYWHITE);
+
+    char label[64];
+    snprintf(label, sizeof(label), "avg %.2f ms", count > 0 ? totalMs / count : 0.0);
+    DrawUIBackendText(
+        label,
+        strlen(label),
+        (UIPoint) { panel.left + 4.0f, panel.top + 4.0f },
+        OVERLAY_FONT_SIZE,
+        OVERLAY_FONT_SIZE * 0.1f,
+        RAYWHITE);
+}
+
+// Writes the completed frames still held in the rings as Chrome trace
+// events (chrome://tracing, Perfetto). Timestamps are in microseconds.
+bool DumpProfileTrace(const char* path)
+{
+    FILE* file = fopen(path, "w");
+    if (file == NULL)
+        return false;
+
+    fprintf(file, "{\"traceEvents\":[\n");
+    bool first = true;
+    uint64_t completed = profiler.frameTotal > 0 ? profiler.frameTotal - 1 : 0;
+    uint64_t count = min(completed, (uint64_t)PROFILE_MAX_FRAMES - 1);
+    for (uint64_t f = completed - count; f < completed; ++f)
+    {
+        const ProfileFrame* frame = GetProfileFrame(f);
+        fprintf(
+            file,
+            "%s{\"name\":\"Frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+            first ? "" : ",\n",
+            frame->start * 1e-3,
+            (frame->end - frame->start) * 1e-3);
+        first = false;
+
+        for (uint64_t e = frame->firstEvent; e < frame->endEvent; ++e)
+        {
+            if (!IsProfileEventLive(e))
+                continue;
+
+            const ProfileEvent* event = GetProfileEvent(e);
+            fprintf(
+                file,
+                ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                event->name,
+                event->start * 1e-3,
+                (event->end - event->start) * 1e-3);
+        }
+    }
+    fprintf(file, "\n]}\n");
+
+    fclose(file);
+    return true;
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Scoped timing zones. They only exist in builds with WARMAGIC_PROFILE
+// defined (make PROFILE=1); otherwise every macro below expands to nothing.
+//
+//     PROFILE_ZONE("Draw");   // timed until the end of the enclosing block
+//     PROFILE_FRAME();        // once per frame, before input is handled
+
+#define PROFILE_MAX_FRAMES 120
+#define PROFILE_MAX_EVENTS (1 << 18)
+#define PROFILE_TRACE_PATH "warmagic-trace.json"
+
+#ifdef WARMAGIC_PROFILE
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#define PROFILE_ZONE(name)                                        \
+    ProfileZone PROFILE_CONCAT(profileZone, __LINE__)             \
+    __attribute__((cleanup(EndProfileZone))) = BeginProfileZone(name)
+#define PROFILE_FRAME() MarkProfileFrame()
+
+typedef struct ProfileZone
+{
+    uint64_t event;
+} ProfileZone;
+
+typedef struct ProfileEvent
+{
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+} ProfileEvent;
+
+// Events are absolute indices into a ring of PROFILE_MAX_EVENTS; a frame
+// owns the events in [firstEvent, endEvent).
+typedef struct ProfileFrame
+{
+    uint64_t start;
+    uint64_t end;
+    uint64_t firstEvent;
+    uint64_t endEvent;
+} ProfileFrame;
+
+ProfileZone BeginProfileZone(const char* name);
+void EndProfileZone(ProfileZone* zone);
+void MarkProfileFrame();
+
+void ToggleProfileOverlay();
+void DrawProfileOverlay();
+bool DumpProfileTrace(const char* path);
+
+#else
+
+#define PROFILE_ZONE(name)
+#define PROFILE_FRAME()
+
+#endif
+
+#endif
@@ -0,0 +1,148 @@
+#include "simd.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86
+#include <immintrin.h>
+#endif
+
+typedef void (*ScaleOffsetFloatsFn)(const float*, float*, size_t, float, float);
+typedef void (*ScaleOffsetFloat4sFn)(
+    const float*, size_t, float*, size_t, size_t, float, float, float);
+
+// -----------------------------------------------------------------------------
+
+static void ScaleOffsetFloatsScalar(
+    const float* in, float* out, size_t count, float scale, float offset)
+{
+    for (size_t i = 0; i < count; ++i)
+        out[i] = in[i] * scale + offset;
+}
+
+static void ScaleOffsetFloat4sScalar(
+    const float* in, size_t inStride, float* out, size_t outStride,
+    size_t count, float scale, float offsetX, float offsetY)
+{
+    for (size_t i = 0; i < count; ++i, in += inStride, out += outStride)
+    {
+        out[0] = in[0] * scale + offsetX;
+        out[1] = in[1] * scale + offsetY;
+        out[2] = in[2] * scale + offsetX;
+        out[3] = in[3] * scale + offsetY;
+    }
+}
+
+#ifdef SIMD_X86
+
+__attribute__((target("sse")))
+static void ScaleOffsetFloat4sSSE(
+    const float* in, size_t inStride, float* out, size_t outStride,
+    size_t count, float scale, float offsetX, float offsetY)
+{
+    __m128 vscale = _mm_set1_ps(scale);
+    __m128 voffset = _mm_setr_ps(offsetX, offsetY, offsetX, offsetY);
+    for (size_t i = 0; i < count; ++i, in += inStride, out += outStride)
+        _mm_storeu_ps(out, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(in), vscale), voffset));
+}
+
+__attribute__((target("sse")))
+static void ScaleOffsetFloatsSSE(
+    const float* in, float* out, size_t count, float scale, float offset)
+{
+    __m128 vscale = _mm_set1_ps(scale);
+    __m128 voffset = _mm_set1_ps(offset);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 v = _mm_loadu_ps(in + i);
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(v, vscale), voffset));
+    }
+
+    ScaleOffsetFloatsScalar(in + i, out + i, count - i, scale, offset);
+}
+
+__attribute__((target("avx")))
+static void ScaleOffsetFloatsAVX(
+    const float* in, float* out, size_t count, float scale, float offset)
+{
+    __m256 vscale = _mm256_set1_ps(scale);
+    __m256 voffset = _mm256_set1_ps(offset);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m256 a = _mm256_loadu_ps(in + i);
+        __m256 b = _mm256_loadu_ps(in + i + 8);
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_mul_ps(a, vscale), voffset));
+        _mm256_storeu_ps(out + i + 8, _mm256_add_ps(_mm256_mul_ps(b, vscale), voffset));
+    }
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 a = _mm256_loadu_ps(in + i);
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_mul_ps(a, vscale), voffset));
+    }
+
+    // The scalar tail is compiled without VEX encoding; running it with
+    // the upper halves of the ymm registers dirty costs far more than the
+    // few floats it handles.
+    _mm256_zeroupper();
+    ScaleOffsetFloatsScalar(in + i, out + i, count - i, scale, offset);
+}
+
+#endif
+
+// -----------------------------------------------------------------------------
+
+static ScaleOffsetFloatsFn SelectScaleOffsetFloats()
+{
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx"))
+        return ScaleOffsetFloatsAVX;
+    if (__builtin_cpu_supports("sse"))
+        return ScaleOffsetFloatsSSE;
+#endif
+    return ScaleOffsetFloatsScalar;
+}
+
+static ScaleOffsetFloat4sFn SelectScaleOffsetFloat4s()
+{
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse"))
+        return ScaleOffsetFloat4sSSE;
+#endif
+    return ScaleOffsetFloat4sScalar;
+}
+
+// Kernels are picked on first use. Job threads may race to pick them, but
+// every thread picks the same one, so the atomic only has to keep the
+// pointer itself whole.
+void ScaleOffsetFloats(const float* in, float* out, size_t count, float scale, float offset)
+{
+    static _Atomic(ScaleOffsetFloatsFn) selected = NULL;
+    ScaleOffsetFloatsFn fn = atomic_load_explicit(&selected, memory_order_relaxed);
+    if (fn == NULL)
+    {
+        fn = SelectScaleOffsetFloats();
+        atomic_store_explicit(&selected, fn, memory_order_relaxed);
+    }
+    fn(in, out, count, scale, offset);
+}
+
+void ScaleOffsetFloat4s(
+    const float* in, size_t inStride, float* out, size_t outStride,
+    size_t count, float scale, float offsetX, float offsetY)
+{
+    static _Atomic(ScaleOffsetFloat4sFn) selected = NULL;
+    ScaleOffsetFloat4sFn fn = atomic_load_explicit(&selected, memory_order_relaxed);
+    if (fn == NULL)
+    {
+        fn = SelectScaleOffsetFloat4s();
+        atomic_store_explicit(&selected, fn, memory_order_relaxed);
+    }
+    fn(in, inStride, out, outStride, count, scale, offsetX, offsetY);
+}
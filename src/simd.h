@@ -0,0 +1,16 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stddef.h>
+
+// out[i] = in[i] * scale + offset for i in [0, count). in and out may alias.
+void ScaleOffsetFloats(const float* in, float* out, size_t count, float scale, float offset);
+
+// Scales groups of four floats laid out as (x, y, x, y), such as rects,
+// offsetting x and y separately. Group i starts at in + i * inStride and
+// out + i * outStride, with strides counted in floats.
+void ScaleOffsetFloat4s(
+    const float* in, size_t inStride, float* out, size_t outStride,
+    size_t count, float scale, float offsetX, float offsetY);
+
+#endif
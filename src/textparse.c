@@ -0,0 +1,96 @@
+#include "textparse.h"
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+// -----------------------------------------------------------------------------
+
+bool EqualsTextView(TextView view, const char* str)
+{
+    size_t length = strlen(str);
+    return view.length == length && memcmp(view.data, str, length) == 0;
+}
+
+// Splits the next line off the null-terminated source, blank ones
+// included, so callers can count lines as they go.
+bool NextTextLine(const char** source, TextView* line)
+{
+    const char* p = *source;
+    if (*p == '\0')
+        return false;
+
+    const char* end = strchr(p, '\n');
+    if (end == NULL)
+        end = p + strlen(p);
+
+    *line = (TextView) { p, (size_t)(end - p) };
+    *source = *end == '\n' ? end + 1 : end;
+    return true;
+}
+
+// Splits the next whitespace separated token off line. Quotes group
+// whitespace into a token and may contain escaped quotes.
+bool NextTextToken(TextView* line, TextView* token)
+{
+    const char* p = line->data;
+    const char* end = line->data + line->length;
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        ++p;
+    if (p == end)
+        return false;
+
+    const char* start = p;
+    bool quoted = false;
+    while (p < end && (quoted || (*p != ' ' && *p != '\t' && *p != '\r')))
+    {
+        if (*p == '\\' && quoted && p + 1 < end)
+            ++p;
+        else if (*p == '"')
+            quoted = !quoted;
+        ++p;
+    }
+
+    *token = (TextView) { start, (size_t)(p - start) };
+    *line = (TextView) { p, (size_t)(end - p) };
+    return true;
+}
+
+// Splits the next comma separated item off list.
+bool NextTextListItem(TextView* list, TextView* item)
+{
+    if (list->length == 0)
+        return false;
+
+    const char* comma = memchr(list->data, ',', list->length);
+    size_t length = comma != NULL ? (size_t)(comma - list->data) : list->length;
+    *item = (TextView) { list->data, length };
+    *list = comma != NULL
+        ? (TextView) { comma + 1, list->length - length - 1 }
+        : (TextView) { list->data + length, 0 };
+    return true;
+}
+
+// Splits name=value; value is empty for a bare name.
+void SplitTextAttribute(TextView token, TextView* name, TextView* value)
+{
+    const char* equals = memchr(token.data, '=', token.length);
+    size_t length = equals != NULL ? (size_t)(equals - token.data) : token.length;
+    *name = (TextView) { token.data, length };
+    *value = equals != NULL
+        ? (TextView) { equals + 1, token.length - length - 1 }
+        : (TextView) { token.data + length, 0 };
+}
+
+// Writes "line <line>: " and the message into error, cut to fit.
+void FormatTextError(char* error, size_t errorSize, int line, const char* format, va_list args)
+{
+    if (errorSize == 0)
+        return;
+
+    int length = snprintf(error, errorSize, "line %d: ", line);
+    if (length >= 0 && (size_t)length < errorSize)
+        vsnprintf(error + length, errorSize - (size_t)length, format, args);
+}
@@ -0,0 +1,26 @@
+#ifndef TEXTPARSE_H
+#define TEXTPARSE_H
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Line and token splitting shared by the text formats the tools read,
+// such as scene sources and battle setups. Nothing is copied; views point
+// into the source, which must outlive them. Free of raylib, so headless
+// tools can use it.
+
+typedef struct TextView
+{
+    const char* data;
+    size_t length;
+} TextView;
+
+bool EqualsTextView(TextView view, const char* str);
+bool NextTextLine(const char** source, TextView* line);
+bool NextTextToken(TextView* line, TextView* token);
+bool NextTextListItem(TextView* list, TextView* item);
+void SplitTextAttribute(TextView token, TextView* name, TextView* value);
+void FormatTextError(char* error, size_t errorSize, int line, const char* format, va_list args);
+
+#endif
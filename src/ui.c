@@ -2,14 +2,62 @@
 
 #include <stdbool.h>
 #include <stddef.h>
-#include <alloca.h>
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "profile.h"
 #include "raylib.h"
+#include "simd.h"
+#include "uibackend.h"
 
-#define FONT_SIZE_SPACING_FACTOR 0.1f
+static Arena frameArena = { 0 };
+
+// -----------------------------------------------------------------------------
+
+// Transient allocations made while building and drawing one frame come
+// from frameArena and are dropped together here.
+void BeginUIFrame()
+{
+    ResetArena(&frameArena);
+}
+
+Arena* GetUIFrameArena()
+{
+    return &frameArena;
+}
+
+void FreeUIFrameArena()
+{
+    FreeArena(&frameArena);
+}
+
+// -----------------------------------------------------------------------------
+
+UIStringView MakeUIStringView(const char* str)
+{
+    return (UIStringView) { str, strlen(str) };
+}
+
+// Splits off the next line of rest without touching the string. Empty
+// lines are skipped, so "a\n\nb" yields the same two lines strtok did.
+bool NextUILine(UIStringView* rest, UIStringView* line)
+{
+    while (rest->length > 0 && rest->data[0] == '\n')
+    {
+        ++rest->data;
+        --rest->length;
+    }
+    if (rest->length == 0)
+        return false;
+
+    const char* end = (const char*)memchr(rest->data, '\n', rest->length);
+    line->data = rest->data;
+    line->length = end != NULL ? (size_t)(end - rest->data) : rest->length;
+    rest->data += line->length;
+    rest->length -= line->length;
+    return true;
+}
 
 // -----------------------------------------------------------------------------
 
@@ -36,24 +84,23 @@ UISize GetUIRectSize(UIRect rect)
     return (UISize) { rect.right - rect.left, rect.bottom - rect.top };
 }
 
-UISize GetUITextSize(UIText text)
+static UISize GetUITextLinesSize(const UITextLine* lines, size_t count, float spacing)
 {
-    float spacing = text.fontSize * FONT_SIZE_SPACING_FACTOR;
-    UISize totalSize = { 0, 0 };
-    size_t strSize = strlen(text.str) + 1;
-    char* str = alloca(strSize);
-    strncpy(str, text.str, strSize);
-
-    char* token = NULL;
-    for (token = strtok(str, "\n"); token != NULL; token = strtok(NULL, "\n"))
+    UISize size = { 0, 0 };
+    for (size_t i = 0; i < count; ++i)
     {
-        Vector2 lineSize = MeasureTextEx(GetFontDefault(), token, text.fontSize, spacing);
-        totalSize.w = max(totalSize.w, lineSize.x);
-        totalSize.h += lineSize.y + spacing;
+        size.w = max(size.w, lines[i].size.w);
+        size.h += lines[i].size.h + spacing;
     }
-    totalSize.h -= spacing;
+    size.h -= spacing;
+    return size;
+}
 
-    return totalSize;
+UISize GetUITextSize(UIText text)
+{
+    size_t count = 0;
+    const UITextLine* lines = GetUITextLines(text, 0, (UISize) { 0, 0 }, &count);
+    return GetUITextLinesSize(lines, count, text.fontSize * FONT_SIZE_SPACING_FACTOR);
 }
 
 bool CollidesUIRectUIPoint(UIRect rect, UIPoint point)
@@ -63,6 +110,40 @@ bool CollidesUIRectUIPoint(UIRect rect, UIPoint point)
         && point.x < rect.right && point.y < rect.bottom;
 }
 
+bool OverlapsUIRect(UIRect a, UIRect b)
+{
+    return
+           a.left < b.right  && b.left < a.right
+        && a.top  < b.bottom && b.top  < a.bottom;
+}
+
+UIRect UnionUIRect(UIRect a, UIRect b)
+{
+    return (UIRect)
+    {
+        min(a.left, b.left),
+        min(a.top, b.top),
+        max(a.right, b.right),
+        max(a.bottom, b.bottom)
+    };
+}
+
+UIRect IntersectUIRect(UIRect a, UIRect b)
+{
+    return (UIRect)
+    {
+        max(a.left, b.left),
+        max(a.top, b.top),
+        min(a.right, b.right),
+        min(a.bottom, b.bottom)
+    };
+}
+
+bool IsUIRectEmpty(UIRect rect)
+{
+    return rect.right <= rect.left || rect.bottom <= rect.top;
+}
+
 UIPoint GetCenterUIRect(UIRect rect)
 {
     return (UIPoint)
@@ -101,6 +182,13 @@ ScreenTransform GetScreenTransform(int w, int h, int ow, int oh)
     return (ScreenTransform) { xstart, ystart, scale };
 }
 
+// Scales like GetScreenTransform but without letterboxing, for UIs laid
+// out to fill the whole w x h window.
+ScreenTransform GetScreenScaleTransform(int w, int h, int ow, int oh)
+{
+    return (ScreenTransform) { 0, 0, min((float)w / ow, (float)h / oh) };
+}
+
 UIPoint ScreenTransformUIPoint(UIPoint point, ScreenTransform t)
 {
     return (UIPoint)
@@ -114,13 +202,35 @@ UIRect ScreenTransformUIRect(UIRect rect, ScreenTransform t)
 {
     return (UIRect)
     {
-        t.xstart + rect.left,
-        t.ystart + rect.top,
+        t.xstart + rect.left * t.scale,
+        t.ystart + rect.top * t.scale,
         t.xstart + rect.right * t.scale,
         t.ystart + rect.bottom * t.scale
     };
 }
 
+UIPoint InverseScreenTransformUIPoint(UIPoint point, ScreenTransform t)
+{
+    float inv = 1.0f / t.scale;
+    return (UIPoint)
+    {
+        (point.x - t.xstart) * inv,
+        (point.y - t.ystart) * inv
+    };
+}
+
+UIRect InverseScreenTransformUIRect(UIRect rect, ScreenTransform t)
+{
+    float inv = 1.0f / t.scale;
+    return (UIRect)
+    {
+        (rect.left - t.xstart) * inv,
+        (rect.top - t.ystart) * inv,
+        (rect.right - t.xstart) * inv,
+        (rect.bottom - t.ystart) * inv
+    };
+}
+
 UIText ScreenTransformUIText(UIText text, ScreenTransform t)
 {
     text.fontSize *= t.scale;
@@ -129,20 +239,27 @@ UIText ScreenTransformUIText(UIText text, ScreenTransform t)
 
 // -----------------------------------------------------------------------------
 
+UITextureRegion GetUITextureRegion(Texture2D texture)
+{
+    return (UITextureRegion)
+    {
+        texture,
+        (UIRect) { 0, 0, (float)texture.width, (float)texture.height }
+    };
+}
+
 void DrawUIRect(UIRect rect, Color color)
 {
-    DrawRectangleRec(UIRectToRectangle(rect), color);
+    DrawUIBackendRect(rect, color);
 }
 
 void DrawUIBorder(UIRect rect, float width, Color color)
 {
-    DrawRectangleLinesEx(UIRectToRectangle(rect), width, color);
+    DrawUIBackendBorder(rect, width, color);
 }
 
-void DrawUIText(UIRect rect, UIText text, UIAlign align)
+static UIPoint GetUITextOrigin(UIRect rect, UISize textSize, UIAlign align)
 {
-    float spacing = text.fontSize * FONT_SIZE_SPACING_FACTOR;
-    UISize textSize = GetUITextSize(text);
     UIPoint loc = { 0, 0 };
     UIPoint center = GetCenterUIRect(rect);
 
@@ -160,140 +277,1138 @@ void DrawUIText(UIRect rect, UIText text, UIAlign align)
     else if (align.valign == V_BOTTOM)
         loc.y = rect.bottom - textSize.h - align.bottomMargin;
 
-    size_t strSize = strlen(text.str) + 1;
-    char* str = alloca(strSize);
-    strncpy(str, text.str, strSize);
+    return loc;
+}
+
+// The room text has inside the margins, which wrapping and ellipses fit
+// it to.
+static UISize GetUITextContentSize(UIRect rect, UIAlign align)
+{
+    UISize size = GetUIRectSize(rect);
+    return (UISize)
+    {
+        size.w - align.leftMargin - align.rightMargin,
+        size.h - align.topMargin - align.bottomMargin
+    };
+}
+
+// Lines are aligned within the block of text as the block is in the rect.
+static float GetUITextLineX(UIPoint origin, UISize textSize, const UITextLine* line, HAlign halign)
+{
+    if (halign == H_CENTER)
+        return origin.x + (textSize.w - line->size.w) * 0.5f;
+    if (halign == H_RIGHT)
+        return origin.x + textSize.w - line->size.w;
+    return origin.x;
+}
+
+static void DrawUITextLine(const char* str, const UITextLine* line, UIPoint pos, float fontSize, Color color)
+{
+    float spacing = fontSize * FONT_SIZE_SPACING_FACTOR;
+    DrawUIBackendText(str + line->start, line->length, pos, fontSize, spacing, color);
+    if (line->ellipsis)
+    {
+        size_t length = strlen(UI_ELLIPSIS);
+        pos.x += line->size.w - MeasureUIBackendText(UI_ELLIPSIS, length, fontSize, spacing).w;
+        DrawUIBackendText(UI_ELLIPSIS, length, pos, fontSize, spacing, color);
+    }
+}
+
+void DrawUIText(UIRect rect, UIText text, UIAlign align, Color color)
+{
+    PROFILE_ZONE("DrawUIText");
+    float spacing = text.fontSize * FONT_SIZE_SPACING_FACTOR;
+    size_t lineCount = 0;
+    const UITextLine* lines = GetUITextLines(text, align.flow, GetUITextContentSize(rect, align), &lineCount);
+    UISize textSize = GetUITextLinesSize(lines, lineCount, spacing);
 
-    char* token = NULL;
-    for (token = strtok(str, "\n"); token != NULL; token = strtok(NULL, "\n"))
+    UIPoint origin = GetUITextOrigin(rect, textSize, align);
+    UIPoint loc = origin;
+    for (size_t i = 0; i < lineCount; ++i)
     {
-        DrawTextEx(
-            GetFontDefault(),
-            token,
-            UIPointToVector2(loc),
-            text.fontSize,
-            spacing,
-            text.fontColor);
+        loc.x = GetUITextLineX(origin, textSize, &lines[i], align.halign);
+        DrawUITextLine(text.str, &lines[i], loc, text.fontSize, color);
         loc.y += text.fontSize + spacing;
     }
 }
 
 // -----------------------------------------------------------------------------
 
+static bool EqualsUIRect(UIRect a, UIRect b)
+{
+    return
+           a.left  == b.left  && a.top    == b.top
+        && a.right == b.right && a.bottom == b.bottom;
+}
+
+static bool EqualsUIAlign(UIAlign a, UIAlign b)
+{
+    return
+           a.halign      == b.halign      && a.valign       == b.valign
+        && a.leftMargin  == b.leftMargin  && a.topMargin    == b.topMargin
+        && a.rightMargin == b.rightMargin && a.bottomMargin == b.bottomMargin
+        && a.flow        == b.flow;
+}
+
+// Takes the lines from the line cache and resolves their final positions
+// once; the result is reused until one of the inputs changes.
+static void BuildUITextLayout(UITextLayout* layout, UIRect rect, UIText text, UIAlign align)
+{
+    PROFILE_ZONE("TextLayout");
+    float spacing = text.fontSize * FONT_SIZE_SPACING_FACTOR;
+    size_t lineCount = 0;
+    const UITextLine* lines = GetUITextLines(text, align.flow, GetUITextContentSize(rect, align), &lineCount);
+    if (lineCount > layout->lineCap)
+    {
+        layout->lineCap = max(lineCount, layout->lineCap * 2);
+        layout->lines = (UITextLine*)realloc(layout->lines, layout->lineCap * sizeof(UITextLine));
+    }
+
+    layout->lineCount = lineCount;
+    layout->size = GetUITextLinesSize(lines, lineCount, spacing);
+    layout->origin = GetUITextOrigin(rect, layout->size, align);
+    float y = layout->origin.y;
+    for (size_t i = 0; i < lineCount; ++i)
+    {
+        layout->lines[i] = lines[i];
+        layout->lines[i].pos = (UIPoint) { GetUITextLineX(layout->origin, layout->size, &lines[i], align.halign), y };
+        y += text.fontSize + spacing;
+    }
+
+    layout->valid = true;
+    layout->str = text.str;
+    layout->fontSize = text.fontSize;
+    layout->rect = rect;
+    layout->align = align;
+}
+
+void UpdateUITextLayout(UITextLayout* layout, UIRect rect, UIText text, UIAlign align)
+{
+    if (layout->valid
+        && layout->str == text.str
+        && layout->fontSize == text.fontSize
+        && EqualsUIRect(layout->rect, rect)
+        && EqualsUIAlign(layout->align, align))
+    {
+        return;
+    }
+
+    BuildUITextLayout(layout, rect, text, align);
+}
+
+void InvalidateUITextLayout(UITextLayout* layout)
+{
+    layout->valid = false;
+}
+
+void DrawUITextLayout(const UITextLayout* layout, UIText text, Color color)
+{
+    for (size_t i = 0; i < layout->lineCount; ++i)
+        DrawUITextLine(layout->str, &layout->lines[i], layout->lines[i].pos, text.fontSize, color);
+}
+
+UIRect GetUITextLayoutBounds(const UITextLayout* layout)
+{
+    if (!layout->valid || layout->lineCount == 0)
+        return UIRECT_ZERO;
+
+    return (UIRect)
+    {
+        layout->origin.x,
+        layout->origin.y,
+        layout->origin.x + layout->size.w,
+        layout->origin.y + layout->size.h
+    };
+}
+
+void FreeUITextLayout(UITextLayout* layout)
+{
+    free(layout->lines);
+    memset(layout, 0, sizeof(UITextLayout));
+}
+
+// -----------------------------------------------------------------------------
+
 /*
 typedef struct UIElement
 {
     UIRect rect;
-    Color bgColor;
-    float borderWidth;
-    Color borderColor;
+    UIStyleId style;
+    float scale;
+    UIKind kind;
     bool hasTexture;
     UIRect textureRect;
-    Texture2D texture;
+    UITextureRegion texture;
     bool hasText;
     UIText text;
     UIAlign textAlign;
+    UITextLayout textLayout;
     uint32_t optState;
 } UIElement;
 */
 
-UIElement* CreateEmptyUIElement()
+UIHandle CreateSolidRect(UIRect rect, UIStyleId style)
 {
-    UIElement* ret = (UIElement*)malloc(sizeof(UIElement));
-    memset(ret, 0, sizeof(UIElement));
+    UIHandle ret = CreateEmptyUIElement();
+    UIElement* elem = GetUIElement(ret);
+    elem->rect = rect;
+    elem->style = style;
+    elem->hasTexture = false;
+    elem->hasText = false;
     return ret;
 }
 
-UIElement* CreateSolidRect(UIRect rect, UIStyle style)
+UIHandle CreateLabel(UIRect rect, char* text, float fontSize, UIAlign textAlign, UIStyleId style)
 {
-    UIElement* ret = CreateEmptyUIElement();
-    ret->rect = rect;
-    ret->bgColor = style.bgColor;
-    ret->borderWidth = style.borderWidth;
-    ret->borderColor = style.borderColor;
-    ret->hasTexture = false;
-    ret->hasText = false;
+    UIHandle ret = CreateEmptyUIElement();
+    UIElement* elem = GetUIElement(ret);
+    elem->rect = rect;
+    elem->style = style;
+    elem->hasTexture = false;
+    elem->hasText = true;
+    elem->text = (UIText) { text, fontSize };
+    elem->textAlign = textAlign;
+    elem->optState = 0;
     return ret;
 }
 
-UIElement* CreateLabel(UIRect rect, char* text, float fontSize, UIAlign textAlign, UIStyle style)
+UIHandle CreateButton(UIRect rect, char* text, float fontSize, UIAlign textAlign, UIStyleId style)
 {
-    UIElement* ret = CreateEmptyUIElement();
-    ret->rect = rect;
-    ret->bgColor = style.bgColor;
-    ret->borderWidth = style.borderWidth;
-    ret->borderColor = style.borderColor;
-    ret->hasTexture = false;
-    ret->hasText = true;
-    ret->text = (UIText) { text, fontSize, style.fontColor };
-    ret->textAlign = textAlign;
-    ret->optState = 0;
+    UIHandle ret = CreateLabel(rect, text, fontSize, textAlign, style);
+    UIElement* elem = GetUIElement(ret);
+    elem->kind = UI_BUTTON;
     return ret;
 }
 
-UIElement* CreateTextureElement(UIRect rect, UIRect textureRect, Texture2D texture, UIStyle style);
-UIElement* CreateButton(UIRect rect, char* text, float fontSize, UIAlign textAlign, UIStyle style);
-UIElement* CreateButtonWithTexture(UIRect rect, UIRect textureRect, Texture2D texture, UIStyle style);
-UIElement* CreateButtonWithTextureAndText(
-    UIRect rect, char* text, float fontSize, UIAlign textAlign,
-    UIRect textureRect, Texture2D texture, UIStyle style);
-UIElement* CreateToggleButton(UIRect rect, char* text, float fontSize, UIAlign textAlign, bool isToggled, UIStyle style);
-UIElement* CreateToggleButtonWithTexture(UIRect rect, UIRect textureRect, Texture2D texture, bool isToggled, UIStyle style);
-UIElement* CreateToggleButtonWithTextureAndText(
+UIHandle CreateButtonWithTextureAndText(
     UIRect rect, char* text, float fontSize, UIAlign textAlign,
-    UIRect textureRect, Texture2D texture, bool isToggled, UIStyle style);
+    UIRect textureRect, UITextureRegion texture, UIStyleId style)
+{
+    UIHandle ret = CreateButton(rect, text, fontSize, textAlign, style);
+    UIElement* elem = GetUIElement(ret);
+    elem->hasTexture = true;
+    elem->textureRect = textureRect;
+    elem->texture = texture;
+    return ret;
+}
 
 // -----------------------------------------------------------------------------
 
+void SetUIElementText(UIElement* elem, char* text)
+{
+    elem->text.str = text;
+    elem->hasText = text != NULL;
+    InvalidateUITextLayout(&elem->textLayout);
+}
+
 void ScreenTransformUIElement(const UIElement* elem, ScreenTransform t, UIElement* res)
 {
+    // res keeps its own layout cache; it is rebuilt on the next draw if the
+    // transformed rect or font size differ from what it was built with.
+    UITextLayout layout = res->textLayout;
     *res = *elem;
+    res->textLayout = layout;
     res->rect = ScreenTransformUIRect(elem->rect, t);
-    res->borderWidth *= t.scale;
-    res->textureRect = ScreenTransformUIRect(elem->rect, t);
+    res->scale *= t.scale;
+    res->textureRect = ScreenTransformUIRect(elem->textureRect, t);
     res->text = ScreenTransformUIText(elem->text, t);
 }
 
-void DrawUIElement(const UIElement* elem)
+static Color BrightenColor(Color color, float factor)
+{
+    return (Color)
+    {
+        (unsigned char)(color.r + (255 - color.r) * factor),
+        (unsigned char)(color.g + (255 - color.g) * factor),
+        (unsigned char)(color.b + (255 - color.b) * factor),
+        color.a
+    };
+}
+
+static Color GetStateBgColor(Color bgColor, UIKind kind, uint32_t state)
+{
+    if (kind == UI_STATIC)
+        return bgColor;
+    if (state & UI_STATE_PRESSED)
+        return BrightenColor(bgColor, 0.3f);
+    if (state & (UI_STATE_HOVERED | UI_STATE_TOGGLED))
+        return BrightenColor(bgColor, 0.15f);
+    return bgColor;
+}
+
+Color GetUIElementBgColor(const UIElement* elem)
+{
+    return GetStateBgColor(GetUIStyle(elem->style)->bgColor, elem->kind, elem->optState);
+}
+
+bool HasUIElementOverlay(const UIElement* elem)
 {
+    return elem->hasTexture || elem->text.str != NULL;
+}
+
+void DrawUIElement(UIElement* elem)
+{
+    PROFILE_ZONE("DrawUIElement");
+    const UIStyle* style = GetUIStyle(elem->style);
     UISize rectSize = GetUIRectSize(elem->rect);
     if (rectSize.w > 0 && rectSize.h > 0)
     {
-        DrawUIRect(elem->rect, elem->bgColor);
+        DrawUIRect(elem->rect, GetUIElementBgColor(elem));
     }
 
     if (elem->hasTexture)
     {
-        DrawTexturePro(
-            elem->texture,
-            (Rectangle) { 0, 0, elem->texture.width, elem->texture.height },
-            UIRectToRectangle(elem->textureRect),
-            (Vector2) { 0, 0 },
-            0.0f,
-            WHITE);
+        DrawUIBackendTexture(elem->texture.texture, elem->texture.source, elem->textureRect);
     }
 
     if (elem->text.str != NULL)
     {
-        DrawUIText(elem->rect, elem->text, elem->textAlign);
+        UpdateUITextLayout(&elem->textLayout, elem->rect, elem->text, elem->textAlign);
+        DrawUITextLayout(&elem->textLayout, elem->text, style->fontColor);
     }
 
-    if (elem->borderWidth > 0)
+    float borderWidth = style->borderWidth * elem->scale;
+    if (borderWidth > 0)
     {
-        DrawUIBorder(elem->rect, elem->borderWidth, elem->borderColor);
+        DrawUIBorder(elem->rect, borderWidth, style->borderColor);
     }
 }
 
-void DeleteUIElement(UIElement* elem)
+// -----------------------------------------------------------------------------
+
+#define UISCENE_INITIAL_CAPACITY 64
+
+UIScene* CreateUIScene()
 {
-    free(elem);
-    elem = NULL;
+    UIScene* ret = (UIScene*)malloc(sizeof(UIScene));
+    memset(ret, 0, sizeof(UIScene));
+    ret->transform = SCREEN_TRANSFORM_NONE;
+    ret->hovered = UISCENE_INVALID_ID;
+    ret->fullDamage = true;
+    ret->styleGeneration = GetUIStyleGeneration();
+    return ret;
+}
+
+// The per-slot arrays of a loaded scene start out in its file mappings,
+// which must not be passed to realloc or free.
+static bool IsInUISceneMapping(const UIScene* scene, const void* array)
+{
+    for (size_t i = 0; i < scene->file.mappingCount; ++i)
+    {
+        const char* data = (const char*)scene->file.mappings[i].data;
+        if ((const char*)array >= data && (const char*)array < data + scene->file.mappings[i].size)
+            return true;
+    }
+    return false;
+}
+
+static void* GrowUISceneArray(const UIScene* scene, void* array, size_t size, size_t newSize)
+{
+    if (!IsInUISceneMapping(scene, array))
+        return realloc(array, newSize);
+
+    void* ret = malloc(newSize);
+    memcpy(ret, array, size);
+    return ret;
+}
+
+static void FreeUISceneArray(const UIScene* scene, void* array)
+{
+    if (!IsInUISceneMapping(scene, array))
+        free(array);
+}
+
+static void ReserveUIScene(UIScene* scene, size_t capacity)
+{
+    if (capacity <= scene->capacity)
+        return;
+
+    size_t oldCapacity = scene->capacity;
+    size_t newCapacity = max(oldCapacity * 2, (size_t)UISCENE_INITIAL_CAPACITY);
+    newCapacity = max(newCapacity, capacity);
+    scene->nodes = (UISceneNode*)GrowUISceneArray(
+        scene, scene->nodes, oldCapacity * sizeof(UISceneNode), newCapacity * sizeof(UISceneNode));
+    scene->designRects = (UIRect*)GrowUISceneArray(
+        scene, scene->designRects, oldCapacity * sizeof(UIRect), newCapacity * sizeof(UIRect));
+    scene->textures = (UITextureRegion*)realloc(
+        scene->textures, newCapacity * sizeof(UITextureRegion));
+    scene->texts = (UISceneText*)realloc(
+        scene->texts, newCapacity * sizeof(UISceneText));
+    scene->layouts = (UITextLayout*)realloc(
+        scene->layouts, newCapacity * sizeof(UITextLayout));
+    scene->clipIds = (uint32_t*)GrowUISceneArray(
+        scene, scene->clipIds, oldCapacity * sizeof(uint32_t), newCapacity * sizeof(uint32_t));
+    for (int f = 0; f < UI_GEOM_FIELD_COUNT; ++f)
+    {
+        scene->design[f] = (float*)GrowUISceneArray(
+            scene, scene->design[f], oldCapacity * sizeof(float), newCapacity * sizeof(float));
+        scene->screen[f] = (float*)GrowUISceneArray(
+            scene, scene->screen[f], oldCapacity * sizeof(float), newCapacity * sizeof(float));
+    }
+    scene->capacity = newCapacity;
+}
+
+static UISceneId AllocUISceneId(UIScene* scene)
+{
+    if (scene->freeIdCount > 0)
+        return scene->freeIds[--scene->freeIdCount];
+
+    if (scene->idCapacity == UINT32_MAX)
+        return UISCENE_INVALID_ID;
+
+    UISceneId id = (UISceneId)scene->idCapacity++;
+    scene->idSlots = (uint32_t*)realloc(
+        scene->idSlots, scene->idCapacity * sizeof(uint32_t));
+    scene->freeIds = (UISceneId*)realloc(
+        scene->freeIds, scene->idCapacity * sizeof(UISceneId));
+    return id;
+}
+
+static void SetUIGeometryTextureRect(float** g, size_t slot, UIRect rect)
+{
+    g[UI_GEOM_TEX_LEFT][slot] = rect.left;
+    g[UI_GEOM_TEX_TOP][slot] = rect.top;
+    g[UI_GEOM_TEX_RIGHT][slot] = rect.right;
+    g[UI_GEOM_TEX_BOTTOM][slot] = rect.bottom;
+}
+
+static UIRect GetUIGeometryTextureRect(float* const* g, size_t slot)
+{
+    return (UIRect)
+    {
+        g[UI_GEOM_TEX_LEFT][slot],
+        g[UI_GEOM_TEX_TOP][slot],
+        g[UI_GEOM_TEX_RIGHT][slot],
+        g[UI_GEOM_TEX_BOTTOM][slot]
+    };
+}
+
+// Transforms count slots starting at first from design to screen space.
+static void TransformUISceneGeometry(UIScene* scene, size_t first, size_t count)
+{
+    if (count == 0)
+        return;
+
+    ScreenTransform t = scene->transform;
+    ScaleOffsetFloat4s(
+        &scene->designRects[first].left, sizeof(UIRect) / sizeof(float),
+        &scene->nodes[first].rect.left, sizeof(UISceneNode) / sizeof(float),
+        count, t.scale, t.xstart, t.ystart);
+
+    for (int f = 0; f < UI_GEOM_FIELD_COUNT; ++f)
+    {
+        float offset = 0.0f;
+        if (f < UI_GEOM_Y_FIRST)
+            offset = t.xstart;
+        else if (f < UI_GEOM_SCALE_FIRST)
+            offset = t.ystart;
+
+        ScaleOffsetFloats(
+            scene->design[f] + first, scene->screen[f] + first, count, t.scale, offset);
+    }
+}
+
+static UIKind GetUISceneNodeKind(const UISceneNode* node)
+{
+    return (UIKind)(node->flags >> UI_NODE_KIND_SHIFT);
+}
+
+static Color GetUISceneNodeBgColor(const UISceneNode* node)
+{
+    return GetStateBgColor(
+        GetUIStyle(node->style)->bgColor,
+        GetUISceneNodeKind(node),
+        node->flags & UI_STATE_MASK);
+}
+
+static uint32_t GetUISceneSlotClip(const UIScene* scene, size_t slot)
+{
+    if (scene->nodes[slot].flags & UI_NODE_CLIPPED)
+        return scene->clipIds[slot];
+    return UISCENE_NO_CLIP;
+}
+
+// Brings the text layout of slot up to date with its design rect, so its
+// bounds are current. Scene text is laid out in design space and scaled
+// as it is drawn, so where its lines break does not change with the
+// transform.
+static void UpdateUISceneSlotLayout(UIScene* scene, size_t slot)
+{
+    if (!(scene->nodes[slot].flags & UI_NODE_TEXT))
+        return;
+
+    UIText designText = scene->texts[slot].text;
+    designText.fontSize = scene->design[UI_GEOM_FONT_SIZE][slot];
+    UpdateUITextLayout(&scene->layouts[slot], scene->designRects[slot], designText, scene->texts[slot].align);
+}
+
+// Screen-space area an element may touch: its rect plus any text that
+// overflows it, as of the last time its layout was built, cut down to
+// its clip. May be empty.
+static UIRect GetUISceneSlotBounds(const UIScene* scene, size_t slot)
+{
+    UIRect bounds = scene->nodes[slot].rect;
+    if (scene->nodes[slot].flags & UI_NODE_TEXT)
+    {
+        const UITextLayout* layout = &scene->layouts[slot];
+        if (layout->valid && layout->lineCount > 0)
+            bounds = UnionUIRect(bounds, ScreenTransformUIRect(GetUITextLayoutBounds(layout), scene->transform));
+    }
+
+    uint32_t clip = GetUISceneSlotClip(scene, slot);
+    if (clip != UISCENE_NO_CLIP)
+        bounds = IntersectUIRect(bounds, scene->screenClips[clip]);
+    return bounds;
+}
+
+void AddUISceneDamage(UIScene* scene, UIRect rect)
+{
+    if (scene->fullDamage || IsUIRectEmpty(rect))
+        return;
+
+    for (size_t i = 0; i < scene->damageCount; ++i)
+    {
+        if (OverlapsUIRect(scene->damage[i], rect))
+        {
+            scene->damage[i] = UnionUIRect(scene->damage[i], rect);
+            return;
+        }
+    }
+
+    // Past a handful of regions, one scissor pass over their union is
+    // cheaper than redrawing overlapping elements once per region.
+    if (scene->damageCount == UISCENE_MAX_DAMAGE)
+    {
+        for (size_t i = 1; i < scene->damageCount; ++i)
+            scene->damage[0] = UnionUIRect(scene->damage[0], scene->damage[i]);
+        scene->damage[0] = UnionUIRect(scene->damage[0], rect);
+        scene->damageCount = 1;
+        return;
+    }
+
+    scene->damage[scene->damageCount++] = rect;
+}
+
+// The element's layout is built first, so the damage covers text that
+// overflows it even if it has not been drawn yet.
+void MarkUISceneElementDirty(UIScene* scene, UISceneId id)
+{
+    if (id >= scene->idCapacity || scene->idSlots[id] == UISCENE_INVALID_ID)
+        return;
+
+    UpdateUISceneSlotLayout(scene, scene->idSlots[id]);
+    AddUISceneDamage(scene, GetUISceneSlotBounds(scene, scene->idSlots[id]));
+}
+
+bool HasUISceneDamage(const UIScene* scene)
+{
+    return scene->fullDamage || scene->damageCount > 0;
+}
+
+void ClearUISceneDamage(UIScene* scene)
+{
+    scene->fullDamage = false;
+    scene->damageCount = 0;
+}
+
+// Records the part of slot drawn by shader, in design space and cut down
+// to its clip. Parts that cannot show are dropped.
+static void PushUISceneDrawItem(
+    UIScene* scene, size_t slot, UIDrawShader shader, uint32_t texture, UIRect bounds)
+{
+    uint32_t slotClip = GetUISceneSlotClip(scene, slot);
+    if (slotClip != UISCENE_NO_CLIP)
+        bounds = IntersectUIRect(bounds, scene->clips[slotClip]);
+    if (IsUIRectEmpty(bounds))
+        return;
+
+    PushUIDrawItem(&scene->drawList, (uint32_t)slot, shader, texture, slotClip, bounds);
+}
+
+// Splits slot into its rect, texture and text, whose layout is brought up
+// to date first.
+static void PushUISceneSlotDrawItems(UIScene* scene, size_t slot)
+{
+    UpdateUISceneSlotLayout(scene, slot);
+    const UISceneNode* node = &scene->nodes[slot];
+    PushUISceneDrawItem(scene, slot, UI_DRAW_SHADER_RECT, 0, scene->designRects[slot]);
+
+    if (node->flags & UI_NODE_TEXTURE)
+    {
+        PushUISceneDrawItem(
+            scene, slot, UI_DRAW_SHADER_TEXTURE, scene->textures[slot].texture.id,
+            GetUIGeometryTextureRect(scene->design, slot));
+    }
+
+    if (node->flags & UI_NODE_TEXT)
+    {
+        const UITextLayout* layout = &scene->layouts[slot];
+        if (layout->lineCount > 0)
+        {
+            PushUISceneDrawItem(scene, slot, UI_DRAW_SHADER_TEXT, 0, GetUITextLayoutBounds(layout));
+        }
+    }
+}
+
+static void BuildUISceneDrawList(UIScene* scene)
+{
+    ResetUIDrawList(&scene->drawList);
+    for (size_t i = 0; i < scene->size; ++i)
+        PushUISceneSlotDrawItems(scene, i);
+    SortUIDrawList(&scene->drawList, scene->size);
+}
+
+// Brings the items of one slot up to date in a sorted draw list. One that
+// is not sorted is left for the next draw to build whole.
+static void UpdateUISceneDrawSlot(UIScene* scene, size_t slot)
+{
+    if (!scene->drawList.valid)
+        return;
+
+    size_t sorted = scene->drawList.count;
+    PushUISceneSlotDrawItems(scene, slot);
+    ReplaceUIDrawSlot(&scene->drawList, (uint32_t)slot, sorted);
+}
+
+// Splits elem into the hot node and the side tables of slot. The node's
+// id and draw key are left alone.
+static void StoreUISceneElement(UIScene* scene, size_t slot, const UIElement* elem)
+{
+    UISceneNode* node = &scene->nodes[slot];
+    node->flags =
+          (node->flags & UI_NODE_CLIPPED)
+        | (elem->optState & UI_STATE_MASK)
+        | ((uint32_t)elem->kind << UI_NODE_KIND_SHIFT);
+    node->style = elem->style;
+
+    if (elem->hasTexture)
+    {
+        node->flags |= UI_NODE_TEXTURE;
+        scene->textures[slot] = elem->texture;
+    }
+    if (elem->text.str != NULL)
+    {
+        node->flags |= UI_NODE_TEXT;
+        scene->texts[slot] = (UISceneText) { elem->text, elem->textAlign };
+    }
+    InvalidateUITextLayout(&scene->layouts[slot]);
+
+    scene->designRects[slot] = elem->rect;
+    SetUIGeometryTextureRect(scene->design, slot, elem->textureRect);
+    scene->design[UI_GEOM_FONT_SIZE][slot] = elem->text.fontSize;
+    TransformUISceneGeometry(scene, slot, 1);
+}
+
+UISceneId InsertIntoUIScene(UIScene* scene, const UIElement* elem)
+{
+    UISceneId id = AllocUISceneId(scene);
+    if (id == UISCENE_INVALID_ID)
+        return id;
+
+    ReserveUIScene(scene, scene->size + 1);
+    size_t slot = scene->size++;
+
+    // The scene owns the layout caches of its slots, so they must not
+    // alias the buffers of the element passed in.
+    memset(&scene->layouts[slot], 0, sizeof(UITextLayout));
+    scene->nodes[slot].flags = 0;
+    StoreUISceneElement(scene, slot, elem);
+    scene->nodes[slot].id = id;
+    scene->nodes[slot].drawKey = scene->nextDrawKey++;
+
+    scene->idSlots[id] = (uint32_t)slot;
+    UpdateUIGridElement(scene, id);
+    MarkUISceneElementDirty(scene, id);
+    UpdateUISceneDrawSlot(scene, slot);
+    return id;
+}
+
+void DeleteFromUIScene(UIScene* scene, UISceneId id)
+{
+    if (id >= scene->idCapacity || scene->idSlots[id] == UISCENE_INVALID_ID)
+        return;
+
+    MarkUISceneElementDirty(scene, id);
+    RemoveFromUIGrid(scene, id);
+    UnlinkUISceneFileElement(&scene->file, id);
+    size_t slot = scene->idSlots[id];
+    FreeUITextLayout(&scene->layouts[slot]);
+
+    // Shift the tail down rather than swapping so draw order is preserved.
+    size_t tail = scene->size - slot - 1;
+    memmove(&scene->nodes[slot], &scene->nodes[slot + 1], tail * sizeof(UISceneNode));
+    memmove(&scene->designRects[slot], &scene->designRects[slot + 1], tail * sizeof(UIRect));
+    memmove(&scene->textures[slot], &scene->textures[slot + 1], tail * sizeof(UITextureRegion));
+    memmove(&scene->texts[slot], &scene->texts[slot + 1], tail * sizeof(UISceneText));
+    memmove(&scene->layouts[slot], &scene->layouts[slot + 1], tail * sizeof(UITextLayout));
+    memmove(&scene->clipIds[slot], &scene->clipIds[slot + 1], tail * sizeof(uint32_t));
+    for (int f = 0; f < UI_GEOM_FIELD_COUNT; ++f)
+    {
+        memmove(&scene->design[f][slot], &scene->design[f][slot + 1], tail * sizeof(float));
+        memmove(&scene->screen[f][slot], &scene->screen[f][slot + 1], tail * sizeof(float));
+    }
+    scene->size--;
+
+    for (size_t i = slot; i < scene->size; ++i)
+        scene->idSlots[scene->nodes[i].id] = (uint32_t)i;
+
+    scene->idSlots[id] = UISCENE_INVALID_ID;
+    scene->freeIds[scene->freeIdCount++] = id;
+    if (scene->hovered == id)
+        scene->hovered = UISCENE_INVALID_ID;
+    RemoveUIDrawSlot(&scene->drawList, (uint32_t)slot);
+}
+
+// Reassembles the design-space element stored under id. The copy has no
+// layout cache of its own.
+bool GetUISceneElement(const UIScene* scene, UISceneId id, UIElement* out)
+{
+    if (id >= scene->idCapacity || scene->idSlots[id] == UISCENE_INVALID_ID)
+        return false;
+
+    size_t slot = scene->idSlots[id];
+    const UISceneNode* node = &scene->nodes[slot];
+    memset(out, 0, sizeof(UIElement));
+    out->rect = scene->designRects[slot];
+    out->style = node->style;
+    out->scale = 1.0f;
+    out->kind = GetUISceneNodeKind(node);
+    out->optState = node->flags & UI_STATE_MASK;
+    out->textureRect = GetUIGeometryTextureRect(scene->design, slot);
+    out->text.fontSize = scene->design[UI_GEOM_FONT_SIZE][slot];
+
+    if (node->flags & UI_NODE_TEXTURE)
+    {
+        out->hasTexture = true;
+        out->texture = scene->textures[slot];
+    }
+    if (node->flags & UI_NODE_TEXT)
+    {
+        out->hasText = true;
+        out->text = scene->texts[slot].text;
+        out->textAlign = scene->texts[slot].align;
+    }
+    return true;
+}
+
+void SetUISceneElement(UIScene* scene, UISceneId id, const UIElement* elem)
+{
+    if (id >= scene->idCapacity || scene->idSlots[id] == UISCENE_INVALID_ID)
+        return;
+
+    MarkUISceneElementDirty(scene, id);
+    StoreUISceneElement(scene, scene->idSlots[id], elem);
+    UpdateUIGridElement(scene, id);
+    MarkUISceneElementDirty(scene, id);
+    UpdateUISceneDrawSlot(scene, scene->idSlots[id]);
+}
+
+uint32_t GetUISceneElementState(const UIScene* scene, UISceneId id)
+{
+    if (id >= scene->idCapacity || scene->idSlots[id] == UISCENE_INVALID_ID)
+        return 0;
+    return scene->nodes[scene->idSlots[id]].flags & UI_STATE_MASK;
+}
+
+void SetUISceneElementRect(UIScene* scene, UISceneId id, UIRect rect)
+{
+    if (id >= scene->idCapacity || scene->idSlots[id] == UISCENE_INVALID_ID)
+        return;
+
+    size_t slot = scene->idSlots[id];
+    if (EqualsUIRect(scene->designRects[slot], rect))
+        return;
+
+    MarkUISceneElementDirty(scene, id);
+    scene->designRects[slot] = rect;
+    TransformUISceneGeometry(scene, slot, 1);
+    UpdateUIGridElement(scene, id);
+    MarkUISceneElementDirty(scene, id);
+    UpdateUISceneDrawSlot(scene, slot);
+}
+
+static int CompareUISceneIds(const void* a, const void* b)
+{
+    UISceneId x = *(const UISceneId*)a;
+    UISceneId y = *(const UISceneId*)b;
+    return (x > y) - (x < y);
+}
+
+static bool IsUISceneClipMember(const UIScene* scene, uint32_t clip, UISceneId id)
+{
+    return id < scene->idCapacity
+        && scene->idSlots[id] != UISCENE_INVALID_ID
+        && GetUISceneSlotClip(scene, scene->idSlots[id]) == clip;
+}
+
+// Drops the ids of a clip's elements that have left it or been deleted,
+// and the repeats of ones that were put back under it.
+static void PruneUISceneClipMembers(UIScene* scene, uint32_t clip)
+{
+    UISceneClipMembers* members = &scene->clipMembers[clip];
+    if (members->count == 0)
+        return;
+
+    qsort(members->ids, members->count, sizeof(UISceneId), CompareUISceneIds);
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < members->count; ++i)
+    {
+        UISceneId id = members->ids[i];
+        if ((kept == 0 || members->ids[kept - 1] != id) && IsUISceneClipMember(scene, clip, id))
+            members->ids[kept++] = id;
+    }
+    members->count = kept;
+}
+
+// A full list is pruned before it grows, so stale ids never make up
+// much more than half of it.
+void AddUISceneClipMember(UIScene* scene, uint32_t clip, UISceneId id)
+{
+    UISceneClipMembers* members = &scene->clipMembers[clip];
+    if (members->count == members->capacity)
+    {
+        PruneUISceneClipMembers(scene, clip);
+        if (members->count * 2 >= members->capacity)
+        {
+            members->capacity = members->capacity > 0 ? members->capacity * 2 : 8;
+            members->ids = (UISceneId*)realloc(members->ids, members->capacity * sizeof(UISceneId));
+        }
+    }
+    members->ids[members->count++] = id;
+}
+
+// Removed clips are reused first, so clip numbers stay as low as the
+// number of clips in use, and fit the draw key.
+uint32_t AddUISceneClip(UIScene* scene, UIRect rect)
+{
+    uint32_t clip;
+    if (scene->freeClipCount > 0)
+    {
+        clip = scene->freeClips[--scene->freeClipCount];
+    }
+    else
+    {
+        if (scene->clipCount == scene->clipCapacity)
+        {
+            scene->clipCapacity = scene->clipCapacity > 0 ? scene->clipCapacity * 2 : 4;
+            scene->clips = (UIRect*)realloc(
+                scene->clips, scene->clipCapacity * sizeof(UIRect));
+            scene->screenClips = (UIRect*)realloc(
+                scene->screenClips, scene->clipCapacity * sizeof(UIRect));
+            scene->freeClips = (uint32_t*)realloc(
+                scene->freeClips, scene->clipCapacity * sizeof(uint32_t));
+            scene->clipMembers = (UISceneClipMembers*)realloc(
+                scene->clipMembers, scene->clipCapacity * sizeof(UISceneClipMembers));
+        }
+        clip = scene->clipCount++;
+        memset(&scene->clipMembers[clip], 0, sizeof(UISceneClipMembers));
+    }
+
+    scene->clips[clip] = rect;
+    scene->screenClips[clip] = ScreenTransformUIRect(rect, scene->transform);
+    return clip;
+}
+
+// No element may use clip anymore. Until it is reused it is empty, so
+// nothing drawn under it by mistake shows.
+void RemoveUISceneClip(UIScene* scene, uint32_t clip)
+{
+    if (clip >= scene->clipCount)
+        return;
+
+    AddUISceneDamage(scene, scene->screenClips[clip]);
+    scene->clips[clip] = UIRECT_ZERO;
+    scene->screenClips[clip] = UIRECT_ZERO;
+    scene->clipMembers[clip].count = 0;
+    scene->freeClips[scene->freeClipCount++] = clip;
+}
+
+// Everything drawn under a clip lies inside it, so damaging the old and
+// new clip areas covers whatever the change reveals or hides. Only the
+// draw items of the clip's own elements are cut to the new clip.
+void SetUISceneClip(UIScene* scene, uint32_t clip, UIRect rect)
+{
+    if (clip >= scene->clipCount || EqualsUIRect(scene->clips[clip], rect))
+        return;
+
+    AddUISceneDamage(scene, scene->screenClips[clip]);
+    scene->clips[clip] = rect;
+    scene->screenClips[clip] = ScreenTransformUIRect(rect, scene->transform);
+    AddUISceneDamage(scene, scene->screenClips[clip]);
+    PruneUISceneClipMembers(scene, clip);
+    const UISceneClipMembers* members = &scene->clipMembers[clip];
+    for (uint32_t i = 0; i < members->count && scene->drawList.valid; ++i)
+        UpdateUISceneDrawSlot(scene, scene->idSlots[members->ids[i]]);
+}
+
+void SetUISceneElementClip(UIScene* scene, UISceneId id, uint32_t clip)
+{
+    if (id >= scene->idCapacity || scene->idSlots[id] == UISCENE_INVALID_ID)
+        return;
+
+    size_t slot = scene->idSlots[id];
+    MarkUISceneElementDirty(scene, id);
+    if (clip < scene->clipCount)
+    {
+        bool joins = GetUISceneSlotClip(scene, slot) != clip;
+        scene->nodes[slot].flags |= UI_NODE_CLIPPED;
+        scene->clipIds[slot] = clip;
+        if (joins)
+            AddUISceneClipMember(scene, clip, id);
+    }
+    else
+    {
+        scene->nodes[slot].flags &= ~UI_NODE_CLIPPED;
+    }
+    MarkUISceneElementDirty(scene, id);
+    UpdateUISceneDrawSlot(scene, slot);
+}
+
+// The draw list, the pick grid and text layouts are all in design space,
+// so none of them change with the transform.
+void SetUISceneTransform(UIScene* scene, ScreenTransform t)
+{
+    PROFILE_ZONE("SetUISceneTransform");
+    scene->transform = t;
+    TransformUISceneGeometry(scene, 0, scene->size);
+    for (uint32_t i = 0; i < scene->clipCount; ++i)
+        scene->screenClips[i] = ScreenTransformUIRect(scene->clips[i], t);
+    scene->fullDamage = true;
+}
+
+void SetUISceneElementState(UIScene* scene, UISceneId id, uint32_t state)
+{
+    if (id >= scene->idCapacity || scene->idSlots[id] == UISCENE_INVALID_ID)
+        return;
+
+    UISceneNode* node = &scene->nodes[scene->idSlots[id]];
+    state &= UI_STATE_MASK;
+    if ((node->flags & UI_STATE_MASK) == state)
+        return;
+
+    node->flags = (node->flags & ~UI_STATE_MASK) | state;
+    MarkUISceneElementDirty(scene, id);
+}
+
+void UpdateUISceneHover(UIScene* scene, UIPoint point)
+{
+    UISceneId hovered = PickUIScene(scene, point, true);
+    if (hovered == scene->hovered)
+        return;
+
+    SetUISceneElementState(
+        scene, scene->hovered, GetUISceneElementState(scene, scene->hovered) & ~UI_STATE_HOVERED);
+    SetUISceneElementState(
+        scene, hovered, GetUISceneElementState(scene, hovered) | UI_STATE_HOVERED);
+
+    scene->hovered = hovered;
+}
+
+// Switches the scissor to the clip of the next slot, within the region
+// being drawn. Pending batches must be flushed before calling this.
+static void SwitchUISceneClip(
+    const UIScene* scene, uint32_t* active, uint32_t next, const UIRect* regionClip)
+{
+    if (*active == next)
+        return;
+
+    *active = next;
+    if (next != UISCENE_NO_CLIP)
+    {
+        UIRect rect = scene->screenClips[next];
+        BeginUIClip(regionClip != NULL ? IntersectUIRect(rect, *regionClip) : rect);
+    }
+    else if (regionClip != NULL)
+    {
+        BeginUIClip(*regionClip);
+    }
+    else
+    {
+        EndUIClip();
+    }
+}
+
+// Places and sizes each line of a design-space layout through the scene
+// transform.
+static void DrawUISceneText(const UIScene* scene, size_t slot, Color color)
+{
+    const UITextLayout* layout = &scene->layouts[slot];
+    ScreenTransform t = scene->transform;
+    float fontSize = scene->screen[UI_GEOM_FONT_SIZE][slot];
+    for (size_t i = 0; i < layout->lineCount; ++i)
+    {
+        UITextLine line = layout->lines[i];
+        line.size.w *= t.scale;
+        line.size.h *= t.scale;
+        DrawUITextLine(layout->str, &line, ScreenTransformUIPoint(line.pos, t), fontSize, color);
+    }
+}
+
+static void DrawUISceneItem(const UIScene* scene, const UIDrawItem* item)
+{
+    size_t slot = item->slot;
+    const UISceneNode* node = &scene->nodes[slot];
+    const UIStyle* style = GetUIStyle(node->style);
+    if (item->shader == UI_DRAW_SHADER_RECT)
+    {
+        float borderWidth = style->borderWidth * scene->transform.scale;
+        if (IsUIBackendReady())
+        {
+            PushUIRectInstance(node->rect, GetUISceneNodeBgColor(node), borderWidth, style->borderColor);
+            return;
+        }
+
+        DrawUIRect(node->rect, GetUISceneNodeBgColor(node));
+        if (borderWidth > 0)
+            DrawUIBorder(node->rect, borderWidth, style->borderColor);
+    }
+    else if (item->shader == UI_DRAW_SHADER_TEXTURE)
+    {
+        const UITextureRegion* texture = &scene->textures[slot];
+        DrawUIBackendTexture(
+            texture->texture, texture->source, GetUIGeometryTextureRect(scene->screen, slot));
+    }
+    else
+    {
+        DrawUISceneText(scene, slot, style->fontColor);
+    }
+}
+
+// Rects are batched into instanced draws, textures and text into rlgl's
+// batch, which breaks on every texture or shader change. The sorted draw
+// list keeps runs of the same kind together; pending rects only have to
+// be flushed when a run of something else, or another clip, starts. Any
+// subset of the list is still in a valid order, so a region draws just
+// the items the list finds under it, without looking at the rest. Items
+// are in design space, so the region is mapped back to it; rounding can
+// only misjudge items that reach far less than a pixel into it.
+void DrawUISceneRegion(UIScene* scene, const UIRect* clip)
+{
+    PROFILE_ZONE("DrawUISceneRegion");
+    if (!scene->drawList.valid)
+        BuildUISceneDrawList(scene);
+
+    size_t count = scene->drawList.count;
+    const size_t* indices = NULL;
+    if (clip != NULL)
+    {
+        indices = GetUIDrawItemsInRect(
+            &scene->drawList, InverseScreenTransformUIRect(*clip, scene->transform), &count);
+    }
+
+    uint32_t activeClip = UISCENE_NO_CLIP;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const UIDrawItem* item = &scene->drawList.items[indices != NULL ? indices[i] : i];
+
+        uint32_t slotClip = GetUISceneSlotClip(scene, item->slot);
+        if (item->shader != UI_DRAW_SHADER_RECT || slotClip != activeClip)
+            FlushUIRectInstances();
+
+        // A reload drops layouts built from text it let go of; only the
+        // text drawn is laid out again.
+        if (item->shader == UI_DRAW_SHADER_TEXT)
+            UpdateUISceneSlotLayout(scene, item->slot);
+
+        SwitchUISceneClip(scene, &activeClip, slotClip, clip);
+        DrawUISceneItem(scene, item);
+    }
+
+    FlushUIRectInstances();
+    SwitchUISceneClip(scene, &activeClip, UISCENE_NO_CLIP, clip);
+}
+
+void DrawUIScene(UIScene* scene)
+{
+    DrawUISceneRegion(scene, NULL);
+}
+
+void DeleteUIScene(UIScene* scene)
+{
+    for (size_t i = 0; i < scene->size; ++i)
+        FreeUITextLayout(&scene->layouts[i]);
+
+    FreeUISceneArray(scene, scene->nodes);
+    FreeUISceneArray(scene, scene->designRects);
+    free(scene->textures);
+    free(scene->texts);
+    free(scene->layouts);
+    FreeUISceneArray(scene, scene->clipIds);
+    for (int f = 0; f < UI_GEOM_FIELD_COUNT; ++f)
+    {
+        FreeUISceneArray(scene, scene->design[f]);
+        FreeUISceneArray(scene, scene->screen[f]);
+    }
+    free(scene->clips);
+    free(scene->screenClips);
+    free(scene->freeClips);
+    for (uint32_t i = 0; i < scene->clipCount; ++i)
+        free(scene->clipMembers[i].ids);
+    free(scene->clipMembers);
+    free(scene->idSlots);
+    free(scene->freeIds);
+    FreeUIGrid(&scene->grid);
+    FreeUIDrawList(&scene->drawList);
+    FreeUISceneFileLink(&scene->file);
+    free(scene);
 }
 
 // -----------------------------------------------------------------------------
 
-UIScene* CreateUIScene();
-void InsertIntoUIScene(UIElement* elem);
-void DeleteFromUIScene(UIElement* elem);
-void DrawUIScene(const UIScene* scene);
-void DeleteUIScene(UIScene* scene);
\ No newline at end of file
+// Pads a damage rect out to whole pixels so antialiased edges of what was
+// there before are cleared and redrawn too.
+static UIRect PadDamageRect(UIRect rect)
+{
+    return (UIRect)
+    {
+        floorf(rect.left) - 1.0f,
+        floorf(rect.top) - 1.0f,
+        ceilf(rect.right) + 1.0f,
+        ceilf(rect.bottom) + 1.0f
+    };
+}
+
+// Redraws the damaged parts of the scene into the backend's composite
+// target. Returns whether anything was redrawn.
+bool ComposeUIScene(UIScene* scene, Color clearColor)
+{
+    PROFILE_ZONE("ComposeUIScene");
+    if (!IsUIBackendReady())
+        return false;
+
+    UISize screen = GetUIBackendScreenSize();
+    if (ResizeUIComposite((int)screen.w, (int)screen.h))
+        scene->fullDamage = true;
+
+    // A restyle can touch any element, so it redraws the whole scene.
+    if (scene->styleGeneration != GetUIStyleGeneration())
+    {
+        scene->styleGeneration = GetUIStyleGeneration();
+        scene->fullDamage = true;
+    }
+
+    if (!HasUISceneDamage(scene))
+        return false;
+
+    BeginUIComposite();
+    if (scene->fullDamage)
+    {
+        ClearUIBackend(clearColor);
+        DrawUISceneRegion(scene, NULL);
+    }
+    else
+    {
+        for (size_t i = 0; i < scene->damageCount; ++i)
+        {
+            UIRect clip = PadDamageRect(scene->damage[i]);
+            BeginUIClip(clip);
+            ClearUIBackend(clearColor);
+            DrawUISceneRegion(scene, &clip);
+            EndUIClip();
+        }
+    }
+    EndUIComposite();
+
+    ClearUISceneDamage(scene);
+    return true;
+}
@@ -5,12 +5,24 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "arena.h"
 #include "util.h"
 #include "raylib.h"
 
 #define SCREEN_TRANSFORM_NONE (ScreenTransform) { 0, 0, 1 }
 #define UIPOINT_ZERO (UIPoint) { 0, 0 }
 #define UIRECT_ZERO (UIRect) { 0, 0 }
+#define UISCENE_INVALID_ID UINT32_MAX
+#define UISCENE_MAX_DAMAGE 8
+#define UIHANDLE_NULL (UIHandle) { UINT32_MAX, 0 }
+#define UILAYOUT_NONE UINT32_MAX
+#define UISCENE_NO_CLIP UINT32_MAX
+#define UISCENE_FILE_MAGIC 0x49554D57u
+#define UISCENE_FILE_VERSION 3
+#define UISCENE_FILE_ALIGN 16
+#define UISCENE_FILE_NONE UINT32_MAX
+#define FONT_SIZE_SPACING_FACTOR 0.1f
+#define UI_ELLIPSIS "..."
 
 #define WARMAGIC_STYLE (UIStyle) { BLACK, 4.0f, DARKPURPLE, PURPLE }
 #define WARMAGIC_STYLE_NOBORDER (UIStyle) { BLACK, 0.0f, BLANK, PURPLE }
@@ -42,11 +54,17 @@ typedef struct UIRect
     float bottom;
 } UIRect;
 
+// Part of a texture, in pixels; usually an icon packed into an atlas page.
+typedef struct UITextureRegion
+{
+    Texture2D texture;
+    UIRect source;
+} UITextureRegion;
+
 typedef struct UIText
 {
     char* str;
     float fontSize;
-    Color fontColor;
 } UIText;
 
 typedef enum HAlign
@@ -59,6 +77,23 @@ typedef enum VAlign
     V_CENTER, V_TOP, V_BOTTOM
 } VAlign;
 
+typedef enum UIKind
+{
+    UI_STATIC, UI_BUTTON, UI_TOGGLE
+} UIKind;
+
+#define UI_STATE_HOVERED 0x1u
+#define UI_STATE_PRESSED 0x2u
+#define UI_STATE_TOGGLED 0x4u
+#define UI_STATE_MASK 0x7u
+
+#define UI_TEXT_WRAP 0x1u
+#define UI_TEXT_ELLIPSIS 0x2u
+#define UI_TEXT_FLOW_MASK 0x3u
+
+// Margins pad the text from the rect. flow holds UI_TEXT_* flags for text
+// that does not fit the rect inside the margins: UI_TEXT_WRAP breaks
+// lines between words, UI_TEXT_ELLIPSIS cuts it short.
 typedef struct UIAlign
 {
     HAlign halign;
@@ -67,23 +102,82 @@ typedef struct UIAlign
     float topMargin;
     float rightMargin;
     float bottomMargin;
+    uint32_t flow;
 } UIAlign;
 
+typedef struct UIStringView
+{
+    const char* data;
+    size_t length;
+} UIStringView;
+
+// A line cut short is drawn with UI_ELLIPSIS after it, which size
+// includes.
+typedef struct UITextLine
+{
+    size_t start;
+    size_t length;
+    UISize size;
+    UIPoint pos;
+    bool ellipsis;
+} UITextLine;
+
+typedef struct UITextLayout
+{
+    bool valid;
+    const char* str;
+    float fontSize;
+    UIRect rect;
+    UIAlign align;
+    UITextLine* lines;
+    size_t lineCount;
+    size_t lineCap;
+    UIPoint origin;
+    UISize size;
+} UITextLayout;
+
+typedef uint32_t UIStyleId;
+
+// Colors and border width come from the interned style. scale is the
+// screen transform applied to the element, which style metrics follow.
 typedef struct UIElement
 {
     UIRect rect;
-    Color bgColor;
-    float borderWidth;
-    Color borderColor;
+    UIStyleId style;
+    float scale;
+    UIKind kind;
     bool hasTexture;
     UIRect textureRect;
-    Texture2D texture;
+    UITextureRegion texture;
     bool hasText;
     UIText text;
     UIAlign textAlign;
+    UITextLayout textLayout;
     uint32_t optState;
 } UIElement;
 
+// Generational reference to a pooled UIElement. A handle goes stale once
+// its element is deleted, even if the slot is reused by a new element.
+typedef struct UIHandle
+{
+    uint32_t index;
+    uint32_t generation;
+} UIHandle;
+
+// Elements live in fixed-size blocks that are never moved or freed until
+// the pool is unloaded, so creating and deleting elements only touches the
+// free list once the pool has warmed up. A slot is live while its
+// generation is odd.
+typedef struct UIElementPool
+{
+    UIElement** blocks;
+    uint32_t blockCount;
+    uint32_t* generations;
+    uint32_t* freeList;
+    uint32_t freeCount;
+    uint32_t capacity;
+} UIElementPool;
+
 typedef struct UIStyle
 {
     Color bgColor;
@@ -92,54 +186,562 @@ typedef struct UIStyle
     Color fontColor;
 } UIStyle;
 
+// Every distinct UIStyle is stored once and referred to by its index.
+// Changing a style in place restyles everything that uses it; generation
+// counts those changes so scenes know to redraw.
+typedef struct UIStyleRegistry
+{
+    UIStyle* styles;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t generation;
+} UIStyleRegistry;
+
+typedef uint32_t UISceneId;
+
+// Per-slot scene geometry that is only needed to draw an element is kept
+// as one float array per field so a screen transform is a handful of
+// linear scale-and-offset passes. Fields are grouped by how ScreenTransform
+// applies to them.
+typedef enum UIGeometryField
+{
+    UI_GEOM_TEX_LEFT, UI_GEOM_TEX_RIGHT,
+    UI_GEOM_TEX_TOP, UI_GEOM_TEX_BOTTOM,
+    UI_GEOM_FONT_SIZE,
+    UI_GEOM_FIELD_COUNT
+} UIGeometryField;
+
+#define UI_GEOM_X_FIRST UI_GEOM_TEX_LEFT
+#define UI_GEOM_Y_FIRST UI_GEOM_TEX_TOP
+#define UI_GEOM_SCALE_FIRST UI_GEOM_FONT_SIZE
+
+// The low bits of UISceneNode.flags hold the UI_STATE_* bits.
+#define UI_NODE_TEXTURE 0x10u
+#define UI_NODE_TEXT 0x20u
+#define UI_NODE_CLIPPED 0x40u
+#define UI_NODE_KIND_SHIFT 8
+
+// What culling, picking and the rect batch need from a scene element,
+// packed into half a cache line. rect is in screen space; elements with a
+// higher drawKey draw on top.
+typedef struct UISceneNode
+{
+    UIRect rect;
+    uint32_t flags;
+    uint32_t style;
+    uint32_t drawKey;
+    UISceneId id;
+} UISceneNode;
+
+typedef struct UISceneText
+{
+    UIText text;
+    UIAlign align;
+} UISceneText;
+
+typedef struct UIGridCell
+{
+    UISceneId* ids;
+    uint32_t count;
+    uint32_t capacity;
+} UIGridCell;
+
+// Inclusive cell range covered by an element; empty when col0 > col1.
+typedef struct UIGridRange
+{
+    int32_t col0;
+    int32_t row0;
+    int32_t col1;
+    int32_t row1;
+} UIGridRange;
+
+// Uniform grid over the design-space rects of a scene, used for picking,
+// so the scene transform never touches it. Cells hold scene ids; ranges
+// remembers, per id, which cells it is in so moving an element only
+// touches the cells it enters and leaves.
+typedef struct UIGrid
+{
+    float originX;
+    float originY;
+    float cellSize;
+    int32_t cols;
+    int32_t rows;
+    UIGridCell* cells;
+    UIGridRange* ranges;
+    size_t rangeCapacity;
+    size_t rebuildSize;
+} UIGrid;
+
+// Which pipeline a draw list item goes through; items on the same one
+// batch together as long as their texture matches too.
+typedef enum UIDrawShader
+{
+    UI_DRAW_SHADER_RECT, UI_DRAW_SHADER_TEXTURE, UI_DRAW_SHADER_TEXT,
+    UI_DRAW_SHADER_COUNT
+} UIDrawShader;
+
+typedef struct UIDrawItem
+{
+    UIRect bounds;
+    uint64_t key;
+    uint32_t slot;
+    UIDrawShader shader;
+} UIDrawItem;
+
+// Where one slot of a sorted draw list stands: the union of its items,
+// the grid cells that covers, its layer, and the key each of its items
+// was sorted under, for the shaders it has an item for.
+typedef struct UIDrawSlot
+{
+    UIRect bounds;
+    UIGridRange range;
+    uint32_t layer;
+    uint32_t shaders;
+    uint64_t keys[UI_DRAW_SHADER_COUNT];
+} UIDrawSlot;
+
+typedef struct UIDrawCell
+{
+    uint32_t* slots;
+    uint32_t count;
+    uint32_t capacity;
+} UIDrawCell;
+
+// A scene's primitives, recorded in draw order with the area each can
+// touch. The items of one slot are pushed together, in shader order.
+// Sorting gives every slot a layer one above the highest earlier slot it
+// overlaps, and each item a sublayer of that by shader, so items sharing
+// a layer never overlap and can be regrouped freely. Items are then
+// ordered by (layer, clip, shader, texture), stably, which draws the same
+// picture as draw order with far fewer batch breaks. Once sorted, the
+// list keeps its slots on a grid of cells, so one slot can be replaced or
+// removed by re-layering just it and the later slots it overlaps.
+typedef struct UIDrawList
+{
+    UIDrawItem* items;
+    size_t count;
+    size_t capacity;
+    UIDrawSlot* slots;
+    size_t slotCount;
+    size_t slotCapacity;
+    UIDrawCell* cells;
+    int32_t cols;
+    int32_t rows;
+    UIPoint origin;
+    float cellInv;
+    size_t rebuildSlotCount;
+    bool valid;
+} UIDrawList;
+
+// A compiled scene file in memory: mapped from disk where the platform
+// allows it, read into a heap buffer otherwise. The mapping is private,
+// so writes to it never reach the file.
+typedef struct UISceneMapping
+{
+    void* data;
+    size_t size;
+    bool mapped;
+} UISceneMapping;
+
+// The scene files a scene was loaded and reloaded from, newest last.
+// Older mappings are kept while its arrays or strings still point into
+// them, and unmapped by the first reload that finds them unused. ids and clips hold the live id of
+// each element and clip of the newest file; elements maps ids back to
+// file elements, so a deleted id that gets reused is not mistaken for
+// the element it used to be.
+typedef struct UISceneFileLink
+{
+    UISceneMapping* mappings;
+    size_t mappingCount;
+    UISceneId* ids;
+    uint32_t* clips;
+    uint32_t* elements;
+    size_t elementCapacity;
+} UISceneFileLink;
+
+// The ids of the elements put under one clip. Ids are only ever added;
+// ones that have left the clip or been deleted since are dropped when
+// the list is walked or full.
+typedef struct UISceneClipMembers
+{
+    UISceneId* ids;
+    uint32_t count;
+    uint32_t capacity;
+} UISceneClipMembers;
+
+// Elements are split by access pattern and stored in draw order. nodes and
+// designRects are all that picking reads. The other per-slot arrays are
+// side tables only looked at when the node flags say the element has a
+// texture, text or a clip: design holds the design-space geometry before
+// the scene transform and screen holds it after. layouts are built in
+// design space and scaled as they are drawn. Clipped elements are only
+// drawn and picked inside clips[clipIds[slot]], which screenClips holds
+// in screen space, and clipMembers lists the elements under each;
+// removed clips wait in freeClips to be reused.
+// drawList holds the sorted primitives and grid the pick cells, both in
+// design space, so edits update them but the transform does not. Ids
+// stay stable across deletions; idSlots maps them to slots. damage
+// collects the screen areas changed since the scene was last composed. A
+// scene loaded from a file draws from the arrays in its mappings until
+// it has to grow them.
 typedef struct UIScene
 {
     size_t size;
-    UIElement** elements;
+    size_t capacity;
+    UISceneNode* nodes;
+    UIRect* designRects;
+    UITextureRegion* textures;
+    UISceneText* texts;
+    UITextLayout* layouts;
+    uint32_t* clipIds;
+    float* design[UI_GEOM_FIELD_COUNT];
+    float* screen[UI_GEOM_FIELD_COUNT];
+    UIRect* clips;
+    UIRect* screenClips;
+    UISceneClipMembers* clipMembers;
+    uint32_t clipCount;
+    uint32_t clipCapacity;
+    uint32_t* freeClips;
+    uint32_t freeClipCount;
+    uint32_t styleGeneration;
+    uint32_t nextDrawKey;
+    uint32_t* idSlots;
+    size_t idCapacity;
+    UISceneId* freeIds;
+    size_t freeIdCount;
+    ScreenTransform transform;
+    UIGrid grid;
+    UIDrawList drawList;
+    UISceneFileLink file;
+    UISceneId hovered;
+    bool fullDamage;
+    UIRect damage[UISCENE_MAX_DAMAGE];
+    size_t damageCount;
 } UIScene;
 
+// Sections of a compiled scene file. The first five are a UIScene's own
+// per-slot arrays at the identity transform, laid out so a loaded scene
+// can use them in place: nodes, designRects, the design geometry fields
+// back to back, the same again for screen, and clipIds. The rest only
+// hold what cannot be stored as is, and the tables they index.
+typedef enum UISceneFileSection
+{
+    UI_SCENE_FILE_NODES,
+    UI_SCENE_FILE_DESIGN_RECTS,
+    UI_SCENE_FILE_DESIGN,
+    UI_SCENE_FILE_SCREEN,
+    UI_SCENE_FILE_CLIP_IDS,
+    UI_SCENE_FILE_ELEMENTS,
+    UI_SCENE_FILE_CLIPS,
+    UI_SCENE_FILE_STYLES,
+    UI_SCENE_FILE_TEXTURES,
+    UI_SCENE_FILE_STRINGS,
+    UI_SCENE_FILE_SECTION_COUNT
+} UISceneFileSection;
+
+// sections holds the byte offset of each section, aligned to
+// UISCENE_FILE_ALIGN. nodeSize and elementSize catch files written with
+// a different struct layout.
+typedef struct UISceneFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t nodeSize;
+    uint32_t elementSize;
+    uint32_t elementCount;
+    uint32_t clipCount;
+    uint32_t styleCount;
+    uint32_t textureCount;
+    uint32_t stringSize;
+    uint32_t sections[UI_SCENE_FILE_SECTION_COUNT];
+} UISceneFileHeader;
+
+// A file element as compiled. A scene edits the arrays it loaded in
+// place, so reloading diffs these instead. key, text and the texture
+// table entries are offsets into the null-terminated string pool, key
+// naming the element; texture, style and clip index the file's tables.
+// flags are the element's UISceneNode flags. Unused fields hold
+// UISCENE_FILE_NONE.
+typedef struct UISceneFileElement
+{
+    uint32_t key;
+    uint32_t text;
+    uint32_t texture;
+    uint32_t style;
+    uint32_t clip;
+    uint32_t flags;
+    UIRect rect;
+    UIRect textureRect;
+    float fontSize;
+    UIAlign align;
+} UISceneFileElement;
+
+// Looks up a texture named in a scene file. Returns false if there is no
+// such texture.
+typedef bool (*UISceneTextureFn)(void* user, const char* name, UITextureRegion* out);
+
+// Tells when a file has been written or replaced. On Linux it watches the
+// file's directory with inotify, which also sees a new file renamed over
+// the old one; elsewhere it compares modification times.
+typedef struct UISceneWatcher
+{
+    int fd;
+    char* path;
+    char* name;
+    int64_t modified;
+} UISceneWatcher;
+
+// Skyline bin packer: skyline holds the top edge of the packed area as
+// runs of constant height, left to right.
+typedef struct UISkylineRun
+{
+    int x;
+    int y;
+    int width;
+} UISkylineRun;
+
+typedef struct UIAtlasPage
+{
+    Image image;
+    Texture2D texture;
+    UISkylineRun* skyline;
+    size_t runCount;
+    size_t runCapacity;
+    bool dirty;
+} UIAtlasPage;
+
+// Packs many small RGBA images into a few pageSize x pageSize textures so
+// elements drawn from the same page batch together. Pages are uploaded by
+// UploadUIAtlas, and again after more images are added to them.
+typedef struct UIAtlas
+{
+    int pageSize;
+    int padding;
+    UIAtlasPage* pages;
+    size_t pageCount;
+} UIAtlas;
+
+typedef uint32_t UILayoutId;
+
+// How a layout node places its children. Anchor children are positioned
+// relative to fractions of the parent's inner rect; row and column
+// children are laid out along one axis, flex style.
+typedef enum UILayoutKind
+{
+    UI_LAYOUT_ANCHOR, UI_LAYOUT_ROW, UI_LAYOUT_COLUMN
+} UILayoutKind;
+
+// anchors holds fractions of the parent's inner rect that each edge is
+// pinned to, and offsets is added to them. In a row or column, a child
+// takes basis along the main axis plus its grow share of the space left
+// over. Across it the child stretches, or is centered if crossSize is set.
+typedef struct UILayoutNode
+{
+    UILayoutId parent;
+    UILayoutId firstChild;
+    UILayoutId lastChild;
+    UILayoutId nextSibling;
+    UILayoutKind kind;
+    UIRect anchors;
+    UIRect offsets;
+    float basis;
+    float grow;
+    float crossSize;
+    float padding;
+    float gap;
+    UISceneId element;
+    UIRect rect;
+    bool dirty;
+    bool childDirty;
+} UILayoutNode;
+
+// Tree of layout nodes in design units. A node whose constraints change
+// is marked dirty so its parent re-arranges it and its siblings, and its
+// ancestors are marked childDirty so updates can find it. Subtrees that
+// are clean and keep their rect are skipped.
+typedef struct UILayout
+{
+    UILayoutNode* nodes;
+    size_t count;
+    size_t capacity;
+    UILayoutId root;
+} UILayout;
+
+// Fills in row for list item. Strings put in row must outlive the list
+// or the next rebind of the row.
+typedef void (*UIScrollListBindFn)(void* user, size_t item, UIElement* row);
+
+// Scrolling panel over itemCount rows of rowHeight. Only the rows in view
+// exist as scene elements: row element k shows the items i for which
+// i % rowCount == k, so scrolling by one row rebinds a single element and
+// moves the rest. Rows are clipped to rect; spare ones wait below it.
+typedef struct UIScrollList
+{
+    UIScene* scene;
+    UIRect rect;
+    float rowHeight;
+    size_t itemCount;
+    float scroll;
+    UIStyleId style;
+    UISceneId panel;
+    uint32_t clip;
+    UISceneId* rows;
+    size_t* rowItems;
+    size_t rowCount;
+    UIScrollListBindFn bind;
+    void* user;
+} UIScrollList;
+
 Vector2 UIPointToVector2(UIPoint point);
 Rectangle UIRectToRectangle(UIRect rect);
 
+void BeginUIFrame();
+Arena* GetUIFrameArena();
+void FreeUIFrameArena();
+
+UIStringView MakeUIStringView(const char* str);
+bool NextUILine(UIStringView* rest, UIStringView* line);
+
 UISize GetUIRectSize(UIRect rect);
 UISize GetUITextSize(UIText text);
 bool CollidesUIRectUIPoint(UIRect rect, UIPoint point);
+bool OverlapsUIRect(UIRect a, UIRect b);
+UIRect UnionUIRect(UIRect a, UIRect b);
+UIRect IntersectUIRect(UIRect a, UIRect b);
+bool IsUIRectEmpty(UIRect rect);
 UIPoint GetCenterUIRect(UIRect rect);
 UIRect SetCenterUIRect(UIRect rect, UIPoint center);
 UIRect CenterUIRectOnUIRect(UIRect base, UIRect rect);
 
 ScreenTransform GetScreenTransform(int w, int h, int ow, int oh);
+ScreenTransform GetScreenScaleTransform(int w, int h, int ow, int oh);
 UIPoint ScreenTransformUIPoint(UIPoint point, ScreenTransform t);
 UIRect ScreenTransformUIRect(UIRect rect, ScreenTransform t);
+UIPoint InverseScreenTransformUIPoint(UIPoint point, ScreenTransform t);
+UIRect InverseScreenTransformUIRect(UIRect rect, ScreenTransform t);
 UIText ScreenTransformUIText(UIText text, ScreenTransform t);
 
+UITextureRegion GetUITextureRegion(Texture2D texture);
+
 void DrawUIRect(UIRect rect, Color color);
 void DrawUIBorder(UIRect rect, float width, Color color);
-void DrawUIText(UIRect rect, UIText text, UIAlign align);
-
-UIElement* CreateEmptyUIElement();
-UIElement* CreateSolidRect(UIRect rect, UIStyle style);
-UIElement* CreateLabel(UIRect rect, char* text, float fontSize, UIAlign textAlign, UIStyle style);
-UIElement* CreateTextureElement(UIRect rect, UIRect textureRect, Texture2D texture, UIStyle style);
-UIElement* CreateButton(UIRect rect, char* text, float fontSize, UIAlign textAlign, UIStyle style);
-UIElement* CreateButtonWithTexture(UIRect rect, UIRect textureRect, Texture2D texture, UIStyle style);
-UIElement* CreateButtonWithTextureAndText(
+void DrawUIText(UIRect rect, UIText text, UIAlign align, Color color);
+
+void UpdateUITextLayout(UITextLayout* layout, UIRect rect, UIText text, UIAlign align);
+void InvalidateUITextLayout(UITextLayout* layout);
+void DrawUITextLayout(const UITextLayout* layout, UIText text, Color color);
+UIRect GetUITextLayoutBounds(const UITextLayout* layout);
+void FreeUITextLayout(UITextLayout* layout);
+
+const UITextLine* GetUITextLines(UIText text, uint32_t flow, UISize content, size_t* count);
+void UnloadUITextLines();
+
+UIStyleId InternUIStyle(UIStyle style);
+const UIStyle* GetUIStyle(UIStyleId id);
+void SetUIStyle(UIStyleId id, UIStyle style);
+uint32_t GetUIStyleGeneration();
+void UnloadUIStyles();
+
+UIHandle CreateEmptyUIElement();
+UIElement* GetUIElement(UIHandle handle);
+bool IsUIElementAlive(UIHandle handle);
+void DeleteUIElement(UIHandle handle);
+void UnloadUIElementPool();
+
+UIHandle CreateSolidRect(UIRect rect, UIStyleId style);
+UIHandle CreateLabel(UIRect rect, char* text, float fontSize, UIAlign textAlign, UIStyleId style);
+UIHandle CreateTextureElement(UIRect rect, UIRect textureRect, UITextureRegion texture, UIStyleId style);
+UIHandle CreateButton(UIRect rect, char* text, float fontSize, UIAlign textAlign, UIStyleId style);
+UIHandle CreateButtonWithTexture(UIRect rect, UIRect textureRect, UITextureRegion texture, UIStyleId style);
+UIHandle CreateButtonWithTextureAndText(
     UIRect rect, char* text, float fontSize, UIAlign textAlign,
-    UIRect textureRect, Texture2D texture, UIStyle style);
-UIElement* CreateToggleButton(UIRect rect, char* text, float fontSize, UIAlign textAlign, bool isToggled, UIStyle style);
-UIElement* CreateToggleButtonWithTexture(UIRect rect, UIRect textureRect, Texture2D texture, bool isToggled, UIStyle style);
-UIElement* CreateToggleButtonWithTextureAndText(
+    UIRect textureRect, UITextureRegion texture, UIStyleId style);
+UIHandle CreateToggleButton(UIRect rect, char* text, float fontSize, UIAlign textAlign, bool isToggled, UIStyleId style);
+UIHandle CreateToggleButtonWithTexture(UIRect rect, UIRect textureRect, UITextureRegion texture, bool isToggled, UIStyleId style);
+UIHandle CreateToggleButtonWithTextureAndText(
     UIRect rect, char* text, float fontSize, UIAlign textAlign,
-    UIRect textureRect, Texture2D texture, bool isToggled, UIStyle style);
+    UIRect textureRect, UITextureRegion texture, bool isToggled, UIStyleId style);
 
+void SetUIElementText(UIElement* elem, char* text);
 void ScreenTransformUIElement(const UIElement* elem, ScreenTransform t, UIElement* res);
-void DrawUIElement(const UIElement* elem);
-void DeleteUIElement(UIElement* elem);
+Color GetUIElementBgColor(const UIElement* elem);
+bool HasUIElementOverlay(const UIElement* elem);
+void DrawUIElement(UIElement* elem);
 
 UIScene* CreateUIScene();
-void InsertIntoUIScene(UIElement* elem);
-void DeleteFromUIScene(UIElement* elem);
-void DrawUIScene(const UIScene* scene);
+UISceneId InsertIntoUIScene(UIScene* scene, const UIElement* elem);
+void DeleteFromUIScene(UIScene* scene, UISceneId id);
+bool GetUISceneElement(const UIScene* scene, UISceneId id, UIElement* out);
+void SetUISceneElement(UIScene* scene, UISceneId id, const UIElement* elem);
+uint32_t GetUISceneElementState(const UIScene* scene, UISceneId id);
+void SetUISceneElementRect(UIScene* scene, UISceneId id, UIRect rect);
+uint32_t AddUISceneClip(UIScene* scene, UIRect rect);
+void RemoveUISceneClip(UIScene* scene, uint32_t clip);
+void SetUISceneClip(UIScene* scene, uint32_t clip, UIRect rect);
+void SetUISceneElementClip(UIScene* scene, UISceneId id, uint32_t clip);
+void AddUISceneClipMember(UIScene* scene, uint32_t clip, UISceneId id);
+void SetUISceneTransform(UIScene* scene, ScreenTransform t);
+void SetUISceneElementState(UIScene* scene, UISceneId id, uint32_t state);
+void UpdateUISceneHover(UIScene* scene, UIPoint point);
+void AddUISceneDamage(UIScene* scene, UIRect rect);
+void MarkUISceneElementDirty(UIScene* scene, UISceneId id);
+bool HasUISceneDamage(const UIScene* scene);
+void ClearUISceneDamage(UIScene* scene);
+void DrawUISceneRegion(UIScene* scene, const UIRect* clip);
+void DrawUIScene(UIScene* scene);
+UISceneId PickUIScene(const UIScene* scene, UIPoint point, bool interactiveOnly);
 void DeleteUIScene(UIScene* scene);
 
+bool CompileUIScene(const char* source, const char* path, char* error, size_t errorSize);
+UIScene* LoadUIScene(const char* path, UISceneTextureFn texture, void* user);
+bool ReloadUIScene(UIScene* scene, const char* path, UISceneTextureFn texture, void* user);
+UISceneId FindUISceneElement(const UIScene* scene, const char* key);
+void UnlinkUISceneFileElement(UISceneFileLink* link, UISceneId id);
+void FreeUISceneFileLink(UISceneFileLink* link);
+
+UISceneWatcher* WatchUISceneFile(const char* path);
+bool PollUISceneWatcher(UISceneWatcher* watcher);
+void UnwatchUISceneFile(UISceneWatcher* watcher);
+
+void RebuildUIGrid(UIScene* scene);
+void UpdateUIGridElement(UIScene* scene, UISceneId id);
+void RemoveFromUIGrid(UIScene* scene, UISceneId id);
+void FreeUIGrid(UIGrid* grid);
+
+bool ComposeUIScene(UIScene* scene, Color clearColor);
+
+void ResetUIDrawList(UIDrawList* list);
+void PushUIDrawItem(
+    UIDrawList* list, uint32_t slot, UIDrawShader shader, uint32_t texture, uint32_t clip, UIRect bounds);
+void SortUIDrawList(UIDrawList* list, size_t slotCount);
+void ReplaceUIDrawSlot(UIDrawList* list, uint32_t slot, size_t sorted);
+void RemoveUIDrawSlot(UIDrawList* list, uint32_t slot);
+const size_t* GetUIDrawItemsInRect(const UIDrawList* list, UIRect rect, size_t* count);
+void FreeUIDrawList(UIDrawList* list);
+
+UILayout* CreateUILayout();
+UILayoutId AddUILayoutNode(UILayout* layout, UILayoutId parent, UILayoutKind kind);
+void SetUILayoutAnchors(UILayout* layout, UILayoutId id, UIRect anchors, UIRect offsets);
+void SetUILayoutFlex(UILayout* layout, UILayoutId id, float basis, float grow, float crossSize);
+void SetUILayoutSpacing(UILayout* layout, UILayoutId id, float padding, float gap);
+void BindUILayoutElement(UILayout* layout, UILayoutId id, UISceneId element);
+void UpdateUILayout(UILayout* layout, UIScene* scene, UIRect bounds);
+UIRect GetUILayoutRect(const UILayout* layout, UILayoutId id);
+void DeleteUILayout(UILayout* layout);
+
+UIAtlas* CreateUIAtlas(int pageSize, int padding);
+bool AddUIAtlasImage(UIAtlas* atlas, Image image, UITextureRegion* out);
+bool AddUIAtlasImages(UIAtlas* atlas, const Image* images, size_t count, UITextureRegion* out);
+void UploadUIAtlas(UIAtlas* atlas);
+void UnloadUIAtlas(UIAtlas* atlas);
+
+UIScrollList* CreateUIScrollList(
+    UIScene* scene, UIRect rect, float rowHeight, size_t itemCount,
+    UIStyleId style, UIScrollListBindFn bind, void* user);
+void SetUIScrollListRect(UIScrollList* list, UIRect rect);
+void SetUIScrollListItemCount(UIScrollList* list, size_t itemCount);
+void ScrollUIScrollList(UIScrollList* list, float delta);
+void RefreshUIScrollList(UIScrollList* list);
+void DeleteUIScrollList(UIScrollList* list);
+
 #endif
\ No newline at end of file
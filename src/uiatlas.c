@@ -0,0 +1,255 @@
+#include "ui.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "uibackend.h"
+
+#define UIATLAS_PIXEL_SIZE 4
+
+typedef struct UIAtlasOrder
+{
+    size_t index;
+    int height;
+} UIAtlasOrder;
+
+// -----------------------------------------------------------------------------
+
+static void InsertSkylineRun(UIAtlasPage* page, size_t at, UISkylineRun run)
+{
+    if (page->runCount == page->runCapacity)
+    {
+        page->runCapacity = page->runCapacity > 0 ? page->runCapacity * 2 : 16;
+        page->skyline = (UISkylineRun*)realloc(
+            page->skyline, page->runCapacity * sizeof(UISkylineRun));
+    }
+
+    memmove(&page->skyline[at + 1], &page->skyline[at], (page->runCount - at) * sizeof(UISkylineRun));
+    page->skyline[at] = run;
+    ++page->runCount;
+}
+
+static void RemoveSkylineRun(UIAtlasPage* page, size_t at)
+{
+    memmove(&page->skyline[at], &page->skyline[at + 1], (page->runCount - at - 1) * sizeof(UISkylineRun));
+    --page->runCount;
+}
+
+// Finds the height a w x h rect would rest at if its left edge were put
+// at the start of run i, or returns false if it does not fit there.
+static bool FitSkyline(const UIAtlasPage* page, int pageSize, size_t i, int w, int h, int* y)
+{
+    if (page->skyline[i].x + w > pageSize)
+        return false;
+
+    int top = 0;
+    int left = w;
+    for (size_t j = i; left > 0 && j < page->runCount; ++j)
+    {
+        top = max(top, page->skyline[j].y);
+        if (top + h > pageSize)
+            return false;
+        left -= page->skyline[j].width;
+    }
+
+    *y = top;
+    return true;
+}
+
+// Bottom-left skyline packing: the rect goes wherever its bottom edge ends
+// up lowest, preferring narrower runs on ties so gaps fill up first.
+static bool PackSkyline(UIAtlasPage* page, int pageSize, int w, int h, int* outX, int* outY)
+{
+    size_t best = SIZE_MAX;
+    int bestY = 0;
+    int bestWidth = 0;
+    for (size_t i = 0; i < page->runCount; ++i)
+    {
+        int y = 0;
+        if (!FitSkyline(page, pageSize, i, w, h, &y))
+            continue;
+
+        if (best == SIZE_MAX
+            || y < bestY
+            || (y == bestY && page->skyline[i].width < bestWidth))
+        {
+            best = i;
+            bestY = y;
+            bestWidth = page->skyline[i].width;
+        }
+    }
+    if (best == SIZE_MAX)
+        return false;
+
+    int x = page->skyline[best].x;
+    InsertSkylineRun(page, best, (UISkylineRun) { x, bestY + h, w });
+
+    // Cut back the runs now covered by the new one.
+    size_t next = best + 1;
+    while (next < page->runCount && page->skyline[next].x < x + w)
+    {
+        UISkylineRun* run = &page->skyline[next];
+        int covered = x + w - run->x;
+        if (covered < run->width)
+        {
+            run->x += covered;
+            run->width -= covered;
+            break;
+        }
+        RemoveSkylineRun(page, next);
+    }
+
+    for (size_t i = 0; i + 1 < page->runCount;)
+    {
+        if (page->skyline[i].y == page->skyline[i + 1].y)
+        {
+            page->skyline[i].width += page->skyline[i + 1].width;
+            RemoveSkylineRun(page, i + 1);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    *outX = x;
+    *outY = bestY;
+    return true;
+}
+
+static UIAtlasPage* AddUIAtlasPage(UIAtlas* atlas)
+{
+    atlas->pages = (UIAtlasPage*)realloc(
+        atlas->pages, (atlas->pageCount + 1) * sizeof(UIAtlasPage));
+    UIAtlasPage* page = &atlas->pages[atlas->pageCount++];
+    memset(page, 0, sizeof(UIAtlasPage));
+
+    size_t bytes = (size_t)atlas->pageSize * atlas->pageSize * UIATLAS_PIXEL_SIZE;
+    page->image = (Image)
+    {
+        calloc(1, bytes),
+        atlas->pageSize,
+        atlas->pageSize,
+        1,
+        PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+    };
+
+    // The texture exists from the start so regions handed out before the
+    // next upload already refer to it.
+    page->texture = LoadUIBackendTexture(page->image);
+    InsertSkylineRun(page, 0, (UISkylineRun) { 0, 0, atlas->pageSize });
+    return page;
+}
+
+static void CopyUIAtlasPixels(UIAtlasPage* page, Image image, int x, int y)
+{
+    size_t pageStride = (size_t)page->image.width * UIATLAS_PIXEL_SIZE;
+    size_t imageStride = (size_t)image.width * UIATLAS_PIXEL_SIZE;
+    unsigned char* dst = (unsigned char*)page->image.data + y * pageStride + x * UIATLAS_PIXEL_SIZE;
+    const unsigned char* src = (const unsigned char*)image.data;
+    for (int row = 0; row < image.height; ++row)
+        memcpy(dst + row * pageStride, src + row * imageStride, imageStride);
+}
+
+static int CompareUIAtlasOrder(const void* a, const void* b)
+{
+    const UIAtlasOrder* oa = (const UIAtlasOrder*)a;
+    const UIAtlasOrder* ob = (const UIAtlasOrder*)b;
+    if (oa->height != ob->height)
+        return ob->height - oa->height;
+    return (oa->index > ob->index) - (oa->index < ob->index);
+}
+
+// -----------------------------------------------------------------------------
+
+UIAtlas* CreateUIAtlas(int pageSize, int padding)
+{
+    UIAtlas* ret = (UIAtlas*)malloc(sizeof(UIAtlas));
+    memset(ret, 0, sizeof(UIAtlas));
+    ret->pageSize = pageSize;
+    ret->padding = padding;
+    return ret;
+}
+
+// image must be uncompressed RGBA; convert it with ImageFormat first.
+// padding keeps bilinear filtering from bleeding neighbours into it.
+bool AddUIAtlasImage(UIAtlas* atlas, Image image, UITextureRegion* out)
+{
+    int w = image.width + atlas->padding;
+    int h = image.height + atlas->padding;
+    if (image.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+        || image.width <= 0 || image.height <= 0
+        || w > atlas->pageSize || h > atlas->pageSize)
+    {
+        return false;
+    }
+
+    int x = 0;
+    int y = 0;
+    UIAtlasPage* page = NULL;
+    for (size_t i = 0; i < atlas->pageCount && page == NULL; ++i)
+    {
+        if (PackSkyline(&atlas->pages[i], atlas->pageSize, w, h, &x, &y))
+            page = &atlas->pages[i];
+    }
+    if (page == NULL)
+    {
+        page = AddUIAtlasPage(atlas);
+        PackSkyline(page, atlas->pageSize, w, h, &x, &y);
+    }
+
+    CopyUIAtlasPixels(page, image, x, y);
+    page->dirty = true;
+    out->texture = page->texture;
+    out->source = (UIRect) { x, y, x + image.width, y + image.height };
+    return true;
+}
+
+// Packs tallest first, which wastes far less space than arrival order.
+// out[i] receives the region of images[i].
+bool AddUIAtlasImages(UIAtlas* atlas, const Image* images, size_t count, UITextureRegion* out)
+{
+    UIAtlasOrder* order = (UIAtlasOrder*)malloc(count * sizeof(UIAtlasOrder));
+    for (size_t i = 0; i < count; ++i)
+        order[i] = (UIAtlasOrder) { i, images[i].height };
+    qsort(order, count, sizeof(UIAtlasOrder), CompareUIAtlasOrder);
+
+    bool ret = true;
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t index = order[i].index;
+        if (!AddUIAtlasImage(atlas, images[index], &out[index]))
+            ret = false;
+    }
+
+    free(order);
+    return ret;
+}
+
+void UploadUIAtlas(UIAtlas* atlas)
+{
+    for (size_t i = 0; i < atlas->pageCount; ++i)
+    {
+        UIAtlasPage* page = &atlas->pages[i];
+        if (page->dirty)
+        {
+            UpdateUIBackendTexture(page->texture, page->image);
+            page->dirty = false;
+        }
+    }
+}
+
+void UnloadUIAtlas(UIAtlas* atlas)
+{
+    for (size_t i = 0; i < atlas->pageCount; ++i)
+    {
+        UnloadUIBackendTexture(atlas->pages[i].texture);
+        free(atlas->pages[i].image.data);
+        free(atlas->pages[i].skyline);
+    }
+
+    free(atlas->pages);
+    free(atlas);
+}
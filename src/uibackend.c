@@ -0,0 +1,407 @@
+#include "uibackend.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "raylib.h"
+#include "ui.h"
+
+// Every rect is one instance of a unit quad. Its rect, fill color, border
+// color and border width are packed into the per-instance matrix that
+// DrawMeshInstanced feeds to the instanceTransform attribute, one column
+// each, so the whole batch is a single draw call.
+static const char* uiRectVertexShader =
+    "#version 330\n"
+    "in vec3 vertexPosition;\n"
+    "in mat4 instanceTransform;\n"
+    "uniform mat4 mvp;\n"
+    "out vec2 fragLocal;\n"
+    "out vec2 fragSize;\n"
+    "out vec4 fragFill;\n"
+    "out vec4 fragBorder;\n"
+    "out float fragBorderWidth;\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 rect = instanceTransform[0];\n"
+    "    fragFill = instanceTransform[1];\n"
+    "    fragBorder = instanceTransform[2];\n"
+    "    fragBorderWidth = instanceTransform[3].x;\n"
+    "    fragSize = rect.zw;\n"
+    "    fragLocal = vertexPosition.xy * rect.zw;\n"
+    "    gl_Position = mvp * vec4(rect.xy + fragLocal, 0.0, 1.0);\n"
+    "}\n";
+
+static const char* uiRectFragmentShader =
+    "#version 330\n"
+    "in vec2 fragLocal;\n"
+    "in vec2 fragSize;\n"
+    "in vec4 fragFill;\n"
+    "in vec4 fragBorder;\n"
+    "in float fragBorderWidth;\n"
+    "out vec4 finalColor;\n"
+    "void main()\n"
+    "{\n"
+    "    vec2 edge = min(fragLocal, fragSize - fragLocal);\n"
+    "    finalColor = min(edge.x, edge.y) < fragBorderWidth ? fragBorder : fragFill;\n"
+    "}\n";
+
+// Signed distance field text: the atlas stores distance to the glyph edge
+// in alpha, so one atlas stays sharp at every font size and window scale.
+static const char* uiSdfFragmentShader =
+    "#version 330\n"
+    "in vec2 fragTexCoord;\n"
+    "in vec4 fragColor;\n"
+    "uniform sampler2D texture0;\n"
+    "out vec4 finalColor;\n"
+    "void main()\n"
+    "{\n"
+    "    float dist = texture(texture0, fragTexCoord).a - 0.5;\n"
+    "    float width = length(vec2(dFdx(dist), dFdy(dist)));\n"
+    "    float alpha = smoothstep(-width, width, dist);\n"
+    "    finalColor = vec4(fragColor.rgb, fragColor.a * alpha);\n"
+    "}\n";
+
+#define UI_FONT_PATH "res/jupiterc.ttf"
+#define UI_FONT_BASE_SIZE 48
+#define UI_FONT_GLYPH_COUNT 95
+#define UI_FONT_PADDING 4
+
+// Two counter-clockwise triangles covering [0, 1] x [0, 1].
+static const float uiQuadVertices[] =
+{
+    0, 0, 0,   0, 1, 0,   1, 1, 0,
+    0, 0, 0,   1, 1, 0,   1, 0, 0
+};
+
+typedef struct UIRenderer
+{
+    bool ready;
+    Shader shader;
+    Material material;
+    Mesh quad;
+    Matrix* instances;
+    size_t instanceCount;
+    size_t instanceCapacity;
+    RenderTexture2D composite;
+    Font font;
+    Shader sdfShader;
+    bool sdfFont;
+    bool sdfActive;
+} UIRenderer;
+
+static UIRenderer renderer = { 0 };
+
+// -----------------------------------------------------------------------------
+
+static void UseDefaultUIFont()
+{
+    renderer.font = GetFontDefault();
+    renderer.sdfFont = false;
+}
+
+// Bakes the bundled font into an SDF atlas once at startup. Falls back to
+// raylib's default bitmap font if the file is missing or cannot be read.
+static void LoadUIFont()
+{
+    int dataSize = 0;
+    const char* path = TextFormat("%s%s", GetApplicationDirectory(), UI_FONT_PATH);
+    unsigned char* data = FileExists(path) ? LoadFileData(path, &dataSize) : NULL;
+    if (data == NULL)
+    {
+        UseDefaultUIFont();
+        return;
+    }
+
+    Font font = { 0 };
+    font.baseSize = UI_FONT_BASE_SIZE;
+    font.glyphCount = UI_FONT_GLYPH_COUNT;
+    font.glyphs = LoadFontData(data, dataSize, UI_FONT_BASE_SIZE, NULL, UI_FONT_GLYPH_COUNT, FONT_SDF);
+    UnloadFileData(data);
+    if (font.glyphs == NULL)
+    {
+        UseDefaultUIFont();
+        return;
+    }
+
+    Image atlas = GenImageFontAtlas(
+        font.glyphs, &font.recs, UI_FONT_GLYPH_COUNT, UI_FONT_BASE_SIZE, UI_FONT_PADDING, 0);
+    font.texture = LoadTextureFromImage(atlas);
+    UnloadImage(atlas);
+    SetTextureFilter(font.texture, TEXTURE_FILTER_BILINEAR);
+
+    renderer.font = font;
+    renderer.sdfShader = LoadShaderFromMemory(NULL, uiSdfFragmentShader);
+    renderer.sdfFont = true;
+}
+
+// Text keeps the SDF shader bound across consecutive labels so they share
+// one rlgl batch; any other kind of draw switches back first.
+static void BeginSdfText()
+{
+    if (renderer.sdfFont && !renderer.sdfActive)
+    {
+        BeginShaderMode(renderer.sdfShader);
+        renderer.sdfActive = true;
+    }
+}
+
+static void EndSdfText()
+{
+    if (renderer.sdfActive)
+    {
+        EndShaderMode();
+        renderer.sdfActive = false;
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+void InitUIBackend()
+{
+    if (renderer.ready)
+        return;
+
+    renderer.shader = LoadShaderFromMemory(uiRectVertexShader, uiRectFragmentShader);
+    renderer.shader.locs[SHADER_LOC_MATRIX_MODEL] =
+        GetShaderLocationAttrib(renderer.shader, "instanceTransform");
+    renderer.material = LoadMaterialDefault();
+    renderer.material.shader = renderer.shader;
+
+    memset(&renderer.quad, 0, sizeof(Mesh));
+    renderer.quad.vertexCount = 6;
+    renderer.quad.triangleCount = 2;
+    renderer.quad.vertices = (float*)malloc(sizeof(uiQuadVertices));
+    memcpy(renderer.quad.vertices, uiQuadVertices, sizeof(uiQuadVertices));
+    UploadMesh(&renderer.quad, false);
+
+    LoadUIFont();
+    renderer.ready = true;
+}
+
+void CloseUIBackend()
+{
+    if (!renderer.ready)
+        return;
+
+    EndSdfText();
+    if (renderer.sdfFont)
+    {
+        UnloadFont(renderer.font);
+        UnloadShader(renderer.sdfShader);
+    }
+    if (renderer.composite.id > 0)
+        UnloadRenderTexture(renderer.composite);
+    UnloadMesh(renderer.quad);
+    UnloadMaterial(renderer.material);
+    free(renderer.instances);
+    memset(&renderer, 0, sizeof(UIRenderer));
+}
+
+bool IsUIBackendReady()
+{
+    return renderer.ready;
+}
+
+UISize GetUIBackendScreenSize()
+{
+    return (UISize) { (float)GetScreenWidth(), (float)GetScreenHeight() };
+}
+
+// -----------------------------------------------------------------------------
+
+// Same metrics as MeasureTextEx and DrawTextEx, but bounded by length
+// instead of a terminator so line slices need no copy.
+static float GetGlyphAdvance(int index, float scale, float spacing)
+{
+    const Font* font = &renderer.font;
+    float advance = font->glyphs[index].advanceX != 0
+        ? (float)font->glyphs[index].advanceX
+        : font->recs[index].width;
+    return advance * scale + spacing;
+}
+
+UISize MeasureUIBackendText(const char* text, size_t length, float fontSize, float spacing)
+{
+    float scale = fontSize / (float)renderer.font.baseSize;
+    float width = 0;
+    size_t glyphs = 0;
+    for (size_t i = 0; i < length;)
+    {
+        int next = 0;
+        int codepoint = GetCodepointNext(text + i, &next);
+        i += max(next, 1);
+        width += GetGlyphAdvance(GetGlyphIndex(renderer.font, codepoint), scale, spacing);
+        ++glyphs;
+    }
+
+    if (glyphs > 0)
+        width -= spacing;
+    return (UISize) { width, fontSize };
+}
+
+void DrawUIBackendText(const char* text, size_t length, UIPoint pos, float fontSize, float spacing, Color color)
+{
+    BeginSdfText();
+    float scale = fontSize / (float)renderer.font.baseSize;
+    Vector2 loc = UIPointToVector2(pos);
+    for (size_t i = 0; i < length;)
+    {
+        int next = 0;
+        int codepoint = GetCodepointNext(text + i, &next);
+        i += max(next, 1);
+
+        if (codepoint != ' ' && codepoint != '\t')
+            DrawTextCodepoint(renderer.font, codepoint, loc, fontSize, color);
+        loc.x += GetGlyphAdvance(GetGlyphIndex(renderer.font, codepoint), scale, spacing);
+    }
+}
+
+void DrawUIBackendRect(UIRect rect, Color color)
+{
+    EndSdfText();
+    DrawRectangleRec(UIRectToRectangle(rect), color);
+}
+
+void DrawUIBackendBorder(UIRect rect, float width, Color color)
+{
+    EndSdfText();
+    DrawRectangleLinesEx(UIRectToRectangle(rect), width, color);
+}
+
+void DrawUIBackendTexture(Texture2D texture, UIRect source, UIRect dst)
+{
+    EndSdfText();
+    DrawTexturePro(
+        texture,
+        UIRectToRectangle(source),
+        UIRectToRectangle(dst),
+        (Vector2) { 0, 0 },
+        0.0f,
+        WHITE);
+}
+
+Texture2D LoadUIBackendTexture(Image image)
+{
+    Texture2D texture = LoadTextureFromImage(image);
+    SetTextureFilter(texture, TEXTURE_FILTER_BILINEAR);
+    return texture;
+}
+
+void UpdateUIBackendTexture(Texture2D texture, Image image)
+{
+    UpdateTexture(texture, image.data);
+}
+
+void UnloadUIBackendTexture(Texture2D texture)
+{
+    UnloadTexture(texture);
+}
+
+// -----------------------------------------------------------------------------
+
+void PushUIRectInstance(UIRect rect, Color fill, float borderWidth, Color border)
+{
+    if (renderer.instanceCount == renderer.instanceCapacity)
+    {
+        renderer.instanceCapacity = max(renderer.instanceCapacity * 2, (size_t)256);
+        renderer.instances = (Matrix*)realloc(
+            renderer.instances, renderer.instanceCapacity * sizeof(Matrix));
+    }
+
+    Vector4 fillv = ColorNormalize(fill);
+    Vector4 borderv = ColorNormalize(border);
+    UISize size = GetUIRectSize(rect);
+    renderer.instances[renderer.instanceCount++] = (Matrix)
+    {
+        .m0 = rect.left, .m1 = rect.top, .m2 = size.w, .m3 = size.h,
+        .m4 = fillv.x, .m5 = fillv.y, .m6 = fillv.z, .m7 = fillv.w,
+        .m8 = borderv.x, .m9 = borderv.y, .m10 = borderv.z, .m11 = borderv.w,
+        .m12 = borderWidth, .m13 = 0, .m14 = 0, .m15 = 0
+    };
+}
+
+void FlushUIRectInstances()
+{
+    if (renderer.instanceCount == 0)
+        return;
+
+    // Switching shaders makes rlgl submit whatever it has batched so far,
+    // which keeps earlier text and textures below these rects.
+    EndSdfText();
+    BeginShaderMode(renderer.shader);
+    DrawMeshInstanced(
+        renderer.quad,
+        renderer.material,
+        renderer.instances,
+        (int)renderer.instanceCount);
+    EndShaderMode();
+
+    renderer.instanceCount = 0;
+}
+
+// -----------------------------------------------------------------------------
+
+bool ResizeUIComposite(int width, int height)
+{
+    if (renderer.composite.texture.width == width && renderer.composite.texture.height == height)
+        return false;
+
+    if (renderer.composite.id > 0)
+        UnloadRenderTexture(renderer.composite);
+    renderer.composite = LoadRenderTexture(width, height);
+    return true;
+}
+
+void BeginUIComposite()
+{
+    EndSdfText();
+    BeginTextureMode(renderer.composite);
+}
+
+void EndUIComposite()
+{
+    EndSdfText();
+    EndTextureMode();
+}
+
+// The scissor covers every pixel the clip touches, so a scaled clip never
+// cuts into the last row or column it reaches.
+void BeginUIClip(UIRect clip)
+{
+    EndSdfText();
+    float left = floorf(clip.left);
+    float top = floorf(clip.top);
+    BeginScissorMode(
+        (int)left, (int)top, (int)(ceilf(clip.right) - left), (int)(ceilf(clip.bottom) - top));
+}
+
+void EndUIClip()
+{
+    EndSdfText();
+    EndScissorMode();
+}
+
+void ClearUIBackend(Color color)
+{
+    EndSdfText();
+    ClearBackground(color);
+}
+
+void DrawUIComposite()
+{
+    if (!renderer.ready || renderer.composite.id == 0)
+        return;
+
+    EndSdfText();
+
+    // Render textures are stored bottom-up, hence the negative height.
+    Texture2D texture = renderer.composite.texture;
+    DrawTextureRec(
+        texture,
+        (Rectangle) { 0, 0, (float)texture.width, -(float)texture.height },
+        (Vector2) { 0, 0 },
+        WHITE);
+}
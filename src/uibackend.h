@@ -0,0 +1,40 @@
+#ifndef UIBACKEND_H
+#define UIBACKEND_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "ui.h"
+
+// Everything the UI needs from the platform goes through these calls.
+// uibackend.c implements them on raylib; bench/nullbackend.c implements
+// them without a window or GPU so the UI code can be measured headless.
+
+void InitUIBackend();
+void CloseUIBackend();
+bool IsUIBackendReady();
+UISize GetUIBackendScreenSize();
+
+// Text is passed as a span so callers can hand over slices of a larger
+// string; it does not need to be null terminated at length.
+UISize MeasureUIBackendText(const char* text, size_t length, float fontSize, float spacing);
+void DrawUIBackendText(const char* text, size_t length, UIPoint pos, float fontSize, float spacing, Color color);
+void DrawUIBackendRect(UIRect rect, Color color);
+void DrawUIBackendBorder(UIRect rect, float width, Color color);
+void DrawUIBackendTexture(Texture2D texture, UIRect source, UIRect dst);
+Texture2D LoadUIBackendTexture(Image image);
+void UpdateUIBackendTexture(Texture2D texture, Image image);
+void UnloadUIBackendTexture(Texture2D texture);
+
+void PushUIRectInstance(UIRect rect, Color fill, float borderWidth, Color border);
+void FlushUIRectInstances();
+
+bool ResizeUIComposite(int width, int height);
+void BeginUIComposite();
+void EndUIComposite();
+void BeginUIClip(UIRect clip);
+void EndUIClip();
+void ClearUIBackend(Color color);
+void DrawUIComposite();
+
+#endif
@@ -0,0 +1,731 @@
+#include "ui.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile.h"
+
+#define UIDRAW_MAX_GRID_DIM 256
+#define UIDRAW_REBUILD_FACTOR 4
+#define UIDRAW_NO_RANGE (UIGridRange) { 0, 0, -1, -1 }
+#define UIDRAW_RADIX_BITS 8
+#define UIDRAW_RADIX_SIZE (1 << UIDRAW_RADIX_BITS)
+#define UIDRAW_KEY_DIGITS (64 / UIDRAW_RADIX_BITS)
+
+// Key layout, high to low: layer, clip, shader, texture. Clip and texture
+// only group items, so ids that do not fit are folded; submission still
+// uses the real values.
+#define UIDRAW_LAYER_SHIFT 40
+#define UIDRAW_CLIP_SHIFT 24
+#define UIDRAW_SHADER_SHIFT 20
+#define UIDRAW_CLIP_MASK 0xFFFFu
+#define UIDRAW_TEXTURE_MASK 0xFFFFFu
+#define UIDRAW_BASE_KEY_MASK ((1ull << UIDRAW_LAYER_SHIFT) - 1)
+
+// The checks build with a lower limit, to reach the fallback for layers
+// that outgrow the key with a small scene.
+#ifndef UIDRAW_MAX_LAYER
+#define UIDRAW_MAX_LAYER ((1u << (64 - UIDRAW_LAYER_SHIFT)) / UI_DRAW_SHADER_COUNT - 1)
+#endif
+
+// An item as seen from a grid cell. Copying the bounds and layer into
+// the cell keeps the overlap scan on contiguous memory.
+typedef struct UIDrawGridEntry
+{
+    UIRect bounds;
+    uint32_t layer;
+} UIDrawGridEntry;
+
+// Uniform grid over the item bounds. Each cell lists the items that touch
+// it in ascending order, packed by cell into one array; topLayers holds
+// the highest layer listed in each cell so far.
+typedef struct UIDrawGrid
+{
+    int32_t cols;
+    uint32_t* cellStarts;
+    uint32_t* cellEnds;
+    uint32_t* topLayers;
+    UIDrawGridEntry* entries;
+} UIDrawGrid;
+
+// -----------------------------------------------------------------------------
+
+// Clamped in float, on both sides, so NaN or huge coordinates still land
+// in the grid.
+static int32_t GetUIDrawGridCell(float offset, float inv, int32_t count)
+{
+    return (int32_t)min(max(offset * inv, 0.0f), (float)(count - 1));
+}
+
+// Sizes the list's grid to the bounds of its slots. Rects outside the area
+// clamp to its edge cells, so slots that move out later are still found,
+// just less quickly.
+static void ShapeUIDrawGrid(UIDrawList* list, const UIRect* bounds, size_t count)
+{
+    UIRect area = count > 0 ? bounds[0] : (UIRect) { 0, 0, 1, 1 };
+    float extent = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        UISize size = GetUIRectSize(bounds[i]);
+        area = UnionUIRect(area, bounds[i]);
+        extent += size.w + size.h;
+    }
+
+    // Cells about half the size of an average rect keep both the cells per
+    // rect and the rects per cell small.
+    float n = (float)max(count, (size_t)1);
+    UISize size = GetUIRectSize(area);
+    float cellSize = sqrtf(max(size.w * size.h, 1.0f) / n);
+    cellSize = max(cellSize, extent / (4.0f * n));
+    cellSize = max(cellSize, max(size.w, size.h) / UIDRAW_MAX_GRID_DIM);
+    cellSize = max(cellSize, 1.0f);
+    list->cols = min(max((int32_t)ceilf(size.w / cellSize), 1), UIDRAW_MAX_GRID_DIM);
+    list->rows = min(max((int32_t)ceilf(size.h / cellSize), 1), UIDRAW_MAX_GRID_DIM);
+    list->origin = (UIPoint) { area.left, area.top };
+    list->cellInv = 1.0f / cellSize;
+}
+
+static UIGridRange GetUIDrawGridRange(const UIDrawList* list, UIRect rect)
+{
+    return (UIGridRange)
+    {
+        GetUIDrawGridCell(rect.left - list->origin.x, list->cellInv, list->cols),
+        GetUIDrawGridCell(rect.top - list->origin.y, list->cellInv, list->rows),
+        GetUIDrawGridCell(rect.right - list->origin.x, list->cellInv, list->cols),
+        GetUIDrawGridCell(rect.bottom - list->origin.y, list->cellInv, list->rows)
+    };
+}
+
+// Counts the entries of each cell and lays the cells out back to back;
+// the cells start out empty and are filled as rects get their layers.
+static void BuildUIDrawGrid(
+    UIDrawGrid* grid, const UIGridRange* ranges, size_t count, int32_t cols, int32_t rows, Arena* arena)
+{
+    size_t cellCount = (size_t)(cols * rows);
+    grid->cols = cols;
+    grid->cellStarts = (uint32_t*)ArenaAlloc(arena, (cellCount + 1) * sizeof(uint32_t));
+    grid->cellEnds = (uint32_t*)ArenaAlloc(arena, cellCount * sizeof(uint32_t));
+    grid->topLayers = (uint32_t*)ArenaAlloc(arena, cellCount * sizeof(uint32_t));
+    memset(grid->cellStarts, 0, (cellCount + 1) * sizeof(uint32_t));
+    memset(grid->topLayers, 0, cellCount * sizeof(uint32_t));
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        UIGridRange range = ranges[i];
+        for (int32_t row = range.row0; row <= range.row1; ++row)
+            for (int32_t col = range.col0; col <= range.col1; ++col)
+                ++grid->cellStarts[row * cols + col + 1];
+    }
+
+    for (size_t c = 0; c < cellCount; ++c)
+        grid->cellStarts[c + 1] += grid->cellStarts[c];
+    memcpy(grid->cellEnds, grid->cellStarts, cellCount * sizeof(uint32_t));
+    grid->entries = (UIDrawGridEntry*)ArenaAlloc(
+        arena, max(grid->cellStarts[cellCount], 1u) * sizeof(UIDrawGridEntry));
+}
+
+// Gives each rect a layer one above the highest earlier rect it
+// overlaps. Rects are added to the grid as they are visited, so the cells
+// only ever hold earlier rects, and a cell whose top layer is below the
+// layer found so far cannot raise it.
+static void AssignUIDrawLayers(
+    const UIRect* bounds, const UIGridRange* ranges, size_t count, int32_t cols, int32_t rows,
+    uint32_t* layers, Arena* arena)
+{
+    UIDrawGrid grid;
+    BuildUIDrawGrid(&grid, ranges, count, cols, rows, arena);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        UIRect rect = bounds[i];
+        UIGridRange range = ranges[i];
+        uint32_t layer = 0;
+        for (int32_t row = range.row0; row <= range.row1; ++row)
+        {
+            for (int32_t col = range.col0; col <= range.col1; ++col)
+            {
+                size_t cell = (size_t)(row * cols + col);
+                if (grid.cellEnds[cell] == grid.cellStarts[cell] || grid.topLayers[cell] < layer)
+                    continue;
+
+                // Branch free, as whether neighbours overlap is a coin toss.
+                for (uint32_t k = grid.cellStarts[cell]; k < grid.cellEnds[cell]; ++k)
+                {
+                    const UIDrawGridEntry* other = &grid.entries[k];
+                    uint32_t overlaps =
+                          (rect.left < other->bounds.right) & (other->bounds.left < rect.right)
+                        & (rect.top < other->bounds.bottom) & (other->bounds.top < rect.bottom);
+                    uint32_t above = (other->layer + 1) & (0u - overlaps);
+                    layer = above > layer ? above : layer;
+                }
+            }
+        }
+
+        layers[i] = layer;
+        for (int32_t row = range.row0; row <= range.row1; ++row)
+        {
+            for (int32_t col = range.col0; col <= range.col1; ++col)
+            {
+                size_t cell = (size_t)(row * cols + col);
+                grid.entries[grid.cellEnds[cell]++] = (UIDrawGridEntry) { rect, layer };
+                grid.topLayers[cell] = max(grid.topLayers[cell], layer);
+            }
+        }
+    }
+}
+
+// Stable LSD radix sort on the key, a byte per pass. Passes over bytes
+// that every key shares are skipped, which is most of them.
+static void RadixSortUIDrawItems(UIDrawItem* items, size_t count, Arena* arena)
+{
+    size_t histograms[UIDRAW_KEY_DIGITS][UIDRAW_RADIX_SIZE] = { 0 };
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint64_t key = items[i].key;
+        for (int d = 0; d < UIDRAW_KEY_DIGITS; ++d)
+            ++histograms[d][(key >> (d * UIDRAW_RADIX_BITS)) & (UIDRAW_RADIX_SIZE - 1)];
+    }
+
+    UIDrawItem* src = items;
+    UIDrawItem* dst = (UIDrawItem*)ArenaAlloc(arena, count * sizeof(UIDrawItem));
+    for (int d = 0; d < UIDRAW_KEY_DIGITS; ++d)
+    {
+        int shift = d * UIDRAW_RADIX_BITS;
+        size_t* histogram = histograms[d];
+        if (histogram[(src[0].key >> shift) & (UIDRAW_RADIX_SIZE - 1)] == count)
+            continue;
+
+        size_t offset = 0;
+        for (int b = 0; b < UIDRAW_RADIX_SIZE; ++b)
+        {
+            size_t n = histogram[b];
+            histogram[b] = offset;
+            offset += n;
+        }
+
+        for (size_t i = 0; i < count; ++i)
+            dst[histogram[(src[i].key >> shift) & (UIDRAW_RADIX_SIZE - 1)]++] = src[i];
+
+        UIDrawItem* swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != items)
+        memcpy(items, src, count * sizeof(UIDrawItem));
+}
+
+static void ReserveUIDrawItems(UIDrawList* list, size_t count)
+{
+    if (count <= list->capacity)
+        return;
+
+    list->capacity = max(max(list->capacity * 2, (size_t)64), count);
+    list->items = (UIDrawItem*)realloc(list->items, list->capacity * sizeof(UIDrawItem));
+}
+
+static void ReserveUIDrawSlots(UIDrawList* list, size_t count)
+{
+    if (count <= list->slotCapacity)
+        return;
+
+    list->slotCapacity = max(max(list->slotCapacity * 2, (size_t)64), count);
+    list->slots = (UIDrawSlot*)realloc(list->slots, list->slotCapacity * sizeof(UIDrawSlot));
+}
+
+static uint64_t GetUIDrawItemKey(uint64_t key, uint32_t layer, UIDrawShader shader)
+{
+    uint64_t sublayer = (uint64_t)layer * UI_DRAW_SHADER_COUNT + shader;
+    return (key & UIDRAW_BASE_KEY_MASK) | (sublayer << UIDRAW_LAYER_SHIFT);
+}
+
+// Empties the cells of a grid that was just shaped, keeping their
+// buffers if it has as many cells as before.
+static void ResetUIDrawCells(UIDrawList* list, int32_t oldCount)
+{
+    int32_t count = list->cols * list->rows;
+    if (count == oldCount)
+    {
+        for (int32_t c = 0; c < count; ++c)
+            list->cells[c].count = 0;
+        return;
+    }
+
+    for (int32_t c = 0; c < oldCount; ++c)
+        free(list->cells[c].slots);
+    list->cells = (UIDrawCell*)realloc(list->cells, (size_t)count * sizeof(UIDrawCell));
+    memset(list->cells, 0, (size_t)count * sizeof(UIDrawCell));
+}
+
+static void AddUIDrawSlotToCells(UIDrawList* list, uint32_t slot)
+{
+    UIGridRange range = list->slots[slot].range;
+    for (int32_t row = range.row0; row <= range.row1; ++row)
+    {
+        for (int32_t col = range.col0; col <= range.col1; ++col)
+        {
+            UIDrawCell* cell = &list->cells[row * list->cols + col];
+            if (cell->count == cell->capacity)
+            {
+                cell->capacity = cell->capacity > 0 ? cell->capacity * 2 : 4;
+                cell->slots = (uint32_t*)realloc(cell->slots, cell->capacity * sizeof(uint32_t));
+            }
+            cell->slots[cell->count++] = slot;
+        }
+    }
+}
+
+static void RemoveUIDrawSlotFromCells(UIDrawList* list, uint32_t slot)
+{
+    UIGridRange range = list->slots[slot].range;
+    for (int32_t row = range.row0; row <= range.row1; ++row)
+    {
+        for (int32_t col = range.col0; col <= range.col1; ++col)
+        {
+            UIDrawCell* cell = &list->cells[row * list->cols + col];
+            for (uint32_t k = 0; k < cell->count; ++k)
+            {
+                if (cell->slots[k] == slot)
+                {
+                    cell->slots[k] = cell->slots[--cell->count];
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// Sorted items are ordered by key and then slot, which is the order the
+// stable sort leaves items pushed in slot order in. Returns where an item
+// with key and slot is, or would go.
+static size_t FindUIDrawItem(const UIDrawList* list, uint64_t key, uint32_t slot)
+{
+    size_t lo = 0;
+    size_t hi = list->count;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        const UIDrawItem* item = &list->items[mid];
+        if (item->key < key || (item->key == key && item->slot < slot))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static void InsertUIDrawItem(UIDrawList* list, UIDrawItem item)
+{
+    ReserveUIDrawItems(list, list->count + 1);
+    size_t at = FindUIDrawItem(list, item.key, item.slot);
+    memmove(&list->items[at + 1], &list->items[at], (list->count - at) * sizeof(UIDrawItem));
+    list->items[at] = item;
+    ++list->count;
+}
+
+static void RemoveUIDrawItem(UIDrawList* list, size_t at)
+{
+    memmove(&list->items[at], &list->items[at + 1], (list->count - at - 1) * sizeof(UIDrawItem));
+    --list->count;
+}
+
+// Replaces the item at from with item, shifting only the items between
+// its old and new places.
+static void MoveUIDrawItem(UIDrawList* list, size_t from, UIDrawItem item)
+{
+    size_t to = FindUIDrawItem(list, item.key, item.slot);
+    if (to > from)
+    {
+        --to;
+        memmove(&list->items[from], &list->items[from + 1], (to - from) * sizeof(UIDrawItem));
+    }
+    else
+    {
+        memmove(&list->items[to + 1], &list->items[to], (from - to) * sizeof(UIDrawItem));
+    }
+    list->items[to] = item;
+}
+
+// Re-keys the items of slot to its current layer.
+static void MoveUIDrawSlotItems(UIDrawList* list, uint32_t slot)
+{
+    UIDrawSlot* record = &list->slots[slot];
+    for (int shader = 0; shader < UI_DRAW_SHADER_COUNT; ++shader)
+    {
+        if (!(record->shaders & (1u << shader)))
+            continue;
+
+        size_t at = FindUIDrawItem(list, record->keys[shader], slot);
+        UIDrawItem item = list->items[at];
+        item.key = GetUIDrawItemKey(item.key, record->layer, (UIDrawShader)shader);
+        record->keys[shader] = item.key;
+        MoveUIDrawItem(list, at, item);
+    }
+}
+
+// One above the highest earlier slot that slot overlaps.
+static uint32_t FindUIDrawLayer(const UIDrawList* list, uint32_t slot)
+{
+    const UIDrawSlot* record = &list->slots[slot];
+    UIGridRange range = record->range;
+    uint32_t layer = 0;
+    for (int32_t row = range.row0; row <= range.row1; ++row)
+    {
+        for (int32_t col = range.col0; col <= range.col1; ++col)
+        {
+            const UIDrawCell* cell = &list->cells[row * list->cols + col];
+            for (uint32_t k = 0; k < cell->count; ++k)
+            {
+                const UIDrawSlot* other = &list->slots[cell->slots[k]];
+                if (cell->slots[k] < slot && OverlapsUIRect(other->bounds, record->bounds))
+                    layer = max(layer, other->layer + 1);
+            }
+        }
+    }
+    return layer;
+}
+
+static int CompareUIDrawIndices(const void* a, const void* b)
+{
+    size_t ia = *(const size_t*)a;
+    size_t ib = *(const size_t*)b;
+    return (ia > ib) - (ia < ib);
+}
+
+// Min-heap of slots still to be moved, so they are taken in slot order.
+static void PushUIDrawHeap(uint32_t** heap, size_t* count, size_t* capacity, uint32_t slot)
+{
+    if (*count == *capacity)
+    {
+        *capacity = *capacity > 0 ? *capacity * 2 : 16;
+        *heap = (uint32_t*)realloc(*heap, *capacity * sizeof(uint32_t));
+    }
+
+    size_t i = (*count)++;
+    for (; i > 0 && (*heap)[(i - 1) / 2] > slot; i = (i - 1) / 2)
+        (*heap)[i] = (*heap)[(i - 1) / 2];
+    (*heap)[i] = slot;
+}
+
+static uint32_t PopUIDrawHeap(uint32_t* heap, size_t* count)
+{
+    uint32_t top = heap[0];
+    uint32_t last = heap[--(*count)];
+    size_t i = 0;
+    for (;;)
+    {
+        size_t child = 2 * i + 1;
+        if (child >= *count)
+            break;
+        if (child + 1 < *count && heap[child + 1] < heap[child])
+            ++child;
+        if (heap[child] >= last)
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (*count > 0)
+        heap[i] = last;
+    return top;
+}
+
+// Raises the later slots that overlap slot without being above it, and
+// in turn those overlapping them. A slot is only raised by earlier ones,
+// so taking raised slots in slot order moves each once, at its final
+// layer. Returns false if a layer no longer fits the key.
+static bool RaiseUIDrawLayers(UIDrawList* list, uint32_t slot)
+{
+    uint32_t* heap = NULL;
+    size_t heapCount = 0;
+    size_t heapCapacity = 0;
+    bool fits = true;
+    for (;;)
+    {
+        const UIDrawSlot* record = &list->slots[slot];
+        UIGridRange range = record->range;
+        for (int32_t row = range.row0; row <= range.row1; ++row)
+        {
+            for (int32_t col = range.col0; col <= range.col1; ++col)
+            {
+                const UIDrawCell* cell = &list->cells[row * list->cols + col];
+                for (uint32_t k = 0; k < cell->count; ++k)
+                {
+                    UIDrawSlot* other = &list->slots[cell->slots[k]];
+                    if (cell->slots[k] > slot && other->layer <= record->layer
+                        && OverlapsUIRect(other->bounds, record->bounds))
+                    {
+                        other->layer = record->layer + 1;
+                        PushUIDrawHeap(&heap, &heapCount, &heapCapacity, cell->slots[k]);
+                    }
+                }
+            }
+        }
+
+        if (heapCount == 0)
+            break;
+
+        uint32_t next = PopUIDrawHeap(heap, &heapCount);
+        while (heapCount > 0 && heap[0] == next)
+            PopUIDrawHeap(heap, &heapCount);
+        slot = next;
+        if (list->slots[slot].layer > UIDRAW_MAX_LAYER)
+        {
+            fits = false;
+            break;
+        }
+        MoveUIDrawSlotItems(list, slot);
+    }
+
+    free(heap);
+    return fits;
+}
+
+// -----------------------------------------------------------------------------
+
+void ResetUIDrawList(UIDrawList* list)
+{
+    list->count = 0;
+    list->valid = false;
+}
+
+// Layers are not known until the list is sorted, so the key starts out
+// without one.
+void PushUIDrawItem(
+    UIDrawList* list, uint32_t slot, UIDrawShader shader, uint32_t texture, uint32_t clip, UIRect bounds)
+{
+    ReserveUIDrawItems(list, list->count + 1);
+
+    // No clip groups first, as clip + 1 wraps to 0.
+    uint64_t key =
+          ((uint64_t)((clip + 1u) & UIDRAW_CLIP_MASK) << UIDRAW_CLIP_SHIFT)
+        | ((uint64_t)shader << UIDRAW_SHADER_SHIFT)
+        | (uint64_t)(texture & UIDRAW_TEXTURE_MASK);
+    list->items[list->count++] = (UIDrawItem) { bounds, key, slot, shader };
+}
+
+// Slots are layered as a whole, on the union of their items, which needs
+// far fewer overlap tests than layering every item. slotCount covers the
+// slots that pushed nothing too, so later edits can find them. Scratch
+// space comes from the UI frame arena.
+void SortUIDrawList(UIDrawList* list, size_t slotCount)
+{
+    PROFILE_ZONE("SortUIDrawList");
+    list->valid = true;
+    list->rebuildSlotCount = max(slotCount, (size_t)1) * UIDRAW_REBUILD_FACTOR;
+    ReserveUIDrawSlots(list, slotCount);
+    list->slotCount = slotCount;
+    for (size_t i = 0; i < slotCount; ++i)
+        list->slots[i] = (UIDrawSlot) { UIRECT_ZERO, UIDRAW_NO_RANGE, 0, 0, { 0 } };
+
+    Arena* arena = GetUIFrameArena();
+    UIRect* slotBounds = (UIRect*)ArenaAlloc(arena, list->count * sizeof(UIRect));
+    uint32_t* slotIds = (uint32_t*)ArenaAlloc(arena, list->count * sizeof(uint32_t));
+    size_t used = 0;
+    for (size_t i = 0; i < list->count; ++i)
+    {
+        if (i > 0 && list->items[i].slot == list->items[i - 1].slot)
+        {
+            slotBounds[used - 1] = UnionUIRect(slotBounds[used - 1], list->items[i].bounds);
+            continue;
+        }
+        slotBounds[used] = list->items[i].bounds;
+        slotIds[used++] = list->items[i].slot;
+    }
+
+    int32_t oldCellCount = list->cols * list->rows;
+    ShapeUIDrawGrid(list, slotBounds, used);
+    ResetUIDrawCells(list, oldCellCount);
+    UIGridRange* ranges = (UIGridRange*)ArenaAlloc(arena, used * sizeof(UIGridRange));
+    for (size_t i = 0; i < used; ++i)
+    {
+        ranges[i] = GetUIDrawGridRange(list, slotBounds[i]);
+        UIDrawSlot* slot = &list->slots[slotIds[i]];
+        slot->bounds = slotBounds[i];
+        slot->range = ranges[i];
+        AddUIDrawSlotToCells(list, slotIds[i]);
+    }
+
+    uint32_t* layers = (uint32_t*)ArenaAlloc(arena, used * sizeof(uint32_t));
+    AssignUIDrawLayers(slotBounds, ranges, used, list->cols, list->rows, layers, arena);
+
+    size_t next = 0;
+    for (size_t i = 0; i < list->count; ++i)
+    {
+        if (i > 0 && list->items[i].slot != list->items[i - 1].slot)
+            ++next;
+
+        UIDrawItem* item = &list->items[i];
+        UIDrawSlot* slot = &list->slots[item->slot];
+        slot->layer = layers[next];
+        item->key = GetUIDrawItemKey(item->key, slot->layer, item->shader);
+        slot->keys[item->shader] = item->key;
+        slot->shaders |= 1u << item->shader;
+    }
+
+    if (list->count > 1)
+        RadixSortUIDrawItems(list->items, list->count, arena);
+}
+
+// Takes the items pushed since the list held sorted items as the new
+// items of slot, which may be one past the last. The slot is layered
+// against the earlier slots it now overlaps and its items are moved to
+// where that layer sorts them; later slots it overlaps are raised above
+// it as needed, in slot order so each moves once. Does nothing to a list
+// that is not sorted, and unsorts one whose slots or layers have
+// outgrown its grid or keys.
+void ReplaceUIDrawSlot(UIDrawList* list, uint32_t slot, size_t sorted)
+{
+    UIDrawItem pushed[UI_DRAW_SHADER_COUNT];
+    size_t pushedCount = min(list->count - sorted, (size_t)UI_DRAW_SHADER_COUNT);
+    memcpy(pushed, &list->items[sorted], pushedCount * sizeof(UIDrawItem));
+    list->count = sorted;
+    if (!list->valid)
+        return;
+
+    if (slot > list->slotCount || slot >= list->rebuildSlotCount)
+    {
+        list->valid = false;
+        return;
+    }
+
+    if (slot == list->slotCount)
+    {
+        ReserveUIDrawSlots(list, slot + 1);
+        list->slots[list->slotCount++] = (UIDrawSlot) { UIRECT_ZERO, UIDRAW_NO_RANGE, 0, 0, { 0 } };
+    }
+    RemoveUIDrawSlotFromCells(list, slot);
+
+    UIDrawSlot* record = &list->slots[slot];
+    record->bounds = UIRECT_ZERO;
+    record->range = UIDRAW_NO_RANGE;
+    record->layer = 0;
+    if (pushedCount > 0)
+    {
+        record->bounds = pushed[0].bounds;
+        for (size_t i = 1; i < pushedCount; ++i)
+            record->bounds = UnionUIRect(record->bounds, pushed[i].bounds);
+        record->range = GetUIDrawGridRange(list, record->bounds);
+        record->layer = FindUIDrawLayer(list, slot);
+        AddUIDrawSlotToCells(list, slot);
+    }
+
+    // Items the slot keeps move from their old keys; the others are
+    // dropped or added.
+    uint32_t shaders = 0;
+    for (size_t i = 0; i < pushedCount; ++i)
+    {
+        UIDrawItem item = pushed[i];
+        item.key = GetUIDrawItemKey(item.key, record->layer, item.shader);
+        if (record->shaders & (1u << item.shader))
+            MoveUIDrawItem(list, FindUIDrawItem(list, record->keys[item.shader], slot), item);
+        else
+            InsertUIDrawItem(list, item);
+        record->keys[item.shader] = item.key;
+        shaders |= 1u << item.shader;
+    }
+    for (int shader = 0; shader < UI_DRAW_SHADER_COUNT; ++shader)
+    {
+        if ((record->shaders & ~shaders) & (1u << shader))
+            RemoveUIDrawItem(list, FindUIDrawItem(list, record->keys[shader], slot));
+    }
+    record->shaders = shaders;
+
+    if (record->layer > UIDRAW_MAX_LAYER || !RaiseUIDrawLayers(list, slot))
+        list->valid = false;
+}
+
+// Dropping a slot leaves every other one above the slots it overlaps, so
+// nothing is re-layered; later slots just move down one.
+void RemoveUIDrawSlot(UIDrawList* list, uint32_t slot)
+{
+    if (!list->valid || slot >= list->slotCount)
+        return;
+
+    UIDrawSlot* record = &list->slots[slot];
+    for (int shader = 0; shader < UI_DRAW_SHADER_COUNT; ++shader)
+    {
+        if (record->shaders & (1u << shader))
+            RemoveUIDrawItem(list, FindUIDrawItem(list, record->keys[shader], slot));
+    }
+    RemoveUIDrawSlotFromCells(list, slot);
+
+    memmove(record, record + 1, (list->slotCount - slot - 1) * sizeof(UIDrawSlot));
+    --list->slotCount;
+    for (size_t i = 0; i < list->count; ++i)
+        list->items[i].slot -= list->items[i].slot > slot;
+
+    UIDrawCell* cells = list->cells;
+    for (int32_t c = 0; c < list->cols * list->rows; ++c)
+        for (uint32_t k = 0; k < cells[c].count; ++k)
+            cells[c].slots[k] -= cells[c].slots[k] > slot;
+}
+
+// The items of a sorted list that overlap rect, as indices in list order,
+// from the UI frame arena. The slots near rect are found through the
+// cells, each from the first cell it shares with rect; a rect that
+// reaches most of the list is scanned for instead.
+const size_t* GetUIDrawItemsInRect(const UIDrawList* list, UIRect rect, size_t* count)
+{
+    UIGridRange region = GetUIDrawGridRange(list, rect);
+    size_t bound = 0;
+    for (int32_t row = region.row0; row <= region.row1; ++row)
+        for (int32_t col = region.col0; col <= region.col1; ++col)
+            bound += list->cells[row * list->cols + col].count;
+    bound = min(bound * UI_DRAW_SHADER_COUNT, list->count);
+
+    size_t* indices = (size_t*)ArenaAlloc(GetUIFrameArena(), max(bound, (size_t)1) * sizeof(size_t));
+    *count = 0;
+    if (bound == list->count)
+    {
+        for (size_t i = 0; i < list->count; ++i)
+        {
+            if (OverlapsUIRect(list->items[i].bounds, rect))
+                indices[(*count)++] = i;
+        }
+        return indices;
+    }
+
+    for (int32_t row = region.row0; row <= region.row1; ++row)
+    {
+        for (int32_t col = region.col0; col <= region.col1; ++col)
+        {
+            const UIDrawCell* cell = &list->cells[row * list->cols + col];
+            for (uint32_t k = 0; k < cell->count; ++k)
+            {
+                uint32_t slot = cell->slots[k];
+                const UIDrawSlot* record = &list->slots[slot];
+                if (col != max(record->range.col0, region.col0) || row != max(record->range.row0, region.row0)
+                    || !OverlapsUIRect(record->bounds, rect))
+                {
+                    continue;
+                }
+
+                for (int shader = 0; shader < UI_DRAW_SHADER_COUNT; ++shader)
+                {
+                    if (!(record->shaders & (1u << shader)))
+                        continue;
+
+                    size_t at = FindUIDrawItem(list, record->keys[shader], slot);
+                    if (OverlapsUIRect(list->items[at].bounds, rect))
+                        indices[(*count)++] = at;
+                }
+            }
+        }
+    }
+    qsort(indices, *count, sizeof(size_t), CompareUIDrawIndices);
+    return indices;
+}
+
+void FreeUIDrawList(UIDrawList* list)
+{
+    for (int32_t c = 0; c < list->cols * list->rows; ++c)
+        free(list->cells[c].slots);
+    free(list->cells);
+    free(list->slots);
+    free(list->items);
+    memset(list, 0, sizeof(UIDrawList));
+}
@@ -0,0 +1,231 @@
+#include "ui.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UIGRID_MIN_CELL_SIZE 16.0f
+#define UIGRID_MAX_DIM 256
+#define UIGRID_REBUILD_FACTOR 4
+
+// -----------------------------------------------------------------------------
+
+static UIRect GetSlotRect(const UIScene* scene, size_t slot)
+{
+    return scene->designRects[slot];
+}
+
+static int32_t GetGridCol(const UIGrid* grid, float x)
+{
+    float col = floorf((x - grid->originX) / grid->cellSize);
+    return (int32_t)min(max(col, 0.0f), (float)(grid->cols - 1));
+}
+
+static int32_t GetGridRow(const UIGrid* grid, float y)
+{
+    float row = floorf((y - grid->originY) / grid->cellSize);
+    return (int32_t)min(max(row, 0.0f), (float)(grid->rows - 1));
+}
+
+// Coordinates outside the grid clamp to the edge cells. Clamping is
+// monotonic, so a point inside a rect always lands in one of its cells.
+static UIGridRange GetGridRange(const UIGrid* grid, UIRect rect)
+{
+    if (rect.right < rect.left || rect.bottom < rect.top)
+        return (UIGridRange) { 0, 0, -1, -1 };
+
+    return (UIGridRange)
+    {
+        GetGridCol(grid, rect.left),
+        GetGridRow(grid, rect.top),
+        GetGridCol(grid, rect.right),
+        GetGridRow(grid, rect.bottom)
+    };
+}
+
+static bool EqualsUIGridRange(UIGridRange a, UIGridRange b)
+{
+    return
+           a.col0 == b.col0 && a.row0 == b.row0
+        && a.col1 == b.col1 && a.row1 == b.row1;
+}
+
+static void AddToGridCell(UIGridCell* cell, UISceneId id)
+{
+    if (cell->count == cell->capacity)
+    {
+        cell->capacity = cell->capacity > 0 ? cell->capacity * 2 : 4;
+        cell->ids = (UISceneId*)realloc(cell->ids, cell->capacity * sizeof(UISceneId));
+    }
+    cell->ids[cell->count++] = id;
+}
+
+static void RemoveFromGridCell(UIGridCell* cell, UISceneId id)
+{
+    for (uint32_t i = 0; i < cell->count; ++i)
+    {
+        if (cell->ids[i] == id)
+        {
+            cell->ids[i] = cell->ids[--cell->count];
+            return;
+        }
+    }
+}
+
+static void AddToGridRange(UIGrid* grid, UIGridRange range, UISceneId id)
+{
+    for (int32_t row = range.row0; row <= range.row1; ++row)
+        for (int32_t col = range.col0; col <= range.col1; ++col)
+            AddToGridCell(&grid->cells[row * grid->cols + col], id);
+}
+
+static void RemoveFromGridRange(UIGrid* grid, UIGridRange range, UISceneId id)
+{
+    for (int32_t row = range.row0; row <= range.row1; ++row)
+        for (int32_t col = range.col0; col <= range.col1; ++col)
+            RemoveFromGridCell(&grid->cells[row * grid->cols + col], id);
+}
+
+static void ReserveGridRanges(UIGrid* grid, size_t idCapacity)
+{
+    if (idCapacity <= grid->rangeCapacity)
+        return;
+
+    grid->ranges = (UIGridRange*)realloc(grid->ranges, idCapacity * sizeof(UIGridRange));
+    for (size_t i = grid->rangeCapacity; i < idCapacity; ++i)
+        grid->ranges[i] = (UIGridRange) { 0, 0, -1, -1 };
+    grid->rangeCapacity = idCapacity;
+}
+
+// -----------------------------------------------------------------------------
+
+void RebuildUIGrid(UIScene* scene)
+{
+    UIGrid* grid = &scene->grid;
+    UIRect bounds = { 0, 0, 1, 1 };
+    if (scene->size > 0)
+    {
+        bounds = GetSlotRect(scene, 0);
+        for (size_t i = 1; i < scene->size; ++i)
+        {
+            UIRect rect = GetSlotRect(scene, i);
+            bounds.left = min(bounds.left, rect.left);
+            bounds.top = min(bounds.top, rect.top);
+            bounds.right = max(bounds.right, rect.right);
+            bounds.bottom = max(bounds.bottom, rect.bottom);
+        }
+    }
+
+    // Aim for about one element per cell, within sane cell size limits.
+    UISize size = GetUIRectSize(bounds);
+    size.w = max(size.w, 1.0f);
+    size.h = max(size.h, 1.0f);
+    float cellSize = sqrtf(size.w * size.h / (float)max(scene->size, (size_t)1));
+    cellSize = max(cellSize, UIGRID_MIN_CELL_SIZE);
+    cellSize = max(cellSize, max(size.w, size.h) / UIGRID_MAX_DIM);
+
+    int32_t cols = (int32_t)ceilf(size.w / cellSize);
+    int32_t rows = (int32_t)ceilf(size.h / cellSize);
+    cols = min(max(cols, 1), UIGRID_MAX_DIM);
+    rows = min(max(rows, 1), UIGRID_MAX_DIM);
+
+    for (int32_t i = 0; i < grid->cols * grid->rows; ++i)
+        free(grid->cells[i].ids);
+    grid->cells = (UIGridCell*)realloc(grid->cells, (size_t)(cols * rows) * sizeof(UIGridCell));
+    memset(grid->cells, 0, (size_t)(cols * rows) * sizeof(UIGridCell));
+
+    grid->originX = bounds.left;
+    grid->originY = bounds.top;
+    grid->cellSize = cellSize;
+    grid->cols = cols;
+    grid->rows = rows;
+    grid->rebuildSize = max(scene->size, (size_t)1) * UIGRID_REBUILD_FACTOR;
+
+    ReserveGridRanges(grid, scene->idCapacity);
+    for (size_t i = 0; i < scene->size; ++i)
+    {
+        UISceneId id = scene->nodes[i].id;
+        grid->ranges[id] = GetGridRange(grid, GetSlotRect(scene, i));
+        AddToGridRange(grid, grid->ranges[id], id);
+    }
+}
+
+void UpdateUIGridElement(UIScene* scene, UISceneId id)
+{
+    UIGrid* grid = &scene->grid;
+    if (grid->cells == NULL || scene->size > grid->rebuildSize)
+    {
+        RebuildUIGrid(scene);
+        return;
+    }
+
+    ReserveGridRanges(grid, scene->idCapacity);
+    UIGridRange range = GetGridRange(grid, GetSlotRect(scene, scene->idSlots[id]));
+    if (EqualsUIGridRange(range, grid->ranges[id]))
+        return;
+
+    RemoveFromGridRange(grid, grid->ranges[id], id);
+    AddToGridRange(grid, range, id);
+    grid->ranges[id] = range;
+}
+
+void RemoveFromUIGrid(UIScene* scene, UISceneId id)
+{
+    UIGrid* grid = &scene->grid;
+    if (grid->cells == NULL || id >= grid->rangeCapacity)
+        return;
+
+    RemoveFromGridRange(grid, grid->ranges[id], id);
+    grid->ranges[id] = (UIGridRange) { 0, 0, -1, -1 };
+}
+
+void FreeUIGrid(UIGrid* grid)
+{
+    for (int32_t i = 0; i < grid->cols * grid->rows; ++i)
+        free(grid->cells[i].ids);
+    free(grid->cells);
+    free(grid->ranges);
+    memset(grid, 0, sizeof(UIGrid));
+}
+
+// -----------------------------------------------------------------------------
+
+// point is in screen space, and is mapped back to the design space the
+// grid and its rects are in.
+UISceneId PickUIScene(const UIScene* scene, UIPoint point, bool interactiveOnly)
+{
+    const UIGrid* grid = &scene->grid;
+    if (grid->cells == NULL)
+        return UISCENE_INVALID_ID;
+
+    point = InverseScreenTransformUIPoint(point, scene->transform);
+    const UIGridCell* cell =
+        &grid->cells[GetGridRow(grid, point.y) * grid->cols + GetGridCol(grid, point.x)];
+
+    // The hit that draws on top, with the highest draw key, wins.
+    UISceneId best = UISCENE_INVALID_ID;
+    uint32_t bestKey = 0;
+    for (uint32_t i = 0; i < cell->count; ++i)
+    {
+        uint32_t slot = scene->idSlots[cell->ids[i]];
+        const UISceneNode* node = &scene->nodes[slot];
+        if (best != UISCENE_INVALID_ID && node->drawKey < bestKey)
+            continue;
+        if (interactiveOnly && (node->flags >> UI_NODE_KIND_SHIFT) == UI_STATIC)
+            continue;
+        if (!CollidesUIRectUIPoint(scene->designRects[slot], point))
+            continue;
+        if ((node->flags & UI_NODE_CLIPPED)
+            && !CollidesUIRectUIPoint(scene->clips[scene->clipIds[slot]], point))
+        {
+            continue;
+        }
+
+        best = node->id;
+        bestKey = node->drawKey;
+    }
+
+    return best;
+}
@@ -0,0 +1,242 @@
+#include "ui.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile.h"
+
+#define UILAYOUT_INITIAL_CAPACITY 64
+
+// -----------------------------------------------------------------------------
+
+static bool EqualsUIRect(UIRect a, UIRect b)
+{
+    return
+           a.left  == b.left  && a.top    == b.top
+        && a.right == b.right && a.bottom == b.bottom;
+}
+
+static UIRect GetInnerRect(const UILayoutNode* node)
+{
+    return (UIRect)
+    {
+        node->rect.left + node->padding,
+        node->rect.top + node->padding,
+        max(node->rect.right - node->padding, node->rect.left + node->padding),
+        max(node->rect.bottom - node->padding, node->rect.top + node->padding)
+    };
+}
+
+// Marks id for re-arrangement by its parent and leaves a trail of
+// childDirty flags up to the root.
+static void MarkUILayoutDirty(UILayout* layout, UILayoutId id)
+{
+    UILayoutNode* node = &layout->nodes[id];
+    node->dirty = true;
+    for (UILayoutId p = node->parent; p != UILAYOUT_NONE; p = layout->nodes[p].parent)
+    {
+        if (layout->nodes[p].childDirty)
+            break;
+        layout->nodes[p].childDirty = true;
+    }
+}
+
+static UIRect GetAnchoredRect(const UILayoutNode* child, UIRect inner)
+{
+    UISize size = GetUIRectSize(inner);
+    return (UIRect)
+    {
+        inner.left + child->anchors.left * size.w + child->offsets.left,
+        inner.top + child->anchors.top * size.h + child->offsets.top,
+        inner.left + child->anchors.right * size.w + child->offsets.right,
+        inner.top + child->anchors.bottom * size.h + child->offsets.bottom
+    };
+}
+
+static void LayoutUINode(UILayout* layout, UIScene* scene, UILayoutId id, UIRect rect);
+
+// Computes the rect of every child of node and lays each one out.
+static void ArrangeUILayoutChildren(UILayout* layout, UIScene* scene, UILayoutId id)
+{
+    const UILayoutNode* node = &layout->nodes[id];
+    UIRect inner = GetInnerRect(node);
+    if (node->kind == UI_LAYOUT_ANCHOR)
+    {
+        for (UILayoutId c = node->firstChild; c != UILAYOUT_NONE; c = layout->nodes[c].nextSibling)
+            LayoutUINode(layout, scene, c, GetAnchoredRect(&layout->nodes[c], inner));
+        return;
+    }
+
+    bool row = node->kind == UI_LAYOUT_ROW;
+    float mainStart = row ? inner.left : inner.top;
+    float mainSize = row ? inner.right - inner.left : inner.bottom - inner.top;
+    float crossStart = row ? inner.top : inner.left;
+    float crossSize = row ? inner.bottom - inner.top : inner.right - inner.left;
+
+    float used = 0;
+    float grow = 0;
+    size_t count = 0;
+    for (UILayoutId c = node->firstChild; c != UILAYOUT_NONE; c = layout->nodes[c].nextSibling)
+    {
+        used += layout->nodes[c].basis;
+        grow += layout->nodes[c].grow;
+        ++count;
+    }
+    if (count > 1)
+        used += node->gap * (count - 1);
+    float free = max(mainSize - used, 0.0f);
+
+    float pos = mainStart;
+    for (UILayoutId c = node->firstChild; c != UILAYOUT_NONE; c = layout->nodes[c].nextSibling)
+    {
+        const UILayoutNode* child = &layout->nodes[c];
+        float size = child->basis;
+        if (grow > 0)
+            size += free * child->grow / grow;
+
+        float c0 = crossStart;
+        float c1 = crossStart + crossSize;
+        if (child->crossSize > 0)
+        {
+            c0 = crossStart + (crossSize - child->crossSize) * 0.5f;
+            c1 = c0 + child->crossSize;
+        }
+
+        UIRect rect = row
+            ? (UIRect) { pos, c0, pos + size, c1 }
+            : (UIRect) { c0, pos, c1, pos + size };
+        LayoutUINode(layout, scene, c, rect);
+        pos += size + node->gap;
+    }
+}
+
+static void LayoutUINode(UILayout* layout, UIScene* scene, UILayoutId id, UIRect rect)
+{
+    UILayoutNode* node = &layout->nodes[id];
+    bool moved = !EqualsUIRect(node->rect, rect);
+    if (!moved && !node->dirty && !node->childDirty)
+        return;
+
+    node->rect = rect;
+    if (moved && node->element != UISCENE_INVALID_ID)
+        SetUISceneElementRect(scene, node->element, rect);
+
+    // A dirty child changes where its siblings go, so the children are
+    // re-arranged as a whole; clean ones that keep their rect return early.
+    if (moved || node->childDirty)
+        ArrangeUILayoutChildren(layout, scene, id);
+
+    node->dirty = false;
+    node->childDirty = false;
+}
+
+// -----------------------------------------------------------------------------
+
+UILayout* CreateUILayout()
+{
+    UILayout* ret = (UILayout*)malloc(sizeof(UILayout));
+    memset(ret, 0, sizeof(UILayout));
+    ret->root = UILAYOUT_NONE;
+    return ret;
+}
+
+UILayoutId AddUILayoutNode(UILayout* layout, UILayoutId parent, UILayoutKind kind)
+{
+    if (layout->count == layout->capacity)
+    {
+        layout->capacity = max(layout->capacity * 2, (size_t)UILAYOUT_INITIAL_CAPACITY);
+        layout->nodes = (UILayoutNode*)realloc(
+            layout->nodes, layout->capacity * sizeof(UILayoutNode));
+    }
+
+    UILayoutId id = (UILayoutId)layout->count++;
+    UILayoutNode* node = &layout->nodes[id];
+    memset(node, 0, sizeof(UILayoutNode));
+    node->parent = parent;
+    node->firstChild = UILAYOUT_NONE;
+    node->lastChild = UILAYOUT_NONE;
+    node->nextSibling = UILAYOUT_NONE;
+    node->kind = kind;
+    node->anchors = (UIRect) { 0, 0, 1, 1 };
+    node->element = UISCENE_INVALID_ID;
+
+    if (parent == UILAYOUT_NONE)
+    {
+        layout->root = id;
+    }
+    else
+    {
+        UILayoutNode* p = &layout->nodes[parent];
+        if (p->lastChild == UILAYOUT_NONE)
+            p->firstChild = id;
+        else
+            layout->nodes[p->lastChild].nextSibling = id;
+        p->lastChild = id;
+    }
+
+    MarkUILayoutDirty(layout, id);
+    return id;
+}
+
+void SetUILayoutAnchors(UILayout* layout, UILayoutId id, UIRect anchors, UIRect offsets)
+{
+    UILayoutNode* node = &layout->nodes[id];
+    if (EqualsUIRect(node->anchors, anchors) && EqualsUIRect(node->offsets, offsets))
+        return;
+
+    node->anchors = anchors;
+    node->offsets = offsets;
+    MarkUILayoutDirty(layout, id);
+}
+
+void SetUILayoutFlex(UILayout* layout, UILayoutId id, float basis, float grow, float crossSize)
+{
+    UILayoutNode* node = &layout->nodes[id];
+    if (node->basis == basis && node->grow == grow && node->crossSize == crossSize)
+        return;
+
+    node->basis = basis;
+    node->grow = grow;
+    node->crossSize = crossSize;
+    MarkUILayoutDirty(layout, id);
+}
+
+void SetUILayoutSpacing(UILayout* layout, UILayoutId id, float padding, float gap)
+{
+    UILayoutNode* node = &layout->nodes[id];
+    node->padding = padding;
+    node->gap = gap;
+
+    // Spacing only moves the children, so node itself needs no new rect.
+    if (node->firstChild != UILAYOUT_NONE)
+        MarkUILayoutDirty(layout, node->firstChild);
+}
+
+void BindUILayoutElement(UILayout* layout, UILayoutId id, UISceneId element)
+{
+    layout->nodes[id].element = element;
+    MarkUILayoutDirty(layout, id);
+
+    // Force the bound element to pick up the rect even if it is unchanged.
+    layout->nodes[id].rect = (UIRect) { 0, 0, -1, -1 };
+}
+
+void UpdateUILayout(UILayout* layout, UIScene* scene, UIRect bounds)
+{
+    PROFILE_ZONE("UpdateUILayout");
+    if (layout->root != UILAYOUT_NONE)
+        LayoutUINode(layout, scene, layout->root, bounds);
+}
+
+UIRect GetUILayoutRect(const UILayout* layout, UILayoutId id)
+{
+    return layout->nodes[id].rect;
+}
+
+void DeleteUILayout(UILayout* layout)
+{
+    free(layout->nodes);
+    free(layout);
+}
@@ -0,0 +1,167 @@
+#include "ui.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile.h"
+
+#define UILIST_NO_ITEM SIZE_MAX
+
+// -----------------------------------------------------------------------------
+
+static UIElement GetEmptyUIListRow(const UIScrollList* list, UIRect rect)
+{
+    UIElement row;
+    memset(&row, 0, sizeof(UIElement));
+    row.rect = rect;
+    row.style = list->style;
+    row.scale = 1.0f;
+    return row;
+}
+
+// Just below the viewport, where the clip hides the row entirely.
+static UIRect GetParkedUIListRowRect(const UIScrollList* list)
+{
+    return (UIRect)
+    {
+        list->rect.left,
+        list->rect.bottom,
+        list->rect.right,
+        list->rect.bottom + list->rowHeight
+    };
+}
+
+static float GetUIScrollListMaxScroll(const UIScrollList* list)
+{
+    float content = list->itemCount * list->rowHeight;
+    return max(content - (list->rect.bottom - list->rect.top), 0.0f);
+}
+
+static void InvalidateUIListRows(UIScrollList* list)
+{
+    for (size_t i = 0; i < list->rowCount; ++i)
+        list->rowItems[i] = UILIST_NO_ITEM;
+}
+
+// Grows the row pool to cover the viewport. Resizing the pool changes
+// which element every item maps to, so all rows are rebound afterwards.
+static void ReserveUIListRows(UIScrollList* list)
+{
+    float height = max(list->rect.bottom - list->rect.top, 0.0f);
+    size_t needed = (size_t)ceilf(height / list->rowHeight) + 1;
+    if (needed <= list->rowCount)
+        return;
+
+    list->rows = (UISceneId*)realloc(list->rows, needed * sizeof(UISceneId));
+    list->rowItems = (size_t*)realloc(list->rowItems, needed * sizeof(size_t));
+    for (size_t i = list->rowCount; i < needed; ++i)
+    {
+        UIElement row = GetEmptyUIListRow(list, GetParkedUIListRowRect(list));
+        list->rows[i] = InsertIntoUIScene(list->scene, &row);
+        SetUISceneElementClip(list->scene, list->rows[i], list->clip);
+    }
+    list->rowCount = needed;
+    InvalidateUIListRows(list);
+}
+
+static void UpdateUIListRows(UIScrollList* list)
+{
+    PROFILE_ZONE("UpdateUIListRows");
+    ReserveUIListRows(list);
+    list->scroll = min(max(list->scroll, 0.0f), GetUIScrollListMaxScroll(list));
+
+    size_t first = (size_t)(list->scroll / list->rowHeight);
+    for (size_t i = first; i < first + list->rowCount; ++i)
+    {
+        size_t k = i % list->rowCount;
+        if (i >= list->itemCount)
+        {
+            SetUISceneElementRect(list->scene, list->rows[k], GetParkedUIListRowRect(list));
+            continue;
+        }
+
+        float top = list->rect.top + i * list->rowHeight - list->scroll;
+        UIRect rect = { list->rect.left, top, list->rect.right, top + list->rowHeight };
+        if (list->rowItems[k] == i)
+        {
+            SetUISceneElementRect(list->scene, list->rows[k], rect);
+            continue;
+        }
+
+        UIElement row = GetEmptyUIListRow(list, rect);
+        list->bind(list->user, i, &row);
+        row.rect = rect;
+        SetUISceneElement(list->scene, list->rows[k], &row);
+        list->rowItems[k] = i;
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+UIScrollList* CreateUIScrollList(
+    UIScene* scene, UIRect rect, float rowHeight, size_t itemCount,
+    UIStyleId style, UIScrollListBindFn bind, void* user)
+{
+    UIScrollList* ret = (UIScrollList*)malloc(sizeof(UIScrollList));
+    memset(ret, 0, sizeof(UIScrollList));
+    ret->scene = scene;
+    ret->rect = rect;
+    ret->rowHeight = max(rowHeight, 1.0f);
+    ret->itemCount = itemCount;
+    ret->style = style;
+    ret->bind = bind;
+    ret->user = user;
+
+    UIElement panel = GetEmptyUIListRow(ret, rect);
+    ret->panel = InsertIntoUIScene(scene, &panel);
+    ret->clip = AddUISceneClip(scene, rect);
+
+    UpdateUIListRows(ret);
+    return ret;
+}
+
+void SetUIScrollListRect(UIScrollList* list, UIRect rect)
+{
+    list->rect = rect;
+    SetUISceneElementRect(list->scene, list->panel, rect);
+    SetUISceneClip(list->scene, list->clip, rect);
+    UpdateUIListRows(list);
+}
+
+void SetUIScrollListItemCount(UIScrollList* list, size_t itemCount)
+{
+    list->itemCount = itemCount;
+    InvalidateUIListRows(list);
+    UpdateUIListRows(list);
+}
+
+void ScrollUIScrollList(UIScrollList* list, float delta)
+{
+    float scroll = min(max(list->scroll + delta, 0.0f), GetUIScrollListMaxScroll(list));
+    if (scroll == list->scroll)
+        return;
+
+    list->scroll = scroll;
+    UpdateUIListRows(list);
+}
+
+void RefreshUIScrollList(UIScrollList* list)
+{
+    InvalidateUIListRows(list);
+    UpdateUIListRows(list);
+}
+
+void DeleteUIScrollList(UIScrollList* list)
+{
+    for (size_t i = 0; i < list->rowCount; ++i)
+        DeleteFromUIScene(list->scene, list->rows[i]);
+    DeleteFromUIScene(list->scene, list->panel);
+    RemoveUISceneClip(list->scene, list->clip);
+    free(list->rows);
+    free(list->rowItems);
+    free(list);
+}
@@ -0,0 +1,98 @@
+#include "ui.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UIPOOL_BLOCK_SIZE 256
+
+static UIElementPool pool = { 0 };
+
+// -----------------------------------------------------------------------------
+
+static UIElement* GetPoolSlot(uint32_t index)
+{
+    return &pool.blocks[index / UIPOOL_BLOCK_SIZE][index % UIPOOL_BLOCK_SIZE];
+}
+
+static void GrowUIElementPool()
+{
+    UIElement* block = (UIElement*)calloc(UIPOOL_BLOCK_SIZE, sizeof(UIElement));
+    pool.blocks = (UIElement**)realloc(
+        pool.blocks, (pool.blockCount + 1) * sizeof(UIElement*));
+    pool.blocks[pool.blockCount++] = block;
+
+    uint32_t newCapacity = pool.capacity + UIPOOL_BLOCK_SIZE;
+    pool.generations = (uint32_t*)realloc(
+        pool.generations, newCapacity * sizeof(uint32_t));
+    pool.freeList = (uint32_t*)realloc(
+        pool.freeList, newCapacity * sizeof(uint32_t));
+
+    // Push in reverse so slots are handed out in ascending order.
+    for (uint32_t i = newCapacity; i > pool.capacity; --i)
+    {
+        pool.generations[i - 1] = 0;
+        pool.freeList[pool.freeCount++] = i - 1;
+    }
+    pool.capacity = newCapacity;
+}
+
+// -----------------------------------------------------------------------------
+
+UIHandle CreateEmptyUIElement()
+{
+    if (pool.freeCount == 0)
+        GrowUIElementPool();
+
+    uint32_t index = pool.freeList[--pool.freeCount];
+    uint32_t generation = ++pool.generations[index];
+
+    // The layout buffers of a recycled slot are kept so transient widgets
+    // do not reallocate them every time.
+    UIElement* elem = GetPoolSlot(index);
+    UITextLayout layout = elem->textLayout;
+    memset(elem, 0, sizeof(UIElement));
+    elem->textLayout = layout;
+    elem->scale = 1.0f;
+    InvalidateUITextLayout(&elem->textLayout);
+
+    return (UIHandle) { index, generation };
+}
+
+UIElement* GetUIElement(UIHandle handle)
+{
+    if (!IsUIElementAlive(handle))
+        return NULL;
+    return GetPoolSlot(handle.index);
+}
+
+bool IsUIElementAlive(UIHandle handle)
+{
+    return
+           handle.index < pool.capacity
+        && pool.generations[handle.index] == handle.generation
+        && (handle.generation & 1u) != 0;
+}
+
+void DeleteUIElement(UIHandle handle)
+{
+    if (!IsUIElementAlive(handle))
+        return;
+
+    ++pool.generations[handle.index];
+    pool.freeList[pool.freeCount++] = handle.index;
+}
+
+void UnloadUIElementPool()
+{
+    for (uint32_t i = 0; i < pool.capacity; ++i)
+        FreeUITextLayout(&GetPoolSlot(i)->textLayout);
+    for (uint32_t i = 0; i < pool.blockCount; ++i)
+        free(pool.blocks[i]);
+
+    free(pool.blocks);
+    free(pool.generations);
+    free(pool.freeList);
+    memset(&pool, 0, sizeof(UIElementPool));
+}
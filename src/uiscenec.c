@@ -0,0 +1,572 @@
+#include "ui.h"
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "textparse.h"
+
+// Compiles the text form of a scene into a scene file. Every line is
+// blank, a # comment, or one of:
+//
+//   style <name> [bg=<color>] [border=<width>] [border-color=<color>] [font=<color>]
+//   clip <name> <left> <top> <right> <bottom>
+//   <static|button|toggle> <key> <left> <top> <right> <bottom> style=<name> [attributes]
+//
+// Colors are #rrggbb or #rrggbbaa. Element attributes are text="<string>"
+// with \", \\ and \n escapes, size=<font size>, align=<h>,<v> with h one
+// of left, center, right and v one of top, center, bottom,
+// margins=<left>,<top>,<right>,<bottom>, texture=<name>,
+// texrect=<left>,<top>,<right>,<bottom>, clip=<name>, toggled, and wrap
+// and ellipsis for text that does not fit. Keys must be unique. Elements
+// are drawn in the order they are listed.
+
+#define UISCENEC_DEFAULT_FONT_SIZE 20.0f
+#define UISCENEC_NUMBER_MAX 64
+
+typedef struct UISceneCompiler
+{
+    int line;
+    char* error;
+    size_t errorSize;
+    TextView* styleNames;
+    UIStyle* styles;
+    uint32_t styleCount;
+    TextView* clipNames;
+    UIRect* clips;
+    uint32_t clipCount;
+    TextView* textureNames;
+    uint32_t* textures;
+    uint32_t textureCount;
+    TextView* keys;
+    UISceneFileElement* elements;
+    uint32_t elementCount;
+    char* strings;
+    size_t stringSize;
+    size_t stringCapacity;
+} UISceneCompiler;
+
+// -----------------------------------------------------------------------------
+
+static bool FailUISceneCompile(UISceneCompiler* c, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    FormatTextError(c->error, c->errorSize, c->line, format, args);
+    va_end(args);
+    return false;
+}
+
+// Tables are grown one entry at a time; scene sources are small.
+static void* GrowUISceneTable(void* table, uint32_t count, size_t size)
+{
+    return realloc(table, (count + 1) * size);
+}
+
+static uint32_t FindUISceneName(const TextView* names, uint32_t count, TextView name)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (names[i].length == name.length && memcmp(names[i].data, name.data, name.length) == 0)
+            return i;
+    }
+    return UISCENE_FILE_NONE;
+}
+
+static uint32_t AddUISceneString(UISceneCompiler* c, const char* str, size_t length)
+{
+    if (c->stringSize + length + 1 > c->stringCapacity)
+    {
+        c->stringCapacity = max(c->stringCapacity * 2, c->stringSize + length + 1);
+        c->strings = (char*)realloc(c->strings, c->stringCapacity);
+    }
+
+    uint32_t offset = (uint32_t)c->stringSize;
+    memcpy(c->strings + offset, str, length);
+    c->strings[offset + length] = '\0';
+    c->stringSize += length + 1;
+    return offset;
+}
+
+// -----------------------------------------------------------------------------
+
+static bool ParseUISceneNumber(TextView token, float* out)
+{
+    char buffer[UISCENEC_NUMBER_MAX];
+    if (token.length == 0 || token.length >= UISCENEC_NUMBER_MAX)
+        return false;
+
+    memcpy(buffer, token.data, token.length);
+    buffer[token.length] = '\0';
+    char* end = NULL;
+    *out = strtof(buffer, &end);
+    return *end == '\0';
+}
+
+// Parses count comma separated numbers.
+static bool ParseUISceneNumbers(TextView token, float* out, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        const char* comma = memchr(token.data, ',', token.length);
+        size_t length = i + 1 < count && comma != NULL ? (size_t)(comma - token.data) : token.length;
+        if (!ParseUISceneNumber((TextView) { token.data, length }, &out[i]))
+            return false;
+        if (i + 1 < count)
+        {
+            if (comma == NULL)
+                return false;
+            token = (TextView) { comma + 1, token.length - length - 1 };
+        }
+    }
+    return true;
+}
+
+static bool ParseUISceneRect(TextView token, UIRect* out)
+{
+    float v[4];
+    if (!ParseUISceneNumbers(token, v, 4))
+        return false;
+    *out = (UIRect) { v[0], v[1], v[2], v[3] };
+    return true;
+}
+
+static int ParseUISceneHexDigit(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+static bool ParseUISceneColor(TextView token, Color* out)
+{
+    if ((token.length != 7 && token.length != 9) || token.data[0] != '#')
+        return false;
+
+    unsigned char channels[4] = { 0, 0, 0, 255 };
+    for (size_t i = 1; i < token.length; i += 2)
+    {
+        int hi = ParseUISceneHexDigit(token.data[i]);
+        int lo = ParseUISceneHexDigit(token.data[i + 1]);
+        if (hi < 0 || lo < 0)
+            return false;
+        channels[i / 2] = (unsigned char)(hi * 16 + lo);
+    }
+    *out = (Color) { channels[0], channels[1], channels[2], channels[3] };
+    return true;
+}
+
+// Unescapes a quoted token into the string pool.
+static bool AddUISceneQuotedString(UISceneCompiler* c, TextView token, uint32_t* out)
+{
+    if (token.length < 2 || token.data[0] != '"' || token.data[token.length - 1] != '"')
+        return false;
+
+    char* str = (char*)malloc(token.length);
+    size_t length = 0;
+    for (size_t i = 1; i + 1 < token.length; ++i)
+    {
+        char ch = token.data[i];
+        if (ch == '\\' && i + 2 < token.length)
+        {
+            ch = token.data[++i];
+            if (ch == 'n')
+                ch = '\n';
+        }
+        str[length++] = ch;
+    }
+
+    *out = AddUISceneString(c, str, length);
+    free(str);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+
+static bool ParseUISceneStyle(UISceneCompiler* c, TextView line)
+{
+    TextView name;
+    if (!NextTextToken(&line, &name))
+        return FailUISceneCompile(c, "style needs a name");
+    if (FindUISceneName(c->styleNames, c->styleCount, name) != UISCENE_FILE_NONE)
+        return FailUISceneCompile(c, "style %.*s is already defined", (int)name.length, name.data);
+
+    UIStyle style = { BLACK, 0.0f, BLANK, WHITE };
+    TextView token;
+    while (NextTextToken(&line, &token))
+    {
+        TextView key;
+        TextView value;
+        SplitTextAttribute(token, &key, &value);
+        bool ok = false;
+        if (EqualsTextView(key, "bg"))
+            ok = ParseUISceneColor(value, &style.bgColor);
+        else if (EqualsTextView(key, "border"))
+            ok = ParseUISceneNumber(value, &style.borderWidth);
+        else if (EqualsTextView(key, "border-color"))
+            ok = ParseUISceneColor(value, &style.borderColor);
+        else if (EqualsTextView(key, "font"))
+            ok = ParseUISceneColor(value, &style.fontColor);
+
+        if (!ok)
+            return FailUISceneCompile(c, "bad style attribute %.*s", (int)token.length, token.data);
+    }
+
+    c->styleNames = (TextView*)GrowUISceneTable(c->styleNames, c->styleCount, sizeof(TextView));
+    c->styles = (UIStyle*)GrowUISceneTable(c->styles, c->styleCount, sizeof(UIStyle));
+    c->styleNames[c->styleCount] = name;
+    c->styles[c->styleCount++] = style;
+    return true;
+}
+
+static bool ParseUISceneClip(UISceneCompiler* c, TextView line)
+{
+    TextView name;
+    if (!NextTextToken(&line, &name))
+        return FailUISceneCompile(c, "clip needs a name");
+    if (FindUISceneName(c->clipNames, c->clipCount, name) != UISCENE_FILE_NONE)
+        return FailUISceneCompile(c, "clip %.*s is already defined", (int)name.length, name.data);
+
+    float v[4];
+    TextView token;
+    for (int i = 0; i < 4; ++i)
+    {
+        if (!NextTextToken(&line, &token) || !ParseUISceneNumber(token, &v[i]))
+            return FailUISceneCompile(c, "clip needs left, top, right and bottom");
+    }
+    if (NextTextToken(&line, &token))
+        return FailUISceneCompile(c, "unexpected %.*s", (int)token.length, token.data);
+
+    c->clipNames = (TextView*)GrowUISceneTable(c->clipNames, c->clipCount, sizeof(TextView));
+    c->clips = (UIRect*)GrowUISceneTable(c->clips, c->clipCount, sizeof(UIRect));
+    c->clipNames[c->clipCount] = name;
+    c->clips[c->clipCount++] = (UIRect) { v[0], v[1], v[2], v[3] };
+    return true;
+}
+
+static bool ParseUISceneAlign(TextView value, UIAlign* align)
+{
+    const char* comma = memchr(value.data, ',', value.length);
+    if (comma == NULL)
+        return false;
+
+    TextView h = { value.data, (size_t)(comma - value.data) };
+    TextView v = { comma + 1, value.length - h.length - 1 };
+    if (EqualsTextView(h, "left"))
+        align->halign = H_LEFT;
+    else if (EqualsTextView(h, "center"))
+        align->halign = H_CENTER;
+    else if (EqualsTextView(h, "right"))
+        align->halign = H_RIGHT;
+    else
+        return false;
+
+    if (EqualsTextView(v, "top"))
+        align->valign = V_TOP;
+    else if (EqualsTextView(v, "center"))
+        align->valign = V_CENTER;
+    else if (EqualsTextView(v, "bottom"))
+        align->valign = V_BOTTOM;
+    else
+        return false;
+    return true;
+}
+
+static uint32_t AddUISceneTexture(UISceneCompiler* c, TextView name)
+{
+    uint32_t texture = FindUISceneName(c->textureNames, c->textureCount, name);
+    if (texture != UISCENE_FILE_NONE)
+        return texture;
+
+    c->textureNames = (TextView*)GrowUISceneTable(c->textureNames, c->textureCount, sizeof(TextView));
+    c->textures = (uint32_t*)GrowUISceneTable(c->textures, c->textureCount, sizeof(uint32_t));
+    c->textureNames[c->textureCount] = name;
+    c->textures[c->textureCount] = AddUISceneString(c, name.data, name.length);
+    return c->textureCount++;
+}
+
+static bool ParseUISceneElementAttribute(UISceneCompiler* c, UISceneFileElement* elem, TextView token)
+{
+    TextView key;
+    TextView value;
+    SplitTextAttribute(token, &key, &value);
+    if (EqualsTextView(key, "style"))
+    {
+        elem->style = FindUISceneName(c->styleNames, c->styleCount, value);
+        return elem->style != UISCENE_FILE_NONE;
+    }
+    if (EqualsTextView(key, "text"))
+        return AddUISceneQuotedString(c, value, &elem->text);
+    if (EqualsTextView(key, "size"))
+        return ParseUISceneNumber(value, &elem->fontSize);
+    if (EqualsTextView(key, "align"))
+        return ParseUISceneAlign(value, &elem->align);
+    if (EqualsTextView(key, "margins"))
+    {
+        float v[4];
+        if (!ParseUISceneNumbers(value, v, 4))
+            return false;
+        elem->align.leftMargin = v[0];
+        elem->align.topMargin = v[1];
+        elem->align.rightMargin = v[2];
+        elem->align.bottomMargin = v[3];
+        return true;
+    }
+    if (EqualsTextView(key, "texture"))
+    {
+        elem->texture = value.length > 0 ? AddUISceneTexture(c, value) : UISCENE_FILE_NONE;
+        return value.length > 0;
+    }
+    if (EqualsTextView(key, "texrect"))
+        return ParseUISceneRect(value, &elem->textureRect);
+    if (EqualsTextView(key, "clip"))
+    {
+        elem->clip = FindUISceneName(c->clipNames, c->clipCount, value);
+        return elem->clip != UISCENE_FILE_NONE;
+    }
+    if (EqualsTextView(key, "toggled") && value.length == 0)
+    {
+        elem->flags |= UI_STATE_TOGGLED;
+        return true;
+    }
+    if (EqualsTextView(key, "wrap") && value.length == 0)
+    {
+        elem->align.flow |= UI_TEXT_WRAP;
+        return true;
+    }
+    if (EqualsTextView(key, "ellipsis") && value.length == 0)
+    {
+        elem->align.flow |= UI_TEXT_ELLIPSIS;
+        return true;
+    }
+    return false;
+}
+
+static bool ParseUISceneElement(UISceneCompiler* c, UIKind kind, TextView line)
+{
+    TextView key;
+    if (!NextTextToken(&line, &key))
+        return FailUISceneCompile(c, "element needs a key");
+    if (FindUISceneName(c->keys, c->elementCount, key) != UISCENE_FILE_NONE)
+        return FailUISceneCompile(c, "key %.*s is already used", (int)key.length, key.data);
+
+    float v[4];
+    TextView token;
+    for (int i = 0; i < 4; ++i)
+    {
+        if (!NextTextToken(&line, &token) || !ParseUISceneNumber(token, &v[i]))
+            return FailUISceneCompile(c, "element needs left, top, right and bottom");
+    }
+
+    UISceneFileElement elem =
+    {
+        .key = AddUISceneString(c, key.data, key.length),
+        .text = UISCENE_FILE_NONE,
+        .texture = UISCENE_FILE_NONE,
+        .style = UISCENE_FILE_NONE,
+        .clip = UISCENE_FILE_NONE,
+        .flags = (uint32_t)kind << UI_NODE_KIND_SHIFT,
+        .rect = { v[0], v[1], v[2], v[3] },
+        .textureRect = { v[0], v[1], v[2], v[3] },
+        .fontSize = UISCENEC_DEFAULT_FONT_SIZE
+    };
+
+    while (NextTextToken(&line, &token))
+    {
+        if (!ParseUISceneElementAttribute(c, &elem, token))
+            return FailUISceneCompile(c, "bad attribute %.*s", (int)token.length, token.data);
+    }
+    if (elem.style == UISCENE_FILE_NONE)
+        return FailUISceneCompile(c, "element %.*s needs a style", (int)key.length, key.data);
+
+    if (elem.text != UISCENE_FILE_NONE)
+        elem.flags |= UI_NODE_TEXT;
+    if (elem.texture != UISCENE_FILE_NONE)
+        elem.flags |= UI_NODE_TEXTURE;
+    if (elem.clip != UISCENE_FILE_NONE)
+        elem.flags |= UI_NODE_CLIPPED;
+
+    c->keys = (TextView*)GrowUISceneTable(c->keys, c->elementCount, sizeof(TextView));
+    c->elements = (UISceneFileElement*)GrowUISceneTable(
+        c->elements, c->elementCount, sizeof(UISceneFileElement));
+    c->keys[c->elementCount] = key;
+    c->elements[c->elementCount++] = elem;
+    return true;
+}
+
+static bool ParseUISceneLine(UISceneCompiler* c, TextView line)
+{
+    TextView command;
+    if (!NextTextToken(&line, &command) || command.data[0] == '#')
+        return true;
+
+    if (EqualsTextView(command, "style"))
+        return ParseUISceneStyle(c, line);
+    if (EqualsTextView(command, "clip"))
+        return ParseUISceneClip(c, line);
+    if (EqualsTextView(command, "static"))
+        return ParseUISceneElement(c, UI_STATIC, line);
+    if (EqualsTextView(command, "button"))
+        return ParseUISceneElement(c, UI_BUTTON, line);
+    if (EqualsTextView(command, "toggle"))
+        return ParseUISceneElement(c, UI_TOGGLE, line);
+    return FailUISceneCompile(c, "unknown command %.*s", (int)command.length, command.data);
+}
+
+// -----------------------------------------------------------------------------
+
+static size_t AlignUISceneOffset(size_t offset)
+{
+    return (offset + UISCENE_FILE_ALIGN - 1) / UISCENE_FILE_ALIGN * UISCENE_FILE_ALIGN;
+}
+
+// Lays the sections out and fills them in. The screen geometry is a copy
+// of the design geometry, as a file is stored at the identity transform.
+static char* BuildUISceneImage(const UISceneCompiler* c, size_t* size)
+{
+    size_t n = c->elementCount;
+    size_t sizes[UI_SCENE_FILE_SECTION_COUNT] =
+    {
+        [UI_SCENE_FILE_NODES] = n * sizeof(UISceneNode),
+        [UI_SCENE_FILE_DESIGN_RECTS] = n * sizeof(UIRect),
+        [UI_SCENE_FILE_DESIGN] = n * UI_GEOM_FIELD_COUNT * sizeof(float),
+        [UI_SCENE_FILE_SCREEN] = n * UI_GEOM_FIELD_COUNT * sizeof(float),
+        [UI_SCENE_FILE_CLIP_IDS] = n * sizeof(uint32_t),
+        [UI_SCENE_FILE_ELEMENTS] = n * sizeof(UISceneFileElement),
+        [UI_SCENE_FILE_CLIPS] = c->clipCount * sizeof(UIRect),
+        [UI_SCENE_FILE_STYLES] = c->styleCount * sizeof(UIStyle),
+        [UI_SCENE_FILE_TEXTURES] = c->textureCount * sizeof(uint32_t),
+        [UI_SCENE_FILE_STRINGS] = c->stringSize
+    };
+
+    UISceneFileHeader header =
+    {
+        UISCENE_FILE_MAGIC, UISCENE_FILE_VERSION,
+        sizeof(UISceneNode), sizeof(UISceneFileElement),
+        c->elementCount, c->clipCount, c->styleCount, c->textureCount, (uint32_t)c->stringSize,
+        { 0 }
+    };
+    size_t offset = AlignUISceneOffset(sizeof(UISceneFileHeader));
+    for (int s = 0; s < UI_SCENE_FILE_SECTION_COUNT; ++s)
+    {
+        header.sections[s] = (uint32_t)offset;
+        offset = AlignUISceneOffset(offset + sizes[s]);
+    }
+
+    char* image = (char*)calloc(offset, 1);
+    memcpy(image, &header, sizeof(UISceneFileHeader));
+    UISceneNode* nodes = (UISceneNode*)(image + header.sections[UI_SCENE_FILE_NODES]);
+    UIRect* designRects = (UIRect*)(image + header.sections[UI_SCENE_FILE_DESIGN_RECTS]);
+    float* design = (float*)(image + header.sections[UI_SCENE_FILE_DESIGN]);
+    uint32_t* clipIds = (uint32_t*)(image + header.sections[UI_SCENE_FILE_CLIP_IDS]);
+    UISceneFileElement* records = (UISceneFileElement*)(image + header.sections[UI_SCENE_FILE_ELEMENTS]);
+    for (size_t i = 0; i < n; ++i)
+    {
+        const UISceneFileElement* elem = &c->elements[i];
+        nodes[i] = (UISceneNode) { elem->rect, elem->flags, elem->style, (uint32_t)i, (UISceneId)i };
+        designRects[i] = elem->rect;
+        design[UI_GEOM_TEX_LEFT * n + i] = elem->textureRect.left;
+        design[UI_GEOM_TEX_TOP * n + i] = elem->textureRect.top;
+        design[UI_GEOM_TEX_RIGHT * n + i] = elem->textureRect.right;
+        design[UI_GEOM_TEX_BOTTOM * n + i] = elem->textureRect.bottom;
+        design[UI_GEOM_FONT_SIZE * n + i] = elem->fontSize;
+        clipIds[i] = elem->clip != UISCENE_FILE_NONE ? elem->clip : 0;
+        records[i] = *elem;
+    }
+
+    const void* tables[UI_SCENE_FILE_SECTION_COUNT] =
+    {
+        [UI_SCENE_FILE_SCREEN] = design,
+        [UI_SCENE_FILE_CLIPS] = c->clips,
+        [UI_SCENE_FILE_STYLES] = c->styles,
+        [UI_SCENE_FILE_TEXTURES] = c->textures,
+        [UI_SCENE_FILE_STRINGS] = c->strings
+    };
+    for (int s = UI_SCENE_FILE_SCREEN; s < UI_SCENE_FILE_SECTION_COUNT; ++s)
+    {
+        if (tables[s] != NULL && sizes[s] > 0)
+            memcpy(image + header.sections[s], tables[s], sizes[s]);
+    }
+
+    *size = offset;
+    return image;
+}
+
+// The image is written next to path and renamed over it, so a scene that
+// has the old file mapped keeps seeing the old contents.
+static bool WriteUISceneImage(UISceneCompiler* c, const char* path, const char* image, size_t size)
+{
+    size_t pathLength = strlen(path);
+    char* tmpPath = (char*)malloc(pathLength + 5);
+    memcpy(tmpPath, path, pathLength);
+    memcpy(tmpPath + pathLength, ".tmp", 5);
+
+    FILE* file = fopen(tmpPath, "wb");
+    bool ok = file != NULL && fwrite(image, 1, size, file) == size;
+    if (file != NULL)
+        ok = fclose(file) == 0 && ok;
+#ifdef _WIN32
+    if (ok)
+        remove(path);
+#endif
+    ok = ok && rename(tmpPath, path) == 0;
+    if (!ok)
+    {
+        remove(tmpPath);
+        c->line = 0;
+        FailUISceneCompile(c, "cannot write %s", path);
+    }
+
+    free(tmpPath);
+    return ok;
+}
+
+static void FreeUISceneCompiler(UISceneCompiler* c)
+{
+    free(c->styleNames);
+    free(c->styles);
+    free(c->clipNames);
+    free(c->clips);
+    free(c->textureNames);
+    free(c->textures);
+    free(c->keys);
+    free(c->elements);
+    free(c->strings);
+}
+
+// -----------------------------------------------------------------------------
+
+// Compiles the null-terminated scene text source into a scene file at
+// path. On failure, error receives a message naming the offending line.
+bool CompileUIScene(const char* source, const char* path, char* error, size_t errorSize)
+{
+    UISceneCompiler c = { 0 };
+    c.error = error;
+    c.errorSize = errorSize;
+
+    bool ok = true;
+    TextView line;
+    while (ok && NextTextLine(&source, &line))
+    {
+        ++c.line;
+        ok = ParseUISceneLine(&c, line);
+    }
+
+    if (ok)
+    {
+        size_t size = 0;
+        char* image = BuildUISceneImage(&c, &size);
+        ok = WriteUISceneImage(&c, path, image, size);
+        free(image);
+    }
+
+    FreeUISceneCompiler(&c);
+    return ok;
+}
@@ -0,0 +1,870 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "ui.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "profile.h"
+
+#define UISCENE_KEY_HASH_BASIS 2166136261u
+#define UISCENE_KEY_HASH_PRIME 16777619u
+
+// The tables of a scene file. A scene that was not loaded from a file
+// diffs against an empty view.
+typedef struct UISceneFileView
+{
+    const UISceneFileHeader* header;
+    const UISceneFileElement* elements;
+    const UIRect* clips;
+    const UIStyle* styles;
+    const uint32_t* textures;
+    const char* strings;
+} UISceneFileView;
+
+// What the tables of a file resolve to in this process, and its elements
+// by key.
+typedef struct UISceneFileTables
+{
+    UIStyleId* styles;
+    UITextureRegion* textures;
+    uint32_t* keys;
+    uint32_t keyMask;
+} UISceneFileTables;
+
+static const UISceneFileHeader emptyUISceneFileHeader = { 0 };
+
+// -----------------------------------------------------------------------------
+
+#ifndef _WIN32
+
+// Private and writable, so a scene can edit its arrays in place; pages
+// are only copied once they are written to.
+static bool MapUISceneFile(const char* path, UISceneMapping* out)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+        return false;
+
+    *out = (UISceneMapping) { data, (size_t)st.st_size, true };
+    return true;
+}
+
+#else
+
+static bool MapUISceneFile(const char* path, UISceneMapping* out)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+        return false;
+
+    void* data = NULL;
+    long size = 0;
+    if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0)
+    {
+        data = malloc((size_t)size);
+        if (fread(data, 1, (size_t)size, file) != (size_t)size)
+        {
+            free(data);
+            data = NULL;
+        }
+    }
+    fclose(file);
+
+    if (data == NULL)
+        return false;
+
+    *out = (UISceneMapping) { data, (size_t)size, false };
+    return true;
+}
+
+#endif
+
+static void UnmapUISceneFile(UISceneMapping* mapping)
+{
+#ifndef _WIN32
+    if (mapping->mapped)
+        munmap(mapping->data, mapping->size);
+    else
+        free(mapping->data);
+#else
+    free(mapping->data);
+#endif
+    memset(mapping, 0, sizeof(UISceneMapping));
+}
+
+static const void* GetUISceneFileSection(const UISceneMapping* mapping, UISceneFileSection section)
+{
+    const UISceneFileHeader* header = (const UISceneFileHeader*)mapping->data;
+    return (const char*)mapping->data + header->sections[section];
+}
+
+static UISceneFileView GetUISceneFileView(const UISceneMapping* mapping)
+{
+    if (mapping == NULL)
+        return (UISceneFileView) { &emptyUISceneFileHeader };
+
+    return (UISceneFileView)
+    {
+        (const UISceneFileHeader*)mapping->data,
+        (const UISceneFileElement*)GetUISceneFileSection(mapping, UI_SCENE_FILE_ELEMENTS),
+        (const UIRect*)GetUISceneFileSection(mapping, UI_SCENE_FILE_CLIPS),
+        (const UIStyle*)GetUISceneFileSection(mapping, UI_SCENE_FILE_STYLES),
+        (const uint32_t*)GetUISceneFileSection(mapping, UI_SCENE_FILE_TEXTURES),
+        (const char*)GetUISceneFileSection(mapping, UI_SCENE_FILE_STRINGS)
+    };
+}
+
+// The file a scene was last loaded or reloaded from, if any.
+static const UISceneMapping* GetUISceneFileMapping(const UIScene* scene)
+{
+    const UISceneFileLink* link = &scene->file;
+    return link->mappingCount > 0 ? &link->mappings[link->mappingCount - 1] : NULL;
+}
+
+// Checks the header and that every section lies inside the file.
+static bool IsValidUISceneFile(const UISceneMapping* mapping)
+{
+    if (mapping->size < sizeof(UISceneFileHeader))
+        return false;
+
+    const UISceneFileHeader* header = (const UISceneFileHeader*)mapping->data;
+    if (header->magic != UISCENE_FILE_MAGIC
+        || header->version != UISCENE_FILE_VERSION
+        || header->nodeSize != sizeof(UISceneNode)
+        || header->elementSize != sizeof(UISceneFileElement))
+    {
+        return false;
+    }
+
+    size_t n = header->elementCount;
+    size_t sizes[UI_SCENE_FILE_SECTION_COUNT] =
+    {
+        [UI_SCENE_FILE_NODES] = n * sizeof(UISceneNode),
+        [UI_SCENE_FILE_DESIGN_RECTS] = n * sizeof(UIRect),
+        [UI_SCENE_FILE_DESIGN] = n * UI_GEOM_FIELD_COUNT * sizeof(float),
+        [UI_SCENE_FILE_SCREEN] = n * UI_GEOM_FIELD_COUNT * sizeof(float),
+        [UI_SCENE_FILE_CLIP_IDS] = n * sizeof(uint32_t),
+        [UI_SCENE_FILE_ELEMENTS] = n * sizeof(UISceneFileElement),
+        [UI_SCENE_FILE_CLIPS] = header->clipCount * sizeof(UIRect),
+        [UI_SCENE_FILE_STYLES] = header->styleCount * sizeof(UIStyle),
+        [UI_SCENE_FILE_TEXTURES] = header->textureCount * sizeof(uint32_t),
+        [UI_SCENE_FILE_STRINGS] = header->stringSize
+    };
+
+    for (int s = 0; s < UI_SCENE_FILE_SECTION_COUNT; ++s)
+    {
+        size_t offset = header->sections[s];
+        if (offset % UISCENE_FILE_ALIGN != 0 || offset > mapping->size || sizes[s] > mapping->size - offset)
+            return false;
+    }
+
+    const char* strings = (const char*)GetUISceneFileSection(mapping, UI_SCENE_FILE_STRINGS);
+    return header->stringSize == 0 || strings[header->stringSize - 1] == '\0';
+}
+
+// Offsets that are set must point into the string pool.
+static bool IsValidUISceneString(const UISceneFileView* file, uint32_t offset)
+{
+    return offset == UISCENE_FILE_NONE || offset < file->header->stringSize;
+}
+
+// Checks that the element records only refer to what the file holds and
+// that their flags agree with them.
+static bool AreValidUISceneFileElements(const UISceneFileView* file)
+{
+    const UISceneFileHeader* header = file->header;
+    for (uint32_t i = 0; i < header->elementCount; ++i)
+    {
+        const UISceneFileElement* element = &file->elements[i];
+        uint32_t flags = element->flags;
+        if (element->style >= header->styleCount
+            || (flags >> UI_NODE_KIND_SHIFT) > UI_TOGGLE
+            || (element->align.flow & ~UI_TEXT_FLOW_MASK) != 0
+            || (element->clip != UISCENE_FILE_NONE && element->clip >= header->clipCount)
+            || (element->texture != UISCENE_FILE_NONE && element->texture >= header->textureCount)
+            || (element->clip != UISCENE_FILE_NONE) != ((flags & UI_NODE_CLIPPED) != 0)
+            || (element->text != UISCENE_FILE_NONE) != ((flags & UI_NODE_TEXT) != 0)
+            || (element->texture != UISCENE_FILE_NONE) != ((flags & UI_NODE_TEXTURE) != 0)
+            || !IsValidUISceneString(file, element->key)
+            || !IsValidUISceneString(file, element->text))
+        {
+            return false;
+        }
+    }
+
+    for (uint32_t i = 0; i < header->textureCount; ++i)
+    {
+        if (file->textures[i] >= header->stringSize)
+            return false;
+    }
+    return true;
+}
+
+static uint32_t HashUISceneKey(const char* key)
+{
+    uint32_t hash = UISCENE_KEY_HASH_BASIS;
+    for (const unsigned char* p = (const unsigned char*)key; *p != '\0'; ++p)
+        hash = (hash ^ *p) * UISCENE_KEY_HASH_PRIME;
+    return hash;
+}
+
+// Open addressing table from key to element index over the elements of
+// file, in the UI frame arena. mask is the capacity, a power of two at
+// least twice the element count, minus one. Returns NULL if two elements
+// share a key.
+static uint32_t* BuildUISceneKeyTable(const UISceneFileView* file, uint32_t* mask)
+{
+    uint32_t capacity = 16;
+    while (capacity < file->header->elementCount * 2)
+        capacity *= 2;
+
+    uint32_t* table = (uint32_t*)ArenaAlloc(GetUIFrameArena(), capacity * sizeof(uint32_t));
+    memset(table, 0xFF, capacity * sizeof(uint32_t));
+    *mask = capacity - 1;
+    for (uint32_t i = 0; i < file->header->elementCount; ++i)
+    {
+        uint32_t key = file->elements[i].key;
+        if (key == UISCENE_FILE_NONE)
+            continue;
+
+        const char* str = file->strings + key;
+        uint32_t h = HashUISceneKey(str) & *mask;
+        for (; table[h] != UISCENE_FILE_NONE; h = (h + 1) & *mask)
+        {
+            if (strcmp(file->strings + file->elements[table[h]].key, str) == 0)
+                return NULL;
+        }
+        table[h] = i;
+    }
+    return table;
+}
+
+static uint32_t FindUISceneKey(const UISceneFileView* file, const uint32_t* table, uint32_t mask, const char* key)
+{
+    for (uint32_t h = HashUISceneKey(key) & mask; table[h] != UISCENE_FILE_NONE; h = (h + 1) & mask)
+    {
+        if (strcmp(file->strings + file->elements[table[h]].key, key) == 0)
+            return table[h];
+    }
+    return UISCENE_FILE_NONE;
+}
+
+// Interns the styles of a file and looks up its textures, into the UI
+// frame arena.
+static bool ResolveUISceneFileTables(
+    const UISceneFileView* file, UISceneTextureFn resolveTexture, void* user, UISceneFileTables* out)
+{
+    const UISceneFileHeader* header = file->header;
+    Arena* arena = GetUIFrameArena();
+    out->styles = (UIStyleId*)ArenaAlloc(arena, header->styleCount * sizeof(UIStyleId));
+    for (uint32_t i = 0; i < header->styleCount; ++i)
+        out->styles[i] = InternUIStyle(file->styles[i]);
+
+    out->textures = (UITextureRegion*)ArenaAlloc(arena, header->textureCount * sizeof(UITextureRegion));
+    for (uint32_t i = 0; i < header->textureCount; ++i)
+    {
+        if (resolveTexture == NULL || !resolveTexture(user, file->strings + file->textures[i], &out->textures[i]))
+            return false;
+    }
+    return true;
+}
+
+// Maps and checks a scene file and resolves its tables.
+static bool OpenUISceneFile(
+    const char* path, UISceneTextureFn texture, void* user,
+    UISceneMapping* mapping, UISceneFileView* file, UISceneFileTables* tables)
+{
+    if (!MapUISceneFile(path, mapping))
+        return false;
+
+    if (IsValidUISceneFile(mapping))
+    {
+        *file = GetUISceneFileView(mapping);
+        // Reloads match elements by key, so keys have to be unique.
+        if (AreValidUISceneFileElements(file)
+            && (tables->keys = BuildUISceneKeyTable(file, &tables->keyMask)) != NULL
+            && ResolveUISceneFileTables(file, texture, user, tables))
+        {
+            return true;
+        }
+    }
+
+    UnmapUISceneFile(mapping);
+    return false;
+}
+
+// Points the ids of the newest file's elements back at them, and every
+// other id at nothing.
+static void LinkUISceneFileElements(UIScene* scene, const UISceneId* ids, size_t count)
+{
+    UISceneFileLink* link = &scene->file;
+    if (link->elementCapacity < scene->idCapacity)
+    {
+        link->elements = (uint32_t*)realloc(link->elements, scene->idCapacity * sizeof(uint32_t));
+        link->elementCapacity = scene->idCapacity;
+    }
+
+    memset(link->elements, 0xFF, link->elementCapacity * sizeof(uint32_t));
+    for (size_t i = 0; i < count; ++i)
+        link->elements[ids[i]] = (uint32_t)i;
+}
+
+static void AddUISceneFileMapping(UISceneFileLink* link, UISceneMapping mapping)
+{
+    link->mappings = (UISceneMapping*)realloc(
+        link->mappings, (link->mappingCount + 1) * sizeof(UISceneMapping));
+    link->mappings[link->mappingCount++] = mapping;
+}
+
+static bool IsInUISceneFileMapping(const UISceneMapping* mapping, const void* p)
+{
+    const char* data = (const char*)mapping->data;
+    return (const char*)p >= data && (const char*)p < data + mapping->size;
+}
+
+// Whether the scene still draws from mapping: its per-slot arrays, which
+// stay in the first file until they grow, or text taken from it.
+static bool IsUISceneFileMappingInUse(const UIScene* scene, const UISceneMapping* mapping)
+{
+    if (IsInUISceneFileMapping(mapping, scene->nodes)
+        || IsInUISceneFileMapping(mapping, scene->designRects)
+        || IsInUISceneFileMapping(mapping, scene->clipIds))
+    {
+        return true;
+    }
+    for (int f = 0; f < UI_GEOM_FIELD_COUNT; ++f)
+    {
+        if (IsInUISceneFileMapping(mapping, scene->design[f]) || IsInUISceneFileMapping(mapping, scene->screen[f]))
+            return true;
+    }
+
+    for (size_t i = 0; i < scene->size; ++i)
+    {
+        if ((scene->nodes[i].flags & UI_NODE_TEXT) && IsInUISceneFileMapping(mapping, scene->texts[i].text.str))
+            return true;
+    }
+    return false;
+}
+
+// Unmaps the older files nothing points into anymore, so a long hot
+// reload session does not pile them up. Layouts built from their text
+// must already be stale, and are dropped.
+static void ReleaseUISceneFileMappings(UIScene* scene)
+{
+    UISceneFileLink* link = &scene->file;
+    size_t kept = 0;
+    for (size_t m = 0; m < link->mappingCount; ++m)
+    {
+        UISceneMapping* mapping = &link->mappings[m];
+        if (m + 1 == link->mappingCount || IsUISceneFileMappingInUse(scene, mapping))
+        {
+            link->mappings[kept++] = *mapping;
+            continue;
+        }
+
+        for (size_t i = 0; i < scene->size; ++i)
+        {
+            if (IsInUISceneFileMapping(mapping, scene->layouts[i].str))
+            {
+                InvalidateUITextLayout(&scene->layouts[i]);
+                scene->layouts[i].str = NULL;
+            }
+        }
+        UnmapUISceneFile(mapping);
+    }
+    link->mappingCount = kept;
+}
+
+// Element i of a file as an element to insert into a scene.
+static void ReadUISceneFileElement(
+    const UISceneFileView* file, const UISceneFileTables* tables, uint32_t i, UIElement* out)
+{
+    const UISceneFileElement* element = &file->elements[i];
+    memset(out, 0, sizeof(UIElement));
+    out->rect = element->rect;
+    out->style = tables->styles[element->style];
+    out->scale = 1.0f;
+    out->kind = (UIKind)(element->flags >> UI_NODE_KIND_SHIFT);
+    out->optState = element->flags & UI_STATE_MASK;
+    out->textureRect = element->textureRect;
+    out->text.fontSize = element->fontSize;
+    out->textAlign = element->align;
+
+    if (element->texture != UISCENE_FILE_NONE)
+    {
+        out->hasTexture = true;
+        out->texture = tables->textures[element->texture];
+    }
+    if (element->text != UISCENE_FILE_NONE)
+    {
+        out->hasText = true;
+        out->text.str = (char*)file->strings + element->text;
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+// Points the scene at the arrays in its mapping and fills in the rest:
+// the text and texture side tables, which hold pointers, and everything
+// that is only ever built at runtime. The nodes must match the element
+// records. Element i of the file gets id i.
+static bool AttachUISceneFile(UIScene* scene, const UISceneFileView* file, const UISceneFileTables* tables)
+{
+    const UISceneMapping* mapping = GetUISceneFileMapping(scene);
+    const UISceneFileHeader* header = file->header;
+    UISceneFileLink* link = &scene->file;
+
+    uint32_t clipCount = header->clipCount;
+    scene->clips = (UIRect*)malloc(max(clipCount, 1u) * sizeof(UIRect));
+    scene->screenClips = (UIRect*)malloc(max(clipCount, 1u) * sizeof(UIRect));
+    link->clips = (uint32_t*)malloc(max(clipCount, 1u) * sizeof(uint32_t));
+    memcpy(scene->clips, file->clips, clipCount * sizeof(UIRect));
+    memcpy(scene->screenClips, file->clips, clipCount * sizeof(UIRect));
+    for (uint32_t i = 0; i < clipCount; ++i)
+        link->clips[i] = i;
+    scene->clipCount = clipCount;
+    scene->clipCapacity = clipCount;
+    scene->freeClips = (uint32_t*)malloc(max(clipCount, 1u) * sizeof(uint32_t));
+    scene->clipMembers = (UISceneClipMembers*)calloc(max(clipCount, 1u), sizeof(UISceneClipMembers));
+
+    size_t n = header->elementCount;
+    if (n == 0)
+        return true;
+
+    UISceneNode* nodes = (UISceneNode*)GetUISceneFileSection(mapping, UI_SCENE_FILE_NODES);
+    float* design = (float*)GetUISceneFileSection(mapping, UI_SCENE_FILE_DESIGN);
+    float* screen = (float*)GetUISceneFileSection(mapping, UI_SCENE_FILE_SCREEN);
+    scene->nodes = nodes;
+    scene->designRects = (UIRect*)GetUISceneFileSection(mapping, UI_SCENE_FILE_DESIGN_RECTS);
+    scene->clipIds = (uint32_t*)GetUISceneFileSection(mapping, UI_SCENE_FILE_CLIP_IDS);
+    for (int f = 0; f < UI_GEOM_FIELD_COUNT; ++f)
+    {
+        scene->design[f] = design + f * n;
+        scene->screen[f] = screen + f * n;
+    }
+
+    scene->textures = (UITextureRegion*)malloc(n * sizeof(UITextureRegion));
+    scene->texts = (UISceneText*)malloc(n * sizeof(UISceneText));
+    scene->layouts = (UITextLayout*)calloc(n, sizeof(UITextLayout));
+    scene->idSlots = (uint32_t*)malloc(n * sizeof(uint32_t));
+    scene->freeIds = (UISceneId*)malloc(n * sizeof(UISceneId));
+    link->ids = (UISceneId*)malloc(n * sizeof(UISceneId));
+    scene->capacity = n;
+    scene->idCapacity = n;
+    scene->size = n;
+    scene->nextDrawKey = (uint32_t)n;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        UISceneNode* node = &nodes[i];
+        const UISceneFileElement* element = &file->elements[i];
+        if (node->id != i
+            || node->drawKey != i
+            || node->flags != element->flags
+            || node->style != element->style
+            || ((node->flags & UI_NODE_CLIPPED) && scene->clipIds[i] != element->clip))
+        {
+            return false;
+        }
+
+        // Nodes are only written to when the registry hands out other ids
+        // than the file's, so their pages usually stay shared.
+        if (tables->styles[node->style] != node->style)
+            node->style = tables->styles[node->style];
+        if (element->text != UISCENE_FILE_NONE)
+        {
+            UIText text = { (char*)file->strings + element->text, element->fontSize };
+            scene->texts[i] = (UISceneText) { text, element->align };
+        }
+        if (element->texture != UISCENE_FILE_NONE)
+            scene->textures[i] = tables->textures[element->texture];
+        scene->idSlots[i] = (uint32_t)i;
+        link->ids[i] = (UISceneId)i;
+        if (node->flags & UI_NODE_CLIPPED)
+            AddUISceneClipMember(scene, scene->clipIds[i], (UISceneId)i);
+    }
+
+    LinkUISceneFileElements(scene, link->ids, n);
+    RebuildUIGrid(scene);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+
+static bool EqualsUIRect(UIRect a, UIRect b)
+{
+    return
+           a.left  == b.left  && a.top    == b.top
+        && a.right == b.right && a.bottom == b.bottom;
+}
+
+static bool EqualsUIAlign(UIAlign a, UIAlign b)
+{
+    return
+           a.halign == b.halign && a.valign == b.valign
+        && a.leftMargin == b.leftMargin && a.topMargin == b.topMargin
+        && a.rightMargin == b.rightMargin && a.bottomMargin == b.bottomMargin
+        && a.flow == b.flow;
+}
+
+static bool EqualsUISceneFileString(
+    const UISceneFileView* a, uint32_t offsetA, const UISceneFileView* b, uint32_t offsetB)
+{
+    if (offsetA == UISCENE_FILE_NONE || offsetB == UISCENE_FILE_NONE)
+        return offsetA == offsetB;
+    return strcmp(a->strings + offsetA, b->strings + offsetB) == 0;
+}
+
+// The live id of element i of the scene's current file, unless it has
+// been deleted since.
+static UISceneId GetUISceneFileElementId(const UIScene* scene, uint32_t i)
+{
+    const UISceneFileLink* link = &scene->file;
+    UISceneId id = link->ids[i];
+    if (id >= link->elementCapacity || link->elements[id] != i)
+        return UISCENE_INVALID_ID;
+    return id;
+}
+
+// Matches the clips of the new file to those of the old one by index.
+// Old clips the new file no longer has are removed by
+// RemoveDroppedUISceneClips once no element uses them.
+static uint32_t* PatchUISceneClips(UIScene* scene, const UISceneFileView* prev, const UISceneFileView* next)
+{
+    uint32_t count = next->header->clipCount;
+    uint32_t* clips = (uint32_t*)malloc(max(count, 1u) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (i >= prev->header->clipCount)
+        {
+            clips[i] = AddUISceneClip(scene, next->clips[i]);
+            continue;
+        }
+
+        clips[i] = scene->file.clips[i];
+        if (!EqualsUIRect(prev->clips[i], next->clips[i]))
+            SetUISceneClip(scene, clips[i], next->clips[i]);
+    }
+    return clips;
+}
+
+static void RemoveDroppedUISceneClips(UIScene* scene, const UISceneFileView* prev, const UISceneFileView* next)
+{
+    for (uint32_t i = next->header->clipCount; i < prev->header->clipCount; ++i)
+        RemoveUISceneClip(scene, scene->file.clips[i]);
+}
+
+// Points text the element still has from the old file at the same text in
+// the new one, so the old mapping can be let go. Its layout stays valid,
+// as the text is the same.
+static void MoveUISceneFileText(UIScene* scene, UISceneId id, const char* from, const char* to)
+{
+    size_t slot = scene->idSlots[id];
+    if (!(scene->nodes[slot].flags & UI_NODE_TEXT) || scene->texts[slot].text.str != from)
+        return;
+
+    scene->texts[slot].text.str = (char*)to;
+    if (scene->layouts[slot].str == from)
+        scene->layouts[slot].str = to;
+}
+
+// Applies what changed between two versions of an element to its live
+// copy. Fields the file did not change keep their live values, so edits
+// made at runtime, such as rects placed by a layout, survive.
+static void PatchUISceneElement(
+    UIScene* scene, UISceneId id, const uint32_t* clips,
+    const UISceneFileView* prev, uint32_t i,
+    const UISceneFileView* next, const UISceneFileTables* tables, uint32_t j)
+{
+    const UISceneFileElement* a = &prev->elements[i];
+    const UISceneFileElement* b = &next->elements[j];
+    uint32_t textureA = a->texture != UISCENE_FILE_NONE ? prev->textures[a->texture] : UISCENE_FILE_NONE;
+    uint32_t textureB = b->texture != UISCENE_FILE_NONE ? next->textures[b->texture] : UISCENE_FILE_NONE;
+    bool rect = !EqualsUIRect(a->rect, b->rect);
+    bool style = memcmp(&prev->styles[a->style], &next->styles[b->style], sizeof(UIStyle)) != 0;
+    bool kind = ((a->flags ^ b->flags) & ((~0u << UI_NODE_KIND_SHIFT) | UI_STATE_TOGGLED)) != 0;
+    bool geometry = !EqualsUIRect(a->textureRect, b->textureRect) || a->fontSize != b->fontSize;
+    bool text = !EqualsUISceneFileString(prev, a->text, next, b->text) || !EqualsUIAlign(a->align, b->align);
+    bool texture = !EqualsUISceneFileString(prev, textureA, next, textureB);
+
+    if (a->clip != b->clip)
+        SetUISceneElementClip(scene, id, b->clip != UISCENE_FILE_NONE ? clips[b->clip] : UISCENE_NO_CLIP);
+    if (!text && b->text != UISCENE_FILE_NONE)
+        MoveUISceneFileText(scene, id, prev->strings + a->text, next->strings + b->text);
+    if (!(rect || style || kind || geometry || text || texture))
+        return;
+
+    UIElement elem;
+    GetUISceneElement(scene, id, &elem);
+    if (rect)
+        elem.rect = b->rect;
+    if (style)
+        elem.style = tables->styles[b->style];
+    if (kind)
+    {
+        elem.kind = (UIKind)(b->flags >> UI_NODE_KIND_SHIFT);
+        elem.optState = (elem.optState & ~UI_STATE_TOGGLED) | (b->flags & UI_STATE_TOGGLED);
+    }
+    if (geometry)
+    {
+        elem.textureRect = b->textureRect;
+        elem.text.fontSize = b->fontSize;
+    }
+    if (text)
+    {
+        elem.hasText = b->text != UISCENE_FILE_NONE;
+        elem.text.str = elem.hasText ? (char*)next->strings + b->text : NULL;
+        elem.textAlign = b->align;
+    }
+    if (texture)
+    {
+        elem.hasTexture = b->texture != UISCENE_FILE_NONE;
+        if (elem.hasTexture)
+            elem.texture = tables->textures[b->texture];
+    }
+    SetUISceneElement(scene, id, &elem);
+}
+
+// Finds the live element of each new file element by key and patches,
+// inserts or deletes elements to match. Returns the live id of each new
+// file element.
+static UISceneId* PatchUISceneElements(
+    UIScene* scene, const uint32_t* clips,
+    const UISceneFileView* prev, const UISceneFileView* next, const UISceneFileTables* tables)
+{
+    uint32_t prevCount = prev->header->elementCount;
+    uint32_t nextCount = next->header->elementCount;
+    Arena* arena = GetUIFrameArena();
+    bool* kept = (bool*)ArenaAlloc(arena, prevCount * sizeof(bool));
+    memset(kept, 0, prevCount * sizeof(bool));
+
+    // The old element each new one keeps, by key.
+    uint32_t* matches = (uint32_t*)ArenaAlloc(arena, nextCount * sizeof(uint32_t));
+    memset(matches, 0xFF, nextCount * sizeof(uint32_t));
+    for (uint32_t i = 0; i < prevCount; ++i)
+    {
+        uint32_t key = prev->elements[i].key;
+        uint32_t j = key != UISCENE_FILE_NONE
+            ? FindUISceneKey(next, tables->keys, tables->keyMask, prev->strings + key)
+            : UISCENE_FILE_NONE;
+        if (j != UISCENE_FILE_NONE)
+            matches[j] = i;
+    }
+
+    UISceneId* ids = (UISceneId*)malloc(max(nextCount, 1u) * sizeof(UISceneId));
+    for (uint32_t j = 0; j < nextCount; ++j)
+    {
+        const UISceneFileElement* element = &next->elements[j];
+        uint32_t i = matches[j];
+
+        UISceneId id = i != UISCENE_FILE_NONE ? GetUISceneFileElementId(scene, i) : UISCENE_INVALID_ID;
+        if (id != UISCENE_INVALID_ID)
+        {
+            kept[i] = true;
+            PatchUISceneElement(scene, id, clips, prev, i, next, tables, j);
+        }
+        else
+        {
+            UIElement elem;
+            ReadUISceneFileElement(next, tables, j, &elem);
+            id = InsertIntoUIScene(scene, &elem);
+            if (element->clip != UISCENE_FILE_NONE)
+                SetUISceneElementClip(scene, id, clips[element->clip]);
+        }
+        ids[j] = id;
+    }
+
+    for (uint32_t i = 0; i < prevCount; ++i)
+    {
+        if (!kept[i])
+            DeleteFromUIScene(scene, GetUISceneFileElementId(scene, i));
+    }
+    return ids;
+}
+
+static int CompareUISceneSlots(const void* a, const void* b)
+{
+    uint32_t sa = *(const uint32_t*)a;
+    uint32_t sb = *(const uint32_t*)b;
+    return (sa > sb) - (sa < sb);
+}
+
+// Moves element from[k] of an array of size byte elements to to[k].
+static void PermuteUISceneArray(void* array, size_t size, const uint32_t* from, const uint32_t* to, size_t count)
+{
+    char* bytes = (char*)array;
+    char* scratch = (char*)ArenaAlloc(GetUIFrameArena(), count * size);
+    for (size_t k = 0; k < count; ++k)
+        memcpy(scratch + k * size, bytes + from[k] * size, size);
+    for (size_t k = 0; k < count; ++k)
+        memcpy(bytes + to[k] * size, scratch + k * size, size);
+}
+
+// Puts the file elements back in file order, within the slots they
+// already take up; elements added by code keep their slots. Slots keep
+// their draw keys, so those stay in draw order.
+static void OrderUISceneFileElements(UIScene* scene, const UISceneId* ids, uint32_t count)
+{
+    Arena* arena = GetUIFrameArena();
+    uint32_t* from = (uint32_t*)ArenaAlloc(arena, count * sizeof(uint32_t));
+    size_t moved = 0;
+    bool ordered = true;
+    for (uint32_t j = 0; j < count; ++j)
+    {
+        if (ids[j] == UISCENE_INVALID_ID)
+            continue;
+
+        from[moved] = scene->idSlots[ids[j]];
+        ordered = ordered && (moved == 0 || from[moved] > from[moved - 1]);
+        ++moved;
+    }
+    if (ordered)
+        return;
+
+    uint32_t* to = (uint32_t*)ArenaAlloc(arena, moved * sizeof(uint32_t));
+    uint32_t* drawKeys = (uint32_t*)ArenaAlloc(arena, moved * sizeof(uint32_t));
+    memcpy(to, from, moved * sizeof(uint32_t));
+    qsort(to, moved, sizeof(uint32_t), CompareUISceneSlots);
+    for (size_t k = 0; k < moved; ++k)
+        drawKeys[k] = scene->nodes[to[k]].drawKey;
+
+    PermuteUISceneArray(scene->nodes, sizeof(UISceneNode), from, to, moved);
+    PermuteUISceneArray(scene->designRects, sizeof(UIRect), from, to, moved);
+    PermuteUISceneArray(scene->textures, sizeof(UITextureRegion), from, to, moved);
+    PermuteUISceneArray(scene->texts, sizeof(UISceneText), from, to, moved);
+    PermuteUISceneArray(scene->layouts, sizeof(UITextLayout), from, to, moved);
+    PermuteUISceneArray(scene->clipIds, sizeof(uint32_t), from, to, moved);
+    for (int f = 0; f < UI_GEOM_FIELD_COUNT; ++f)
+    {
+        PermuteUISceneArray(scene->design[f], sizeof(float), from, to, moved);
+        PermuteUISceneArray(scene->screen[f], sizeof(float), from, to, moved);
+    }
+
+    for (size_t k = 0; k < moved; ++k)
+    {
+        UISceneNode* node = &scene->nodes[to[k]];
+        node->drawKey = drawKeys[k];
+        scene->idSlots[node->id] = to[k];
+        if (to[k] != from[k])
+            MarkUISceneElementDirty(scene, node->id);
+    }
+    scene->drawList.valid = false;
+}
+
+// -----------------------------------------------------------------------------
+
+// Opening a scene maps the file and points the scene into it, so the cost
+// is in page faults rather than parsing. The scene comes up at the
+// identity transform, fully damaged. Returns NULL if the file cannot be
+// read, is not a scene file of this build, or names a texture that
+// texture cannot find.
+UIScene* LoadUIScene(const char* path, UISceneTextureFn texture, void* user)
+{
+    PROFILE_ZONE("LoadUIScene");
+    UISceneMapping mapping;
+    UISceneFileView file;
+    UISceneFileTables tables;
+    if (!OpenUISceneFile(path, texture, user, &mapping, &file, &tables))
+        return NULL;
+
+    UIScene* scene = CreateUIScene();
+    AddUISceneFileMapping(&scene->file, mapping);
+    if (!AttachUISceneFile(scene, &file, &tables))
+    {
+        DeleteUIScene(scene);
+        return NULL;
+    }
+    return scene;
+}
+
+// Brings scene in line with a new version of its file. Elements are
+// matched by key: those the file changed are patched field by field,
+// along with their layout caches and grid cells, new ones are inserted,
+// and ones the file dropped are deleted. Untouched elements are left
+// alone, and textures are only looked up, not loaded. A scene that was
+// not loaded from a file gets the file's elements added. Returns false,
+// leaving the scene as it was, if the file cannot be opened.
+bool ReloadUIScene(UIScene* scene, const char* path, UISceneTextureFn texture, void* user)
+{
+    PROFILE_ZONE("ReloadUIScene");
+    UISceneMapping mapping;
+    UISceneFileView next;
+    UISceneFileTables tables;
+    if (!OpenUISceneFile(path, texture, user, &mapping, &next, &tables))
+        return false;
+
+    UISceneFileView prev = GetUISceneFileView(GetUISceneFileMapping(scene));
+    uint32_t* clips = PatchUISceneClips(scene, &prev, &next);
+    UISceneId* ids = PatchUISceneElements(scene, clips, &prev, &next, &tables);
+    RemoveDroppedUISceneClips(scene, &prev, &next);
+    OrderUISceneFileElements(scene, ids, next.header->elementCount);
+
+    UISceneFileLink* link = &scene->file;
+    AddUISceneFileMapping(link, mapping);
+    LinkUISceneFileElements(scene, ids, next.header->elementCount);
+    free(link->ids);
+    free(link->clips);
+    link->ids = ids;
+    link->clips = clips;
+    ReleaseUISceneFileMappings(scene);
+    return true;
+}
+
+// Finds the element the scene's file gave key. Elements inserted by code
+// have no key.
+UISceneId FindUISceneElement(const UIScene* scene, const char* key)
+{
+    const UISceneMapping* mapping = GetUISceneFileMapping(scene);
+    if (mapping == NULL)
+        return UISCENE_INVALID_ID;
+
+    UISceneFileView file = GetUISceneFileView(mapping);
+    for (uint32_t i = 0; i < file.header->elementCount; ++i)
+    {
+        uint32_t offset = file.elements[i].key;
+        if (offset != UISCENE_FILE_NONE && strcmp(file.strings + offset, key) == 0)
+            return GetUISceneFileElementId(scene, i);
+    }
+    return UISCENE_INVALID_ID;
+}
+
+void UnlinkUISceneFileElement(UISceneFileLink* link, UISceneId id)
+{
+    if (id < link->elementCapacity)
+        link->elements[id] = UISCENE_FILE_NONE;
+}
+
+void FreeUISceneFileLink(UISceneFileLink* link)
+{
+    for (size_t i = 0; i < link->mappingCount; ++i)
+        UnmapUISceneFile(&link->mappings[i]);
+
+    free(link->mappings);
+    free(link->ids);
+    free(link->clips);
+    free(link->elements);
+    memset(link, 0, sizeof(UISceneFileLink));
+}
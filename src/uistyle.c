@@ -0,0 +1,71 @@
+#include "ui.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+static UIStyleRegistry registry = { 0 };
+
+// -----------------------------------------------------------------------------
+
+static bool EqualsColor(Color a, Color b)
+{
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+static bool EqualsUIStyle(const UIStyle* a, const UIStyle* b)
+{
+    return
+           EqualsColor(a->bgColor, b->bgColor)
+        && a->borderWidth == b->borderWidth
+        && EqualsColor(a->borderColor, b->borderColor)
+        && EqualsColor(a->fontColor, b->fontColor);
+}
+
+// -----------------------------------------------------------------------------
+
+// A UI only ever has a handful of distinct styles, so interning is a
+// linear search.
+UIStyleId InternUIStyle(UIStyle style)
+{
+    for (uint32_t i = 0; i < registry.count; ++i)
+    {
+        if (EqualsUIStyle(&registry.styles[i], &style))
+            return i;
+    }
+
+    if (registry.count == registry.capacity)
+    {
+        registry.capacity = registry.capacity > 0 ? registry.capacity * 2 : 8;
+        registry.styles = (UIStyle*)realloc(
+            registry.styles, registry.capacity * sizeof(UIStyle));
+    }
+    registry.styles[registry.count] = style;
+    return registry.count++;
+}
+
+const UIStyle* GetUIStyle(UIStyleId id)
+{
+    return &registry.styles[id];
+}
+
+void SetUIStyle(UIStyleId id, UIStyle style)
+{
+    if (id >= registry.count || EqualsUIStyle(&registry.styles[id], &style))
+        return;
+
+    registry.styles[id] = style;
+    ++registry.generation;
+}
+
+uint32_t GetUIStyleGeneration()
+{
+    return registry.generation;
+}
+
+void UnloadUIStyles()
+{
+    free(registry.styles);
+    memset(&registry, 0, sizeof(UIStyleRegistry));
+}
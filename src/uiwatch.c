@@ -0,0 +1,147 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include "ui.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#define UIWATCH_EVENT_BUFFER_SIZE 4096
+
+// -----------------------------------------------------------------------------
+
+static char* CopyUIWatchString(const char* str, size_t length)
+{
+    char* copy = (char*)malloc(length + 1);
+    memcpy(copy, str, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+#ifdef __linux__
+
+// Editors and the scene compiler replace files rather than write them in
+// place, which would leave a watch on the file itself watching the old
+// inode, so the watch is on the directory.
+static bool StartUISceneWatch(UISceneWatcher* watcher)
+{
+    const char* slash = strrchr(watcher->path, '/');
+    char* dir = slash != NULL
+        ? CopyUIWatchString(watcher->path, (size_t)(slash - watcher->path) + 1)
+        : CopyUIWatchString(".", 1);
+
+    watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    bool watching = watcher->fd >= 0 && inotify_add_watch(watcher->fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) >= 0;
+    free(dir);
+    return watching;
+}
+
+// Drains every pending event, so a burst of writes reads as one change.
+static bool PollUISceneWatch(UISceneWatcher* watcher)
+{
+    _Alignas(struct inotify_event) char buffer[UIWATCH_EVENT_BUFFER_SIZE];
+    bool changed = false;
+    for (;;)
+    {
+        ssize_t length = read(watcher->fd, buffer, sizeof(buffer));
+        if (length < 0 && errno == EINTR)
+            continue;
+        if (length <= 0)
+            return changed;
+
+        for (char* p = buffer; p < buffer + length;)
+        {
+            const struct inotify_event* event = (const struct inotify_event*)p;
+            if (event->len > 0 && strcmp(event->name, watcher->name) == 0)
+                changed = true;
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+}
+
+static void StopUISceneWatch(UISceneWatcher* watcher)
+{
+    if (watcher->fd >= 0)
+        close(watcher->fd);
+}
+
+#else
+
+static int64_t GetUISceneFileTime(const char* path)
+{
+    struct stat st;
+    return stat(path, &st) == 0 ? (int64_t)st.st_mtime : -1;
+}
+
+static bool StartUISceneWatch(UISceneWatcher* watcher)
+{
+    watcher->fd = -1;
+    watcher->modified = GetUISceneFileTime(watcher->path);
+    return true;
+}
+
+// Modification times only have a resolution of a second here, so two
+// saves within the same second read as one.
+static bool PollUISceneWatch(UISceneWatcher* watcher)
+{
+    int64_t modified = GetUISceneFileTime(watcher->path);
+    if (modified == watcher->modified)
+        return false;
+
+    watcher->modified = modified;
+    return modified >= 0;
+}
+
+static void StopUISceneWatch(UISceneWatcher* watcher)
+{
+    (void)watcher;
+}
+
+#endif
+
+// -----------------------------------------------------------------------------
+
+// Returns NULL if the file's directory cannot be watched.
+UISceneWatcher* WatchUISceneFile(const char* path)
+{
+    const char* slash = strrchr(path, '/');
+    const char* name = slash != NULL ? slash + 1 : path;
+
+    UISceneWatcher* watcher = (UISceneWatcher*)calloc(1, sizeof(UISceneWatcher));
+    watcher->path = CopyUIWatchString(path, strlen(path));
+    watcher->name = CopyUIWatchString(name, strlen(name));
+    if (!StartUISceneWatch(watcher))
+    {
+        UnwatchUISceneFile(watcher);
+        return NULL;
+    }
+    return watcher;
+}
+
+// Whether the file has changed since the last poll. Never blocks.
+bool PollUISceneWatcher(UISceneWatcher* watcher)
+{
+    return PollUISceneWatch(watcher);
+}
+
+void UnwatchUISceneFile(UISceneWatcher* watcher)
+{
+    if (watcher == NULL)
+        return;
+
+    StopUISceneWatch(watcher);
+    free(watcher->path);
+    free(watcher->name);
+    free(watcher);
+}
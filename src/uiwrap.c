@@ -0,0 +1,365 @@
+#include "ui.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "profile.h"
+#include "uibackend.h"
+
+#define UIWRAP_SET_COUNT 1024
+#define UIWRAP_WAYS 4
+#define UIWRAP_HASH_BASIS 2166136261u
+#define UIWRAP_HASH_PRIME 16777619u
+
+// The lines of one string at one font size, width and line limit. The
+// string is copied, as callers reuse their buffers for other text.
+// lastUse is 0 while the entry is empty.
+typedef struct UITextWrapEntry
+{
+    uint32_t hash;
+    uint32_t flow;
+    uint32_t maxLines;
+    float fontSize;
+    float width;
+    char* str;
+    size_t length;
+    size_t strCapacity;
+    UITextLine* lines;
+    size_t lineCount;
+    size_t lineCap;
+    uint64_t lastUse;
+} UITextWrapEntry;
+
+// Set associative: a key can only live in the ways of the set its hash
+// picks, and a miss evicts the least recently used of those, so the
+// cache stays at UIWRAP_SET_COUNT * UIWRAP_WAYS strings however much text
+// goes through it. Text that is only split at newlines is cheaper to
+// measure again than to look up, so it skips the cache; see
+// SplitUITextLines.
+typedef struct UITextWrapCache
+{
+    UITextWrapEntry* entries;
+    uint64_t clock;
+} UITextWrapCache;
+
+// What one line break pass needs besides the entry it fills.
+typedef struct UITextWrapMetrics
+{
+    float fontSize;
+    float spacing;
+    float space;
+    float ellipsis;
+} UITextWrapMetrics;
+
+static UITextWrapCache cache = { 0 };
+
+// -----------------------------------------------------------------------------
+
+static uint32_t HashUITextBytes(uint32_t hash, const void* data, size_t length)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < length; ++i)
+        hash = (hash ^ bytes[i]) * UIWRAP_HASH_PRIME;
+    return hash;
+}
+
+static bool IsUICodepointContinuation(char c)
+{
+    return ((unsigned char)c & 0xC0) == 0x80;
+}
+
+static size_t NextUICodepoint(const char* str, size_t i, size_t end)
+{
+    for (++i; i < end && IsUICodepointContinuation(str[i]); ++i)
+        ;
+    return i;
+}
+
+static size_t PrevUICodepoint(const char* str, size_t i, size_t start)
+{
+    for (--i; i > start && IsUICodepointContinuation(str[i]); --i)
+        ;
+    return i;
+}
+
+static float MeasureUITextSpan(const char* str, size_t start, size_t end, const UITextWrapMetrics* m)
+{
+    return MeasureUIBackendText(str + start, end - start, m->fontSize, m->spacing).w;
+}
+
+static void PushUITextLine(UITextWrapEntry* entry, size_t start, size_t end, float width, float fontSize)
+{
+    if (entry->lineCount == entry->lineCap)
+    {
+        entry->lineCap = entry->lineCap > 0 ? entry->lineCap * 2 : 4;
+        entry->lines = (UITextLine*)realloc(entry->lines, entry->lineCap * sizeof(UITextLine));
+    }
+
+    entry->lines[entry->lineCount++] = (UITextLine)
+    {
+        start, end - start, (UISize) { width, fontSize }, (UIPoint) { 0, 0 }, false
+    };
+}
+
+static bool IsUITextWrapFull(const UITextWrapEntry* entry)
+{
+    return entry->maxLines > 0 && entry->lineCount > entry->maxLines;
+}
+
+// Glyph widths add up, with one spacing between neighbours, so lines are
+// measured a word at a time rather than from their start. Words wider
+// than a line are broken between codepoints, at least one per line.
+static void WrapUITextParagraph(UITextWrapEntry* entry, size_t start, size_t end, const UITextWrapMetrics* m)
+{
+    const char* str = entry->str;
+    float limit = entry->width;
+    size_t lineStart = start;
+    size_t lineEnd = start;
+    float lineWidth = 0;
+    for (size_t i = start; i < end && !IsUITextWrapFull(entry);)
+    {
+        // Leading spaces indent the first line; spaces a line breaks at
+        // are dropped.
+        size_t gap = i;
+        while (i < end && str[i] == ' ')
+            ++i;
+        size_t word = gap == start ? start : i;
+        while (i < end && str[i] != ' ')
+            ++i;
+        if (word == i)
+            break;
+
+        float wordWidth = MeasureUITextSpan(str, word, i, m);
+        float joined = lineWidth + (word - gap) * (m->space + m->spacing) + m->spacing + wordWidth;
+        if (lineEnd > lineStart && joined <= limit)
+        {
+            lineEnd = i;
+            lineWidth = joined;
+            continue;
+        }
+
+        if (lineEnd > lineStart)
+            PushUITextLine(entry, lineStart, lineEnd, lineWidth, m->fontSize);
+        lineStart = word;
+        lineEnd = i;
+        lineWidth = wordWidth;
+
+        while (lineWidth > limit && !IsUITextWrapFull(entry))
+        {
+            size_t cut = NextUICodepoint(str, lineStart, lineEnd);
+            float cutWidth = MeasureUITextSpan(str, lineStart, cut, m);
+            while (cut < lineEnd)
+            {
+                size_t next = NextUICodepoint(str, cut, lineEnd);
+                float nextWidth = cutWidth + m->spacing + MeasureUITextSpan(str, cut, next, m);
+                if (nextWidth > limit)
+                    break;
+                cut = next;
+                cutWidth = nextWidth;
+            }
+            if (cut == lineEnd)
+                break;
+
+            PushUITextLine(entry, lineStart, cut, cutWidth, m->fontSize);
+            lineStart = cut;
+            lineWidth = MeasureUITextSpan(str, lineStart, lineEnd, m);
+        }
+    }
+
+    if (lineEnd > lineStart && !IsUITextWrapFull(entry))
+        PushUITextLine(entry, lineStart, lineEnd, lineWidth, m->fontSize);
+}
+
+// Drops codepoints off the end of a line, and then any spaces, until it
+// fits with the ellipsis after it.
+static void EllipsizeUITextLine(const UITextWrapEntry* entry, UITextLine* line, const UITextWrapMetrics* m)
+{
+    const char* str = entry->str;
+    size_t start = line->start;
+    size_t end = start + line->length;
+    float width = line->size.w;
+    while (end > start && (width + m->spacing + m->ellipsis > entry->width || str[end - 1] == ' '))
+    {
+        size_t prev = PrevUICodepoint(str, end, start);
+        width = prev > start ? width - m->spacing - MeasureUITextSpan(str, prev, end, m) : 0;
+        end = prev;
+    }
+
+    line->length = end - start;
+    line->size.w = end > start ? width + m->spacing + m->ellipsis : m->ellipsis;
+    line->ellipsis = true;
+}
+
+static void BuildUITextLines(UITextWrapEntry* entry)
+{
+    PROFILE_ZONE("TextWrap");
+    UITextWrapMetrics m = { entry->fontSize, entry->fontSize * FONT_SIZE_SPACING_FACTOR, 0, 0 };
+    m.space = MeasureUIBackendText(" ", 1, m.fontSize, m.spacing).w;
+    m.ellipsis = MeasureUIBackendText(UI_ELLIPSIS, strlen(UI_ELLIPSIS), m.fontSize, m.spacing).w;
+
+    entry->lineCount = 0;
+    bool overflow = false;
+    UIStringView rest = { entry->str, entry->length };
+    UIStringView paragraph;
+    while (NextUILine(&rest, &paragraph))
+    {
+        size_t start = (size_t)(paragraph.data - entry->str);
+        size_t end = start + paragraph.length;
+        if (entry->flow & UI_TEXT_WRAP)
+            WrapUITextParagraph(entry, start, end, &m);
+        else
+            PushUITextLine(entry, start, end, MeasureUITextSpan(entry->str, start, end, &m), m.fontSize);
+
+        if (entry->maxLines > 0 && entry->lineCount >= entry->maxLines)
+        {
+            UIStringView next;
+            overflow = entry->lineCount > entry->maxLines || NextUILine(&rest, &next);
+            break;
+        }
+    }
+
+    if (!(entry->flow & UI_TEXT_ELLIPSIS))
+        return;
+
+    if (overflow)
+    {
+        entry->lineCount = entry->maxLines;
+        EllipsizeUITextLine(entry, &entry->lines[entry->lineCount - 1], &m);
+    }
+    for (size_t i = 0; i < entry->lineCount; ++i)
+    {
+        if (entry->lines[i].size.w > entry->width && !entry->lines[i].ellipsis)
+            EllipsizeUITextLine(entry, &entry->lines[i], &m);
+    }
+}
+
+// Splits text at newlines only, into lines taken from the frame arena.
+// The string is borrowed rather than copied, and nothing outlives the
+// frame, so this is as cheap as measuring the lines.
+static UITextLine* SplitUITextLines(UIText text, size_t length, size_t* count)
+{
+    UIStringView rest = { text.str, length };
+    UIStringView line;
+    size_t lineCount = 0;
+    while (NextUILine(&rest, &line))
+        ++lineCount;
+
+    UITextLine* lines = (UITextLine*)ArenaAlloc(GetUIFrameArena(), lineCount * sizeof(UITextLine));
+    float spacing = text.fontSize * FONT_SIZE_SPACING_FACTOR;
+    rest = (UIStringView) { text.str, length };
+    for (size_t i = 0; NextUILine(&rest, &line); ++i)
+    {
+        lines[i] = (UITextLine)
+        {
+            (size_t)(line.data - text.str), line.length,
+            (UISize) { MeasureUIBackendText(line.data, line.length, text.fontSize, spacing).w, text.fontSize },
+            (UIPoint) { 0, 0 }, false
+        };
+    }
+
+    *count = lineCount;
+    return lines;
+}
+
+static bool MatchesUITextWrapEntry(
+    const UITextWrapEntry* entry, uint32_t hash, UIText text, size_t length,
+    uint32_t flow, float width, uint32_t maxLines)
+{
+    return
+           entry->lastUse > 0
+        && entry->hash == hash
+        && entry->length == length
+        && entry->fontSize == text.fontSize
+        && entry->width == width
+        && entry->maxLines == maxLines
+        && entry->flow == flow
+        && memcmp(entry->str, text.str, length) == 0;
+}
+
+// -----------------------------------------------------------------------------
+
+// Splits text into the lines it takes up in a box of size content: at each
+// newline, and with UI_TEXT_WRAP between words to fit content.w. With
+// UI_TEXT_ELLIPSIS, text that still does not fit content is cut short
+// and ends in UI_ELLIPSIS. Lines are measured but not placed.
+//
+// Wrapped and cut text is cached by string, font size and the width and
+// line count that apply, so it is only broken again when one of those
+// changes. The lines returned belong to the cache and stay valid until
+// the next call; with no flow they come from the frame arena instead, and
+// stay valid until the next BeginUIFrame.
+const UITextLine* GetUITextLines(UIText text, uint32_t flow, UISize content, size_t* count)
+{
+    size_t length = strlen(text.str);
+    if (flow == 0)
+        return SplitUITextLines(text, length, count);
+
+    float width = (flow & (UI_TEXT_WRAP | UI_TEXT_ELLIPSIS)) ? max(content.w, 0.0f) : 0;
+    uint32_t maxLines = 0;
+    if (flow & UI_TEXT_ELLIPSIS)
+    {
+        float spacing = text.fontSize * FONT_SIZE_SPACING_FACTOR;
+        float lines = (content.h + spacing) / (text.fontSize + spacing);
+        maxLines = lines >= 1.0f ? (uint32_t)min(lines, (float)UINT32_MAX) : 1;
+    }
+
+    uint32_t hash = HashUITextBytes(UIWRAP_HASH_BASIS, text.str, length);
+    hash = HashUITextBytes(hash, &text.fontSize, sizeof(float));
+    hash = HashUITextBytes(hash, &width, sizeof(float));
+    hash = HashUITextBytes(hash, &maxLines, sizeof(uint32_t));
+    hash = HashUITextBytes(hash, &flow, sizeof(uint32_t));
+
+    if (cache.entries == NULL)
+        cache.entries = (UITextWrapEntry*)calloc(UIWRAP_SET_COUNT * UIWRAP_WAYS, sizeof(UITextWrapEntry));
+
+    UITextWrapEntry* set = &cache.entries[(hash % UIWRAP_SET_COUNT) * UIWRAP_WAYS];
+    UITextWrapEntry* entry = &set[0];
+    for (int way = 0; way < UIWRAP_WAYS; ++way)
+    {
+        if (MatchesUITextWrapEntry(&set[way], hash, text, length, flow, width, maxLines))
+        {
+            entry = &set[way];
+            entry->lastUse = ++cache.clock;
+            *count = entry->lineCount;
+            return entry->lines;
+        }
+        if (set[way].lastUse < entry->lastUse)
+            entry = &set[way];
+    }
+
+    if (entry->strCapacity < length + 1)
+    {
+        entry->strCapacity = length + 1;
+        entry->str = (char*)realloc(entry->str, entry->strCapacity);
+    }
+    memcpy(entry->str, text.str, length + 1);
+    entry->length = length;
+    entry->hash = hash;
+    entry->flow = flow;
+    entry->maxLines = maxLines;
+    entry->fontSize = text.fontSize;
+    entry->width = width;
+    entry->lastUse = ++cache.clock;
+    BuildUITextLines(entry);
+
+    *count = entry->lineCount;
+    return entry->lines;
+}
+
+void UnloadUITextLines()
+{
+    if (cache.entries != NULL)
+    {
+        for (size_t i = 0; i < UIWRAP_SET_COUNT * UIWRAP_WAYS; ++i)
+        {
+            free(cache.entries[i].str);
+            free(cache.entries[i].lines);
+        }
+    }
+    free(cache.entries);
+    memset(&cache, 0, sizeof(UITextWrapCache));
+}
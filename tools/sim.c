@@ -0,0 +1,253 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "battle.h"
+#include "job.h"
+#include "util.h"
+
+#define SIM_ERROR_SIZE 256
+#define SIM_DEFAULT_BATTLES 100000
+#define SIM_BATCH 1024
+#define SIM_BAR_WIDTH 40
+
+// Headless battle simulator: warmagic-sim [-n battles] [-s seed]
+// [-j threads] <setup.battle>
+//
+// Plays the setup's party against its encounter over and over and prints
+// how the battles went. Battle i always plays out from the same seed and
+// stats only add up counts, so the report on stdout is the same for the
+// same setup, seed and count however many threads run it; timings go to
+// stderr.
+
+typedef struct SimRun
+{
+    const BattleSetup* setup;
+    uint64_t seed;
+    BattleStats* threadStats;
+} SimRun;
+
+static char* ReadTextFile(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+        return NULL;
+
+    char* text = NULL;
+    long size = 0;
+    if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) >= 0 && fseek(file, 0, SEEK_SET) == 0)
+    {
+        text = (char*)malloc((size_t)size + 1);
+        if (fread(text, 1, (size_t)size, file) == (size_t)size)
+        {
+            text[size] = '\0';
+        }
+        else
+        {
+            free(text);
+            text = NULL;
+        }
+    }
+    fclose(file);
+    return text;
+}
+
+static double GetSimSeconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static bool ParseSimNumber(const char* str, uint64_t* out)
+{
+    char* end = NULL;
+    *out = strtoull(str, &end, 0);
+    return *str != '\0' && *end == '\0';
+}
+
+// Each thread adds to stats of its own, so nothing is shared while the
+// battles run.
+static void RunSimBattles(void* data, size_t start, size_t end)
+{
+    SimRun* run = (SimRun*)data;
+    int thread = GetJobThreadIndex();
+    BattleStats* stats = &run->threadStats[thread > 0 ? thread : 0];
+    for (size_t i = start; i < end; ++i)
+        RunBattle(run->setup, GetBattleSeed(run->seed, i), stats);
+}
+
+// The fewest rounds that percent of battles were over within.
+static uint32_t GetSimRoundPercentile(const BattleStats* stats, uint64_t percent)
+{
+    uint64_t seen = 0;
+    for (uint32_t round = 0; round <= BATTLE_MAX_ROUNDS; ++round)
+    {
+        seen += stats->rounds[round];
+        if (seen * 100 >= stats->battles * percent)
+            return round;
+    }
+    return BATTLE_MAX_ROUNDS;
+}
+
+static double GetSimPercent(uint64_t count, uint64_t total)
+{
+    return total > 0 ? 100.0 * (double)count / (double)total : 0;
+}
+
+static void PrintSimReport(const BattleSetup* setup, const BattleStats* stats)
+{
+    double battles = (double)max(stats->battles, (uint64_t)1);
+    printf(
+        "wins %.2f%%  losses %.2f%%  draws %.2f%%\n",
+        GetSimPercent(stats->wins, stats->battles),
+        GetSimPercent(stats->losses, stats->battles),
+        GetSimPercent(stats->draws, stats->battles));
+
+    uint64_t rounds = 0;
+    uint32_t longest = 0;
+    for (uint32_t round = 0; round <= BATTLE_MAX_ROUNDS; ++round)
+    {
+        rounds += stats->rounds[round] * round;
+        if (stats->rounds[round] > 0)
+            longest = round;
+    }
+    printf(
+        "rounds mean %.2f  p10 %u  p50 %u  p90 %u  max %u\n",
+        (double)rounds / battles,
+        GetSimRoundPercentile(stats, 10),
+        GetSimRoundPercentile(stats, 50),
+        GetSimRoundPercentile(stats, 90),
+        longest);
+    printf(
+        "damage per battle: party %.2f  enemy %.2f\n\n",
+        (double)stats->damage[BATTLE_PARTY] / battles,
+        (double)stats->damage[BATTLE_ENEMY] / battles);
+
+    static const char* sideNames[BATTLE_SIDE_COUNT] = { "party", "enemy" };
+    printf("%-*s %-6s %14s %9s\n", BATTLE_NAME_MAX, "unit", "side", "damage/battle", "survival");
+    for (int side = 0; side < BATTLE_SIDE_COUNT; ++side)
+    {
+        for (uint32_t i = 0; i < setup->unitCounts[side]; ++i)
+        {
+            printf(
+                "%-*s %-6s %14.2f %8.2f%%\n",
+                BATTLE_NAME_MAX, setup->units[side][i].name, sideNames[side],
+                (double)stats->unitDamage[side][i] / battles,
+                GetSimPercent(stats->unitSurvivals[side][i], stats->battles));
+        }
+    }
+
+    printf("\n%-*s %14s %12s\n", BATTLE_NAME_MAX, "spell", "casts/battle", "amount/cast");
+    for (uint32_t i = 0; i < setup->spellCount; ++i)
+    {
+        printf(
+            "%-*s %14.2f %12.2f\n",
+            BATTLE_NAME_MAX, setup->spells[i].name,
+            (double)stats->spellCasts[i] / battles,
+            stats->spellCasts[i] > 0 ? (double)stats->spellAmounts[i] / (double)stats->spellCasts[i] : 0);
+    }
+
+    uint64_t hits = 0;
+    uint64_t most = 1;
+    uint32_t last = 0;
+    for (uint32_t i = 0; i < BATTLE_DAMAGE_BUCKETS; ++i)
+    {
+        hits += stats->hits[i];
+        most = max(most, stats->hits[i]);
+        if (stats->hits[i] > 0)
+            last = i;
+    }
+    printf("\ndamage per hit\n");
+    for (uint32_t i = 0; i <= last; ++i)
+    {
+        char range[32];
+        if (i + 1 < BATTLE_DAMAGE_BUCKETS)
+            snprintf(range, sizeof(range), "%u-%u", i * BATTLE_DAMAGE_BUCKET_SIZE, (i + 1) * BATTLE_DAMAGE_BUCKET_SIZE - 1);
+        else
+            snprintf(range, sizeof(range), "%u+", i * BATTLE_DAMAGE_BUCKET_SIZE);
+
+        int bar = (int)(stats->hits[i] * SIM_BAR_WIDTH / most);
+        printf("%9s %7.2f%% %.*s\n", range, GetSimPercent(stats->hits[i], hits), bar, "########################################");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t battles = SIM_DEFAULT_BATTLES;
+    uint64_t seed = 1;
+    uint64_t threads = 0;
+    const char* path = NULL;
+    for (int i = 1; i < argc; ++i)
+    {
+        bool ok = true;
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            ok = ParseSimNumber(argv[++i], &battles);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            ok = ParseSimNumber(argv[++i], &seed);
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+            ok = ParseSimNumber(argv[++i], &threads) && threads > 0 && threads <= JOB_MAX_THREADS;
+        else if (path == NULL && argv[i][0] != '-')
+            path = argv[i];
+        else
+            ok = false;
+
+        if (!ok)
+        {
+            path = NULL;
+            break;
+        }
+    }
+    if (path == NULL)
+    {
+        fprintf(stderr, "usage: %s [-n battles] [-s seed] [-j threads] <setup.battle>\n", argv[0]);
+        return 2;
+    }
+
+    char* source = ReadTextFile(path);
+    if (source == NULL)
+    {
+        fprintf(stderr, "%s: cannot read\n", path);
+        return 1;
+    }
+
+    static BattleSetup setup;
+    char error[SIM_ERROR_SIZE] = { 0 };
+    bool ok = ParseBattleSetup(source, &setup, error, sizeof(error));
+    free(source);
+    if (!ok)
+    {
+        fprintf(stderr, "%s: %s\n", path, error);
+        return 1;
+    }
+
+    // With -j 1 no workers start, and every battle runs on this thread.
+    if (threads != 1)
+        StartJobSystem(threads > 1 ? (uint32_t)threads - 1 : 0);
+
+    uint32_t threadCount = GetJobThreadCount();
+    SimRun run = { &setup, seed, (BattleStats*)calloc(threadCount, sizeof(BattleStats)) };
+    double start = GetSimSeconds();
+    RunJobsForRange(RunSimBattles, &run, (size_t)battles, SIM_BATCH);
+    double seconds = GetSimSeconds() - start;
+
+    BattleStats stats = { 0 };
+    for (uint32_t i = 0; i < threadCount; ++i)
+        MergeBattleStats(&stats, &run.threadStats[i]);
+
+    printf("%s: %llu battles, seed %llu\n", path, (unsigned long long)battles, (unsigned long long)seed);
+    PrintSimReport(&setup, &stats);
+    fprintf(
+        stderr, "%.3f s on %u threads, %.0f battles/s\n",
+        seconds, threadCount, (double)battles / max(seconds, 1e-9));
+
+    free(run.threadStats);
+    StopJobSystem();
+    return 0;
+}
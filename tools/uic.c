@@ -0,0 +1,59 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ui.h"
+
+#define UIC_ERROR_SIZE 256
+
+// Offline scene compiler: warmagic-uic <source.ui> <output.uis>
+
+static char* ReadTextFile(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+        return NULL;
+
+    char* text = NULL;
+    long size = 0;
+    if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) >= 0 && fseek(file, 0, SEEK_SET) == 0)
+    {
+        text = (char*)malloc((size_t)size + 1);
+        if (fread(text, 1, (size_t)size, file) == (size_t)size)
+        {
+            text[size] = '\0';
+        }
+        else
+        {
+            free(text);
+            text = NULL;
+        }
+    }
+    fclose(file);
+    return text;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3)
+    {
+        fprintf(stderr, "usage: %s <source.ui> <output.uis>\n", argv[0]);
+        return 2;
+    }
+
+    char* source = ReadTextFile(argv[1]);
+    if (source == NULL)
+    {
+        fprintf(stderr, "%s: cannot read\n", argv[1]);
+        return 1;
+    }
+
+    char error[UIC_ERROR_SIZE] = { 0 };
+    bool ok = CompileUIScene(source, argv[2], error, sizeof(error));
+    if (!ok)
+        fprintf(stderr, "%s: %s\n", argv[1], error);
+
+    free(source);
+    return ok ? 0 : 1;
+}